@@ -2,66 +2,85 @@
 #include <SDL.h>
 
 #include "res_path.h"
+#include "res_pack.h"
 #include "cleanup.h"
+#include "app_init.h"
+#include "renderer_select.h"
+#include "surface_ops.h"
+#include "texture_budget.h"
 
-int main (int argc, char** argv) {
-
-	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-		std::cerr << "SDL_Init error: " << SDL_GetError() << std::endl;
-		return 1;
-	}
-
+/**
+ * Show the image, everything created here is freed when it returns
+ * so that happens before SDL_Quit.
+ *
+ * @return The exit code for main.
+ */
+int run() {
 	/* Window initialization */
-	SDL_Window *win = SDL_CreateWindow("Hello World!", 100, 100, 640, 480, SDL_WINDOW_SHOWN);
-	if (win == nullptr) {
+	UniqueWindow win(SDL_CreateWindow("Hello World!", 100, 100, 640, 480, SDL_WINDOW_SHOWN));
+	if (!win) {
 		std::cerr << "SDL_CreateWindow Error: " << SDL_GetError() << std::endl;
-		SDL_Quit();
 		return 1;
 	}
 
 	/* Renderer initialization */
-	SDL_Renderer *ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (ren == nullptr) {
-		cleanup(win);
+	UniqueRenderer ren(createRenderer(win.get(), SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+	if (!ren) {
 		std::cerr << "SDL_CreateRenderer Error: " << SDL_GetError() << std::endl;
-		SDL_Quit();
 		return 1;
 	}
+	logRendererInfo(std::cout, ren.get());
 
 	/* Hello World image initialization */
 	std::string imagePath = getResourcePath("Lesson1") + "HelloWorld.bmp";
-	SDL_Surface *bmp = SDL_LoadBMP(imagePath.c_str());
-	if (bmp == nullptr) {
-		cleanup(ren, win);
+	UniqueSurface bmp(SDL_LoadBMP_RW(openResource(imagePath), 1));
+	if (!bmp) {
 		std::cout << "SDL_LoadBMP Error: " << SDL_GetError() << std::endl;
-		SDL_Quit();
+		return 1;
+	}
+
+	/* Expand the 24-bit image to the renderer's usual format up front */
+	UniqueSurface pixels(convertSurface(bmp.get()));
+	bmp.reset();
+	if (!pixels) {
+		std::cout << "ConvertSurface Error: " << SDL_GetError() << std::endl;
 		return 1;
 	}
 
 	/* Upload image to renderer */
-	SDL_Texture *tex = SDL_CreateTextureFromSurface(ren, bmp);
-	cleanup(bmp);
-	if (tex == nullptr) {
-		cleanup(ren, win);
+	UniqueTexture tex(SDL_CreateTextureFromSurface(ren.get(), pixels.get()));
+	pixels.reset();
+	if (!tex) {
 		std::cout << "SDL_CreateTextureFromSurface Error: " << SDL_GetError() << std::endl;
-		SDL_Quit();
 		return 1;
 	}
+	trackTexture(tex.get());
 
 	//A sleepy rendering loop, wait for 3 seconds and render and present the screen each time
 	for (int i = 0; i < 3; i++) {
 		//First clear the renderer
-		SDL_RenderClear(ren);
+		SDL_RenderClear(ren.get());
 		//Draw the texture
-		SDL_RenderCopy(ren, tex, NULL, NULL);
+		SDL_RenderCopy(ren.get(), tex.get(), NULL, NULL);
 		//Update the screen
-		SDL_RenderPresent(ren);
+		SDL_RenderPresent(ren.get());
 		//Take a quick break after all that hard work
 		SDL_Delay(1000);
 	}
 
-	cleanup(tex, ren, win);
-	SDL_Quit();
-
 	return 0;
 }
+
+int main (int argc, char** argv) {
+	//Only video is started, anything else is started when it's first needed
+	AppInit app(SDL_INIT_VIDEO);
+	if (!app) {
+		std::cerr << "SDL_Init error: " << SDL_GetError() << std::endl;
+		return 1;
+	}
+	//Read resources out of res.pak if it's been built
+	openResourcePack();
+	app.report(std::cout);
+
+	return run();
+}
@@ -3,124 +3,101 @@
 #include <string>
 
 #include "res_path.h"
+#include "res_pack.h"
 #include "cleanup.h"
+#include "app_init.h"
+#include "draw_queue.h"
+#include "frame_arena.h"
+#include "lesson_util.h"
+#include "renderer_select.h"
+#include "texture_cache.h"
 
 //Screen attributes
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 
-/**
- * Log an SDL error with an error message to the output stream.
- *
- * @param os  The output stream to write the message to.
- * @param msg The error message to write, with format "{msg} error: {SDL_GetError()}".
- */
-void logSDLError(std::ostream& os, const std::string& msg) {
-	os << msg << " error: " << SDL_GetError() << std::endl;
-}
-
-/**
- * Loads a BMP image into a texture on the rendering device.
- *
- * @param  file The BMP image file to load.
- * @param  ren  The renderer to load the texture onto.
- * @return      The loaded texture, or nullptr if something went wrong.
- */
-SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren) {
-	SDL_Texture* texture = nullptr;
-	SDL_Surface* loadedImage = SDL_LoadBMP(file.c_str());
-
-	if (loadedImage != nullptr) {
-		texture = SDL_CreateTextureFromSurface(ren, loadedImage);
-		SDL_FreeSurface(loadedImage);
-		//Make sure converting went well
-		if (texture == nullptr) {
-			logSDLError(std::cout, "CreateTextureFromSurface");
-		}
-	} else {
-		logSDLError(std::cout, "LoadBMP");
-	}
-
-	return texture;
-}
+//Layers the scene is drawn in, lower layers are drawn first
+const Uint16 BACKGROUND_LAYER = 0;
+const Uint16 FOREGROUND_LAYER = 1;
 
 /**
- * Draw an SDL_Texture to an SDL_Renderer at (x,y), preserving
- * the texture's width and height.
+ * Draw the scene, everything created here is freed when it returns
+ * so that happens before SDL_Quit.
  *
- * @param tex The source texture we want to draw.
- * @param ren [The renderer we want to draw to.
- * @param x   The x coordinate to draw to.
- * @param y   The y coordinate to draw to.
+ * @return The exit code for main.
  */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y) {
-	//Setup destination rectangle at given (x,y)
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-	//Query the texture to get its width and height to use
-	SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
-	SDL_RenderCopy(ren, tex, NULL, &dst);
-}
-
-int main (int argc, char** argv) {
-
-	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-		logSDLError(std::cout, "SDL_Init");
-		return 1;
-	}
-
+int run() {
 	/* Window initialization */
-	SDL_Window* win = SDL_CreateWindow("Lesson 2", 100, 100,
-		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-	if (win == nullptr) {
+	UniqueWindow window(SDL_CreateWindow("Lesson 2", 100, 100,
+		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN));
+	if (!window) {
 		logSDLError(std::cout, "CreateWindow");
-		SDL_Quit();
 		return 1;
 	}
 
 	/* Renderer initialization */
-	SDL_Renderer *ren = SDL_CreateRenderer(win, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (ren == nullptr) {
+	UniqueRenderer renderer(createRenderer(window.get(),
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+	if (!renderer) {
 		logSDLError(std::cout, "CreateRenderer");
-		cleanup(win);
-		SDL_Quit();
 		return 1;
 	}
+	logRendererInfo(std::cout, renderer.get());
+	SDL_Renderer* ren = renderer.get();
 
 	/* Image initialization */
 	const std::string resPath = getResourcePath("Lesson2");
-	SDL_Texture* background = loadTexture(resPath + "background.bmp", ren);
-	SDL_Texture* image = loadTexture(resPath + "image.bmp", ren);
-	if (background == nullptr || image == nullptr) {
-		cleanup(background, image, ren, win);
-		SDL_Quit();
+	//Textures are loaded through the cache so each file is only decoded
+	//and uploaded once, however many times it's asked for
+	TextureCache textures(ren, loadBMPTexture);
+	TextureHandle backgroundHandle = textures.get(resPath + "background.bmp");
+	TextureHandle imageHandle = textures.get(resPath + "image.bmp");
+	if (!backgroundHandle || !imageHandle) {
 		return 1;
 	}
+	//The textures are held on to below, so they mustn't be evicted
+	backgroundHandle.pin();
+	imageHandle.pin();
+	SDL_Texture* background = backgroundHandle.get();
+	SDL_Texture* image = imageHandle.get();
 
 	SDL_RenderClear(ren);
+	//Draws are queued then sorted by layer and texture, so each texture
+	//is only bound once per layer however the draws are interleaved
+	DrawQueue queue;
 
 	/* Tiled Background Drawing */
 	int bW, bH;
 	SDL_QueryTexture(background, NULL, NULL, &bW, &bH);
-	renderTexture(background, ren, 0, 0);
-	renderTexture(background, ren, bW, 0);
-	renderTexture(background, ren, 0, bH);
-	renderTexture(background, ren, bW, bH);
+	renderTexture(background, queue, BACKGROUND_LAYER, 0, 0);
+	renderTexture(background, queue, BACKGROUND_LAYER, bW, 0);
+	renderTexture(background, queue, BACKGROUND_LAYER, 0, bH);
+	renderTexture(background, queue, BACKGROUND_LAYER, bW, bH);
 
 	/* Image Drawing */
 	int iW, iH;
 	SDL_QueryTexture(image, NULL, NULL, &iW, &iH);
 	int x = SCREEN_WIDTH / 2 - iW / 2;
 	int y = SCREEN_HEIGHT / 2 - iH / 2;
-	renderTexture(image, ren, x, y);
+	renderTexture(image, queue, FOREGROUND_LAYER, x, y);
 
-	SDL_RenderPresent(ren);
+	queue.draw(ren);
+	presentFrame(ren);
 	SDL_Delay(1000);
 
-	cleanup(background, image, ren, win);
-	SDL_Quit();
-
 	return 0;
 }
+
+int main (int argc, char** argv) {
+	//Only video is started, anything else is started when it's first needed
+	AppInit app(SDL_INIT_VIDEO);
+	if (!app) {
+		logSDLError(std::cout, "SDL_Init");
+		return 1;
+	}
+	//Read resources out of res.pak if it's been built
+	openResourcePack();
+	app.report(std::cout);
+
+	return run();
+}
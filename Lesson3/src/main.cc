@@ -4,109 +4,83 @@
 #include <string>
 
 #include "res_path.h"
+#include "res_pack.h"
 #include "cleanup.h"
+#include "app_init.h"
+#include "async_loader.h"
+#include "draw_queue.h"
+#include "frame_arena.h"
+#include "lesson_image.h"
+#include "lesson_util.h"
+#include "render_scale.h"
+#include "renderer_select.h"
+#include "tilemap.h"
+#include "texture_cache.h"
 
 //Screen attributes
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 const int TILE_SIZE = 40;
 
-/**
- * Log an SDL error with an error message to the output stream.
- *
- * @param os  The output stream to write the message to.
- * @param msg The error message to write, with format "{msg} error: {SDL_GetError()}".
- */
-void logSDLError(std::ostream& os, const std::string& msg) {
-	os << msg << " error: " << SDL_GetError() << std::endl;
-}
-
-/**
- * Loads an image into a texture on the rendering device.
- *
- * @param  file The image file to load.
- * @param  ren  The renderer to load the texture onto.
- * @return      The loaded texture, or nullptr if something went wrong.
- */
-SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren) {
-	SDL_Texture* texture = IMG_LoadTexture(ren, file.c_str());
-
-	if (texture == nullptr) {
-		logSDLError(std::cout, "LoadTexture");
-	}
-
-	return texture;
-}
+//Layers the scene is drawn in, lower layers are drawn first
+const Uint16 BACKGROUND_LAYER = 0;
+const Uint16 FOREGROUND_LAYER = 1;
 
 /**
- * Draw an SDL_Texture to an SDL_Renderer at (x,y), with
- * specified width and height.
+ * Draw the scene, everything created here is freed when it returns
+ * so that happens before SDL_Quit.
  *
- * @param tex The source texture we want to draw.
- * @param ren [The renderer we want to draw to.
- * @param x   The x coordinate to draw to.
- * @param y   The y coordinate to draw to.
- * @param w   The width of the texture to draw.
- * @param h   The height of the texture to draw.
+ * @return The exit code for main.
  */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, int w, int h) {
-	//Setup destination rectangle at given (x,y)
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-	dst.w = w;
-	dst.h = h;
-	SDL_RenderCopy(ren, tex, NULL, &dst);
-}
-
-/**
- * Draw an SDL_Texture to an SDL_Renderer at (x,y), preserving
- * the texture's width and height.
- *
- * @param tex The source texture we want to draw.
- * @param ren [The renderer we want to draw to.
- * @param x   The x coordinate to draw to.
- * @param y   The y coordinate to draw to.
- */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y) {
-	int w, h;
-	SDL_QueryTexture(tex, NULL, NULL, &w, &h);
-	renderTexture(tex, ren, x, y, w, h);
-}
-
-int main (int argc, char** argv) {
-	/* SDL initialization */
-	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-		logSDLError(std::cout, "SDL_Init");
-		return 1;
-	}
+int run() {
 	/* Window initialization */
-	SDL_Window* win = SDL_CreateWindow("Lesson 3", 100, 100,
-		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-	if (win == nullptr) {
+	UniqueWindow window(SDL_CreateWindow("Lesson 3", 100, 100,
+		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN));
+	if (!window) {
 		logSDLError(std::cout, "CreateWindow");
-		SDL_Quit();
 		return 1;
 	}
 	/* Renderer initialization */
-	SDL_Renderer *ren = SDL_CreateRenderer(win, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (ren == nullptr) {
+	UniqueRenderer renderer(createRenderer(window.get(),
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+	if (!renderer) {
 		logSDLError(std::cout, "CreateRenderer");
-		cleanup(win);
-		SDL_Quit();
 		return 1;
 	}
+	logRendererInfo(std::cout, renderer.get());
+	SDL_Renderer* ren = renderer.get();
 
 	/* Image initialization */
 	const std::string resPath = getResourcePath("Lesson3");
-	SDL_Texture* background = loadTexture(resPath + "background.png", ren);
-	SDL_Texture* image = loadTexture(resPath + "image.png", ren);
-	if (background == nullptr || image == nullptr) {
-		cleanup(background, image, ren, win);
-		SDL_Quit();
+	//Show the window straight away instead of once everything is loaded
+	SDL_RenderClear(ren);
+	SDL_RenderPresent(ren);
+	//Both images are decoded on worker threads at once, then handed to the
+	//cache so any later loads of the same files share the textures
+	TextureCache textures(ren, loadTexture);
+	AsyncTextureLoader loader(ren);
+	const int backgroundId = loader.request(resPath + "background.png");
+	const int imageId = loader.request(resPath + "image.png");
+	loader.finish();
+	TextureHandle backgroundHandle = textures.adopt(resPath + "background.png",
+		loader.take(backgroundId));
+	TextureHandle imageHandle = textures.adopt(resPath + "image.png", loader.take(imageId));
+	loader.stop();
+	if (!backgroundHandle || !imageHandle) {
 		return 1;
 	}
+	//The textures are held on to below, so they mustn't be evicted
+	backgroundHandle.pin();
+	imageHandle.pin();
+	SDL_Texture* background = backgroundHandle.get();
+	SDL_Texture* image = imageHandle.get();
+	//Draws are queued then sorted by layer and texture, so each texture
+	//is only bound once per layer however the draws are interleaved
+	DrawQueue queue;
+	//The scene is laid out at the screen size but drawn at RENDER_SCALE
+	//of it, then stretched to the window
+	RenderScale scale(ren, SCREEN_WIDTH, SCREEN_HEIGHT);
+	scale.begin();
 
 	/*********************
 	 * Background Drawing
@@ -115,14 +89,12 @@ int main (int argc, char** argv) {
 	const int xTiles = SCREEN_WIDTH / TILE_SIZE;
 	const int yTiles = SCREEN_HEIGHT / TILE_SIZE;
 
-	//Draw tiles by calculating their positions
-	for (int i = 0; i < xTiles * yTiles; i++) {
-		int x = i % xTiles;
-		int y = i / xTiles;
-		//Scale coordinates to pixels by multiplying by tile size
-		renderTexture(background, ren, x * TILE_SIZE, y * TILE_SIZE,
-			TILE_SIZE, TILE_SIZE);
-	}
+	//The tiles are rendered once into chunk textures by the layer,
+	//then drawing it only copies the chunks the camera can see
+	TileLayer tiles(background, xTiles, yTiles, TILE_SIZE);
+	tiles.fill(tiles.addTile());
+	const SDL_Rect camera = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
+	tiles.draw(ren, queue, BACKGROUND_LAYER, camera);
 
 	/*********************
 	 * Foreground Drawing
@@ -131,14 +103,31 @@ int main (int argc, char** argv) {
 	SDL_QueryTexture(image, NULL, NULL, &iW, &iH);
 	int x = SCREEN_WIDTH / 2 - iW / 2;
 	int y = SCREEN_HEIGHT / 2 - iH / 2;
-	renderTexture(image, ren, x, y);
+	renderTexture(image, queue, FOREGROUND_LAYER, x, y);
 
-	SDL_RenderPresent(ren);
+	queue.draw(ren);
+	scale.present();
 	SDL_Delay(5000);
 
-	cleanup(background, image, ren, win);
-	IMG_Quit();
-	SDL_Quit();
-
 	return 0;
 }
+
+int main (int argc, char** argv) {
+	/* SDL initialization, only video is started, anything else is started
+	 * when it's first needed */
+	AppInit app(SDL_INIT_VIDEO);
+	if (!app) {
+		logSDLError(std::cout, "SDL_Init");
+		return 1;
+	}
+	/* SDL_image initialization, PNG is the only format the lesson loads */
+	if (!app.step("IMG_Init", []() { return (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != 0; }, IMG_Quit)) {
+		logSDLError(std::cout, "IMG_Init");
+		return 1;
+	}
+	//Read resources out of res.pak if it's been built
+	openResourcePack();
+	app.report(std::cout);
+
+	return run();
+}
@@ -2,118 +2,71 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <string>
+#include <vector>
 
 #include "res_path.h"
+#include "res_pack.h"
 #include "cleanup.h"
+#include "app_init.h"
+#include "async_loader.h"
+#include "file_watch.h"
+#include "lesson_image.h"
+#include "lesson_util.h"
+#include "profiler.h"
+#include "renderer_select.h"
+#include "replay.h"
+#include "retained_canvas.h"
+#include "texture_cache.h"
 
 //Screen attributes
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
+//Time each frame may spend turning decoded images into textures
+const double UPLOAD_BUDGET_MS = 4.0;
+//How long to sleep waiting for input, shorter while images are loading
+const int IDLE_WAIT_MS = 1000;
+const int LOADING_WAIT_MS = 5;
 
 /**
- * Log an SDL error with an error message to the output stream.
+ * Run the lesson, everything created here is freed when it returns
+ * so that happens before SDL_Quit.
  *
- * @param os  The output stream to write the message to.
- * @param msg The error message to write, with format "{msg} error: {SDL_GetError()}".
+ * @return The exit code for main.
  */
-void logSDLError(std::ostream& os, const std::string& msg) {
-	os << msg << " error: " << SDL_GetError() << std::endl;
-}
-
-/**
- * Loads an image into a texture on the rendering device.
- *
- * @param  file The image file to load.
- * @param  ren  The renderer to load the texture onto.
- * @return      The loaded texture, or nullptr if something went wrong.
- */
-SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren) {
-	SDL_Texture* texture = IMG_LoadTexture(ren, file.c_str());
-
-	if (texture == nullptr) {
-		logSDLError(std::cout, "LoadTexture");
-	}
-
-	return texture;
-}
-
-/**
- * Draw an SDL_Texture to an SDL_Renderer at (x,y), with
- * specified width and height.
- *
- * @param tex The source texture we want to draw.
- * @param ren [The renderer we want to draw to.
- * @param x   The x coordinate to draw to.
- * @param y   The y coordinate to draw to.
- * @param w   The width of the texture to draw.
- * @param h   The height of the texture to draw.
- */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, int w, int h) {
-	//Setup destination rectangle at given (x,y)
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-	dst.w = w;
-	dst.h = h;
-	SDL_RenderCopy(ren, tex, NULL, &dst);
-}
-
-/**
- * Draw an SDL_Texture to an SDL_Renderer at (x,y), preserving
- * the texture's width and height.
- *
- * @param tex The source texture we want to draw.
- * @param ren [The renderer we want to draw to.
- * @param x   The x coordinate to draw to.
- * @param y   The y coordinate to draw to.
- */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y) {
-	int w, h;
-	SDL_QueryTexture(tex, NULL, NULL, &w, &h);
-	renderTexture(tex, ren, x, y, w, h);
-}
-
-int main (int argc, char** argv) {
-	/* SDL initialization */
-	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-		logSDLError(std::cout, "SDL_Init");
-		return 1;
-	}
+int run() {
 	/* Window initialization */
-	SDL_Window* win = SDL_CreateWindow("Lesson 4", 100, 100,
-		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-	if (win == nullptr) {
+	UniqueWindow window(SDL_CreateWindow("Lesson 4", 100, 100,
+		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN));
+	if (!window) {
 		logSDLError(std::cout, "CreateWindow");
-		SDL_Quit();
 		return 1;
 	}
 	/* Renderer initialization */
-	SDL_Renderer *ren = SDL_CreateRenderer(win, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (ren == nullptr) {
+	UniqueRenderer renderer(createRenderer(window.get(),
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+	if (!renderer) {
 		logSDLError(std::cout, "CreateRenderer");
-		cleanup(win);
-		SDL_Quit();
 		return 1;
 	}
+	logRendererInfo(std::cout, renderer.get());
+	SDL_Renderer* ren = renderer.get();
 
 	/* Image initialization */
 	const std::string resPath = getResourcePath("Lesson4");
-	SDL_Texture* image = loadTexture(resPath + "image.png", ren);
-	if (image == nullptr) {
-		cleanup(image, ren, win);
-		SDL_Quit();
-		return 1;
-	}
+	//The image is decoded in the background while the event loop runs,
+	//so the window is up and responsive straight away. Once it's uploaded
+	//it's handed to the cache so later loads of the file share the texture
+	TextureCache textures(ren, loadTexture);
+	AsyncTextureLoader loader(ren);
+	const int imageId = loader.request(resPath + "image.png");
+	TextureHandle imageHandle;
 
 	/*********************
 	 * Foreground Drawing
 	 *********************/
-	int iW, iH;
-	SDL_QueryTexture(image, NULL, NULL, &iW, &iH);
-	int x = SCREEN_WIDTH / 2 - iW / 2;
-	int y = SCREEN_HEIGHT / 2 - iH / 2;
-	renderTexture(image, ren, x, y);
+	//Where to draw the image, known once it's loaded
+	int x = 0;
+	int y = 0;
 
 	/*********************
 	 * Input Handling
@@ -122,28 +75,116 @@ int main (int argc, char** argv) {
 	SDL_Event e;
 	//Track when to quit
 	bool quit = false;
+	//Track if the image failed to load
+	bool failed = false;
+	//Time spent on each part of the frame
+	Profiler& prof = profiler();
+	const int eventsScope = prof.scope("events");
+	const int drawScope = prof.scope("draw");
+	const int presentScope = prof.scope("present");
+	//The scene is only redrawn when it changes, the rest of the time the
+	//loop sleeps waiting for input
+	RetainedCanvas canvas(ren, SCREEN_WIDTH, SCREEN_HEIGHT);
+	//REPLAY_RECORD or REPLAY_PLAY record or play back a session's input
+	Replay replay;
+	if (!replay.configure()) {
+		return 1;
+	}
+	//The image is reloaded in place whenever it's saved, unless it's read
+	//out of res.pak
+	FileWatch watch;
+	if (!resourcePack().isOpen()) {
+		watch.watch(resPath);
+	}
+	std::vector<std::string> changed;
 
 	while (!quit) {
-		while (SDL_PollEvent(&e)) {
-			//Quit on any type of input
-			switch (e.type) {
-				case SDL_QUIT:
-				case SDL_KEYDOWN:
-				case SDL_MOUSEBUTTONDOWN:
-					quit = true;
+		//Recorded input is already waiting
+		if (!replay.playing()) {
+			canvas.wait(loader.idle() && !watch.settling() ? IDLE_WAIT_MS : LOADING_WAIT_MS);
+		}
+		if (!replay.beginFrame(nullptr)) {
+			break;
+		}
+		prof.beginFrame();
+		{
+			ProfileScope timer(eventsScope);
+			while (replay.pollEvent(&e)) {
+				canvas.handleEvent(e);
+				//Quit on any type of input
+				switch (e.type) {
+					case SDL_QUIT:
+					case SDL_KEYDOWN:
+					case SDL_MOUSEBUTTONDOWN:
+						quit = true;
+				}
+			}
+		}
+		//Upload what's been decoded, within this frame's budget
+		loader.upload(UPLOAD_BUDGET_MS);
+		if (!imageHandle && loader.ready(imageId)) {
+			imageHandle = textures.adopt(resPath + "image.png", loader.take(imageId));
+			if (!imageHandle) {
+				failed = quit = true;
+			} else {
+				int iW, iH;
+				SDL_QueryTexture(imageHandle.get(), NULL, NULL, &iW, &iH);
+				x = SCREEN_WIDTH / 2 - iW / 2;
+				y = SCREEN_HEIGHT / 2 - iH / 2;
+				const SDL_Rect area = {x, y, iW, iH};
+				canvas.invalidate(area);
+			}
+		}
+		if (imageHandle && watch.poll(changed) > 0 && textures.reloadChanged(changed) > 0) {
+			int iW, iH;
+			SDL_QueryTexture(imageHandle.get(), NULL, NULL, &iW, &iH);
+			x = SCREEN_WIDTH / 2 - iW / 2;
+			y = SCREEN_HEIGHT / 2 - iH / 2;
+			//The new image may not cover all of the old one
+			canvas.invalidate();
+		}
+		//Render, only if something changed
+		if (canvas.begin()) {
+			{
+				ProfileScope timer(drawScope);
+				//Draw the image
+				if (imageHandle) {
+					renderTexture(imageHandle.get(), ren, x, y);
+				}
+			}
+			//Update the screen, with vsync on this is where the frame waits
+			{
+				ProfileScope timer(presentScope);
+				replay.endFrame(ren);
+				canvas.present();
 			}
+			prof.endFrame();
+		} else {
+			//Nothing was drawn, so there's no frame to report
+			prof.discardFrame();
 		}
-		//Render
-		SDL_RenderClear(ren);
-		//Draw the image
-		renderTexture(image, ren, x, y);
-		//Update the screen
-		SDL_RenderPresent(ren);
 	}
+	prof.report(std::cout);
 
-	cleanup(image, ren, win);
-	IMG_Quit();
-	SDL_Quit();
+	return failed ? 1 : 0;
+}
+
+int main (int argc, char** argv) {
+	/* SDL initialization, only video is started, anything else is started
+	 * when it's first needed */
+	AppInit app(SDL_INIT_VIDEO);
+	if (!app) {
+		logSDLError(std::cout, "SDL_Init");
+		return 1;
+	}
+	/* SDL_image initialization, PNG is the only format the lesson loads */
+	if (!app.step("IMG_Init", []() { return (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != 0; }, IMG_Quit)) {
+		logSDLError(std::cout, "IMG_Init");
+		return 1;
+	}
+	//Read resources out of res.pak if it's been built
+	openResourcePack();
+	app.report(std::cout);
 
-	return 0;
+	return run();
 }
@@ -1,206 +1,318 @@
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <SDL.h>
 #include <SDL_image.h>
 #include <string>
+#include <vector>
 
 #include "res_path.h"
+#include "res_pack.h"
 #include "cleanup.h"
+#include "animation.h"
+#include "app_init.h"
+#include "async_loader.h"
+#include "camera.h"
+#include "game_loop.h"
+#include "input.h"
+#include "lesson_image.h"
+#include "lesson_util.h"
+#include "profiler.h"
+#include "renderer_select.h"
+#include "replay.h"
+#include "retained_canvas.h"
+#include "spatial_grid.h"
+#include "sprite_atlas.h"
+#include "sprite_batch.h"
+#include "texture_cache.h"
 
 //Screen attributes
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
+//How long to sleep waiting for input
+const int IDLE_WAIT_MS = 1000;
+//Simulation steps per second, the same whatever the display's refresh rate
+const double UPDATE_HZ = 60.0;
+//Frame cap for when vsync isn't available
+const double MAX_FPS = 240.0;
+//How fast the arrow keys scroll the tiles, in pixels per second
+const double SCROLL_SPEED = 240.0;
+//The size of the world in tiles, far bigger than the screen
+const int WORLD_COLUMNS = 64;
+const int WORLD_ROWS = 64;
+//The size of the spatial grid's cells, a few tiles across
+const int GRID_CELL_SIZE = 256;
+//How long each clip is shown while the tiles are animating, in seconds
+const float ANIMATION_FRAME_TIME = 0.25f;
 
-/**
- * Log an SDL error with an error message to the output stream.
- *
- * @param os  The output stream to write the message to.
- * @param msg The error message to write, with format "{msg} error: {SDL_GetError()}".
- */
-void logSDLError(std::ostream& os, const std::string& msg) {
-	os << msg << " error: " << SDL_GetError() << std::endl;
-}
-
-/**
- * Loads an image into a texture on the rendering device.
- *
- * @param  file The image file to load.
- * @param  ren  The renderer to load the texture onto.
- * @return      The loaded texture, or nullptr if something went wrong.
- */
-SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren) {
-	SDL_Texture* texture = IMG_LoadTexture(ren, file.c_str());
-
-	if (texture == nullptr) {
-		logSDLError(std::cout, "LoadTexture");
-	}
-
-	return texture;
-}
-
-/**
- * Draw an SDL_Texture to an SDL_Renderer at some destination
- * rectangle, with optional clipping rectangle.
- *
- * @param tex  The source texture we want to draw.
- * @param ren  The renderer we want to draw to.
- * @param dst  The destination rectangle to render the texture to.
- * @param clip The sub-section of the texture to draw, default nullptr
- *             	  draws the entire texture.
- */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, SDL_Rect dst,
-		SDL_Rect* clip = nullptr) {
-	SDL_RenderCopy(ren, tex, clip, &dst);
-}
+//What the keys do, CLIP_1 to CLIP_4 pick the clip to draw and ANIMATE
+//cycles every tile through the clips
+enum Action {
+	CLIP_1,
+	CLIP_2,
+	CLIP_3,
+	CLIP_4,
+	ANIMATE,
+	SCROLL_LEFT,
+	SCROLL_RIGHT,
+	SCROLL_UP,
+	SCROLL_DOWN,
+	QUIT
+};
 
 /**
- * Draw an SDL_Texture to an SDL_Renderer at (x,y), preserving
- * the texture's width and height and optionally taking a clip of
- * the texture. If a clip is passed, the clip's width and height
- * will be used instead of the texture's.
+ * Run the lesson, everything created here is freed when it returns
+ * so that happens before SDL_Quit.
  *
- * @param tex  The source texture we want to draw.
- * @param ren  The renderer we want to draw to.
- * @param x    The x coordinate to draw to.
- * @param y    The y coordinate to draw to.
- * @param clip The sub-section of the texture to draw, default nullptr
- *                draws the entire texture.
+ * @return The exit code for main.
  */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, const int x, const int y,
-		SDL_Rect* clip = nullptr) {
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-
-	if (clip != nullptr) {
-		dst.w = clip->w;
-		dst.h = clip->h;
-	} else {
-		SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
-	}
-
-	renderTexture(tex, ren, dst, clip);
-}
-
-int main (int argc, char** argv) {
-	/******************************
-	 * Initialization
-	 ******************************/
-	/* SDL initialization */
-	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-		logSDLError(std::cout, "SDL_Init");
-		return 1;
-	}
+int run() {
 	/* Window initialization */
-	SDL_Window* win = SDL_CreateWindow("Lesson 5", 100, 100,
-		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-	if (win == nullptr) {
+	UniqueWindow window(SDL_CreateWindow("Lesson 5", 100, 100,
+		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN));
+	if (!window) {
 		logSDLError(std::cout, "CreateWindow");
-		SDL_Quit();
 		return 1;
 	}
 	/* Renderer initialization */
-	SDL_Renderer *ren = SDL_CreateRenderer(win, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (ren == nullptr) {
+	UniqueRenderer renderer(createRenderer(window.get(),
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+	if (!renderer) {
 		logSDLError(std::cout, "CreateRenderer");
-		cleanup(win);
-		SDL_Quit();
 		return 1;
 	}
+	logRendererInfo(std::cout, renderer.get());
+	SDL_Renderer* ren = renderer.get();
 
 	/* Image initialization */
 	const std::string resPath = getResourcePath("Lesson5");
-	SDL_Texture* image = loadTexture(resPath + "image.png", ren);
-	if (image == nullptr) {
-		cleanup(image, ren, win);
-		SDL_Quit();
+	//The clips are read from the sheet's atlas instead of assuming a grid
+	SpriteAtlas atlas;
+	if (!atlas.load(resPath + "image.atlas") || atlas.pageCount() == 0) {
+		return 1;
+	}
+	//Show the window straight away instead of once everything is loaded
+	SDL_RenderClear(ren);
+	SDL_RenderPresent(ren);
+	//The sheet is decoded on a worker thread, then handed to the cache so
+	//the atlas and any later loads of the same file share the texture
+	TextureCache textures(ren, loadTexture);
+	AsyncTextureLoader loader(ren);
+	const int imageId = loader.request(atlas.pageFile(0));
+	loader.finish();
+	TextureHandle imageHandle = textures.adopt(atlas.pageFile(0), loader.take(imageId));
+	loader.stop();
+	if (!imageHandle || !atlas.loadPages(textures)) {
 		return 1;
 	}
 
 	/******************************
 	 * Image Drawing
 	 ******************************/
-	//Image width & height
-	int imageW, imageH; //These need to be const somehow
-	SDL_QueryTexture(image, NULL, NULL, &imageW, &imageH);
-	//Clip width & height
-	const int tileW = 100;
-	const int tileH = 100;
-	//Number of tiles
-	const int xTiles = imageW / tileW;
-	const int yTiles = imageH / tileH;
-	const int totalTiles = xTiles * yTiles;
-
-	//Build clips
-	SDL_Rect clips[totalTiles];
-	for (int i = 0; i < totalTiles; i++) {
-		clips[i].x = i / yTiles * tileW;
-		clips[i].y = i % yTiles * tileH;
-		clips[i].w = tileW;
-		clips[i].h = tileH;
+	//Look the clips up once, after that each one is an index into the atlas
+	const int totalClips = 4;
+	int clips[totalClips];
+	for (int i = 0; i < totalClips; i++) {
+		clips[i] = atlas.find("image_" + std::to_string(i));
+		if (clips[i] < 0) {
+			std::cout << "Missing clip image_" << i << std::endl;
+			return 1;
+		}
 	}
+	//Clip width & height
+	const int tileW = atlas.region(clips[0]).w;
+	const int tileH = atlas.region(clips[0]).h;
 
 	int useClip = 0;
+	//The clips played in order, every tile plays it a little behind the
+	//one to its left so a wave runs across the world
+	AnimationSet animations;
+	const int cycle = animations.add(clips, totalClips, ANIMATION_FRAME_TIME);
+	Animator animator(animations);
+	bool animating = false;
 
-	//Screen grid numbers
-	//Fill in extra space if screen is not a multiple of tilesize
-	const int xScreenTiles = SCREEN_WIDTH / tileW
-		+ (SCREEN_WIDTH % tileW != 0 ? 1 : 0);
-	const int yScreenTiles = SCREEN_HEIGHT / tileH
-		+ (SCREEN_HEIGHT % tileH != 0 ? 1 : 0);
-	const int totalScreenTiles = xScreenTiles * yScreenTiles;
+	//Every tile in the world goes in a spatial grid, so each frame only
+	//the tiles the camera can see are looked at and drawn
+	const SDL_Rect world = {0, 0, WORLD_COLUMNS * tileW, WORLD_ROWS * tileH};
+	SpatialGrid grid(world, GRID_CELL_SIZE);
+	for (int row = 0; row < WORLD_ROWS; row++) {
+		for (int col = 0; col < WORLD_COLUMNS; col++) {
+			const SDL_Rect bounds = {col * tileW, row * tileH, tileW, tileH};
+			//The grid and the animator number the tiles the same way
+			grid.insert(bounds);
+			animator.add(cycle, (col + row) * ANIMATION_FRAME_TIME / 4);
+		}
+	}
+	Camera camera(SCREEN_WIDTH, SCREEN_HEIGHT);
+	camera.setBounds(world);
+	//The furthest the camera can scroll
+	const double maxScrollX = world.w > SCREEN_WIDTH ? world.w - SCREEN_WIDTH : 0;
+	const double maxScrollY = world.h > SCREEN_HEIGHT ? world.h - SCREEN_HEIGHT : 0;
+	std::vector<int> visible;
+	//The scroll position at the last two simulation steps, drawn part way
+	//between them so the motion is smooth at any frame rate
+	double scrollX = 0, scrollY = 0;
+	double prevScrollX = 0, prevScrollY = 0;
+	//The scroll offset the canvas was last drawn at
+	int drawnX = 0, drawnY = 0;
+	//The visible tiles are queued up and drawn together each frame
+	SpriteBatch tiles;
 
 	/******************************
 	 * Input Handling
 	 ******************************/
-	//Event structure
-	SDL_Event e;
+	//Keys are bound to actions once, instead of a switch in the event loop
+	Input input;
+	input.bindKey(SDL_SCANCODE_1, CLIP_1);
+	input.bindKey(SDL_SCANCODE_KP_1, CLIP_1);
+	input.bindKey(SDL_SCANCODE_2, CLIP_2);
+	input.bindKey(SDL_SCANCODE_KP_2, CLIP_2);
+	input.bindKey(SDL_SCANCODE_3, CLIP_3);
+	input.bindKey(SDL_SCANCODE_KP_3, CLIP_3);
+	input.bindKey(SDL_SCANCODE_4, CLIP_4);
+	input.bindKey(SDL_SCANCODE_KP_4, CLIP_4);
+	input.bindKey(SDL_SCANCODE_SPACE, ANIMATE);
+	input.bindKey(SDL_SCANCODE_LEFT, SCROLL_LEFT);
+	input.bindKey(SDL_SCANCODE_RIGHT, SCROLL_RIGHT);
+	input.bindKey(SDL_SCANCODE_UP, SCROLL_UP);
+	input.bindKey(SDL_SCANCODE_DOWN, SCROLL_DOWN);
+	input.bindKey(SDL_SCANCODE_ESCAPE, QUIT);
 	//Track when to quit
 	bool quit = false;
+	//Time spent on each part of the frame
+	Profiler& prof = profiler();
+	const int eventsScope = prof.scope("events");
+	const int drawScope = prof.scope("draw");
+	const int presentScope = prof.scope("present");
+	//The tiles only change when a different clip is picked or they're
+	//scrolled, so the rest of the time the loop sleeps waiting for input
+	RetainedCanvas canvas(ren, SCREEN_WIDTH, SCREEN_HEIGHT);
+	GameLoop loop(UPDATE_HZ);
+	loop.setFrameLimit(MAX_FPS);
+	bool scrolling = false;
+	//REPLAY_RECORD or REPLAY_PLAY record or play back a session's input,
+	//which is tracked from the events so a replay sees exactly what was
+	//recorded
+	Replay replay;
+	if (!replay.configure()) {
+		return 1;
+	}
+	if (replay.recording() || replay.playing()) {
+		input.setEventState(true);
+	}
+	if (replay.playing()) {
+		//Play back as fast as the frames can be drawn
+		loop.setFrameLimit(0);
+	}
 
 	while (!quit) {
-		while (SDL_PollEvent(&e)) {
-			if (e.type == SDL_QUIT) {
-				quit = true;
-			} else if (e.type == SDL_KEYDOWN) {
-				switch (e.key.keysym.sym) {
-					case SDLK_1:
-					case SDLK_KP_1:
-						useClip = 0;
-						break;
-					case SDLK_2:
-					case SDLK_KP_2:
-						useClip = 1;
-						break;
-					case SDLK_3:
-					case SDLK_KP_3:
-						useClip = 2;
-						break;
-					case SDLK_4:
-					case SDLK_KP_4:
-						useClip = 3;
-						break;
-					case SDLK_ESCAPE:
-						quit = true;
-						break;
+		if (!scrolling && !animating) {
+			//Recorded input is already waiting
+			if (!replay.playing()) {
+				canvas.wait(IDLE_WAIT_MS);
+			}
+			//Don't catch up on the time spent asleep
+			loop.reset();
+		}
+		if (!replay.beginFrame(&loop)) {
+			break;
+		}
+		prof.beginFrame();
+		const int lastClip = useClip;
+		{
+			ProfileScope timer(eventsScope);
+			input.update();
+			for (int i = 0; i < input.eventCount(); i++) {
+				canvas.handleEvent(input.event(i));
+			}
+			quit = input.quitRequested() || input.pressed(QUIT);
+			for (int clip = CLIP_1; clip <= CLIP_4; clip++) {
+				if (input.pressed(clip)) {
+					useClip = clip - CLIP_1;
+					animating = false;
 				}
 			}
+			if (input.pressed(ANIMATE)) {
+				animating = !animating;
+				canvas.invalidate();
+			}
+		}
+		//Move the tiles at a fixed rate, however often frames are drawn
+		const int dx = input.down(SCROLL_RIGHT) - input.down(SCROLL_LEFT);
+		const int dy = input.down(SCROLL_DOWN) - input.down(SCROLL_UP);
+		while (loop.step()) {
+			prevScrollX = scrollX;
+			prevScrollY = scrollY;
+			scrollX = std::min(std::max(scrollX + dx * SCROLL_SPEED * loop.dt(), 0.0), maxScrollX);
+			scrollY = std::min(std::max(scrollY + dy * SCROLL_SPEED * loop.dt(), 0.0), maxScrollY);
+			if (animating) {
+				animator.update(static_cast<float>(loop.dt()));
+			}
+		}
+		//Holding a key against the edge of the world doesn't move anything
+		scrolling = prevScrollX != scrollX || prevScrollY != scrollY
+			|| (dx != 0 && scrollX != (dx < 0 ? 0.0 : maxScrollX))
+			|| (dy != 0 && scrollY != (dy < 0 ? 0.0 : maxScrollY));
+		const double alpha = loop.alpha();
+		const int offsetX = static_cast<int>(std::floor(prevScrollX + (scrollX - prevScrollX) * alpha));
+		const int offsetY = static_cast<int>(std::floor(prevScrollY + (scrollY - prevScrollY) * alpha));
+		if (animating || useClip != lastClip || offsetX != drawnX || offsetY != drawnY) {
+			canvas.invalidate();
 		}
-		//Render
-		SDL_RenderClear(ren);
-		//Draw the image
-		for (int i = 0; i < totalScreenTiles; i++) {
-			int x = i / yScreenTiles * tileW;
-			int y = i % yScreenTiles * tileH;
-			renderTexture(image, ren, x, y, &clips[useClip]);
+		//Render, only if something changed
+		if (canvas.begin()) {
+			{
+				ProfileScope timer(drawScope);
+				//Draw the image
+				drawnX = offsetX;
+				drawnY = offsetY;
+				camera.moveTo(offsetX, offsetY);
+				grid.query(camera.view(), visible);
+				tiles.clear();
+				for (std::vector<int>::size_type i = 0; i < visible.size(); i++) {
+					const int clip = animating ? animator.clip(visible[i]) : clips[useClip];
+					tiles.add(camera.toScreen(grid.bounds(visible[i])), &atlas.region(clip));
+				}
+				//The clips are all on the sheet's one page
+				tiles.draw(ren, atlas.texture(clips[useClip]));
+			}
+			//Update the screen, with vsync on this is where the frame waits
+			{
+				ProfileScope timer(presentScope);
+				replay.endFrame(ren);
+				canvas.present();
+			}
+			prof.endFrame();
+		} else {
+			//Nothing was drawn, so there's no frame to report
+			prof.discardFrame();
 		}
-		//Update the screen
-		SDL_RenderPresent(ren);
+		loop.endFrame();
 	}
-
-	cleanup(image, ren, win);
-	IMG_Quit();
-	SDL_Quit();
+	prof.report(std::cout);
 
 	return 0;
 }
+
+int main (int argc, char** argv) {
+	/******************************
+	 * Initialization
+	 ******************************/
+	/* SDL initialization, only video is started, anything else is started
+	 * when it's first needed */
+	AppInit app(SDL_INIT_VIDEO);
+	if (!app) {
+		logSDLError(std::cout, "SDL_Init");
+		return 1;
+	}
+	/* SDL_image initialization, PNG is the only format the lesson loads */
+	if (!app.step("IMG_Init", []() { return (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != 0; }, IMG_Quit)) {
+		logSDLError(std::cout, "IMG_Init");
+		return 1;
+	}
+	//Read resources out of res.pak if it's been built
+	openResourcePack();
+	app.report(std::cout);
+
+	return run();
+}
@@ -4,152 +4,71 @@
 #include <string>
 
 #include "res_path.h"
+#include "res_pack.h"
 #include "cleanup.h"
+#include "app_init.h"
+#include "lesson_util.h"
+#include "profiler.h"
+#include "profiler_overlay.h"
+#include "renderer_select.h"
+#include "replay.h"
+#include "retained_canvas.h"
+#include "text_atlas.h"
+#include "text_cache.h"
 
 //Screen attributes
 const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
+//How long to sleep waiting for input
+const int IDLE_WAIT_MS = 1000;
 
 /**
- * Log an SDL error with an error message to the output stream.
+ * Run the lesson, everything created here is freed when it returns
+ * so that happens before SDL_Quit.
  *
- * @param os  The output stream to write the message to.
- * @param msg The error message to write, with format "{msg} error: {SDL_GetError()}".
+ * @return The exit code for main.
  */
-void logSDLError(std::ostream& os, const std::string& msg) {
-	os << msg << " error: " << SDL_GetError() << std::endl;
-}
-
-/**
- * Draw an SDL_Texture to an SDL_Renderer at some destination
- * rectangle, with optional clipping rectangle.
- *
- * @param tex  The source texture we want to draw.
- * @param ren  The renderer we want to draw to.
- * @param dst  The destination rectangle to render the texture to.
- * @param clip The sub-section of the texture to draw, default nullptr
- *             	  draws the entire texture.
- */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, SDL_Rect dst,
-		SDL_Rect* clip = nullptr) {
-	SDL_RenderCopy(ren, tex, clip, &dst);
-}
-
-/**
- * Draw an SDL_Texture to an SDL_Renderer at (x,y), preserving
- * the texture's width and height and optionally taking a clip of
- * the texture. If a clip is passed, the clip's width and height
- * will be used instead of the texture's.
- *
- * @param tex  The source texture we want to draw.
- * @param ren  The renderer we want to draw to.
- * @param x    The x coordinate to draw to.
- * @param y    The y coordinate to draw to.
- * @param clip The sub-section of the texture to draw, default nullptr
- *                draws the entire texture.
- */
-void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, const int x, const int y,
-		SDL_Rect* clip = nullptr) {
-	SDL_Rect dst;
-	dst.x = x;
-	dst.y = y;
-
-	if (clip != nullptr) {
-		dst.w = clip->w;
-		dst.h = clip->h;
-	} else {
-		SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
-	}
-
-	renderTexture(tex, ren, dst, clip);
-}
-
-/**
- * Render the message to display to a texture for drawing.
- *
- * @param  message  The message to display.
- * @param  fontFile The font to use to render the text.
- * @param  color    The text color.
- * @param  fontSize The text size.
- * @param  renderer The renderer to load the texture in.
- * @return          An SDL_Texture containing the renderered message,
- *                     or nullptr if something went wrong.
- */
-SDL_Texture* renderText(const std::string& message, const std::string& fontFile,
-	SDL_Color color, int fontSize, SDL_Renderer* renderer) {
-	//Open the font
-	//**NOTE: It's very inefficient to constantly and open the font,
-	//but it's okay for our purposes for now.
-	TTF_Font* font = TTF_OpenFont(fontFile.c_str(), fontSize);
-	if (font == nullptr) {
-		logSDLError(std::cout, "TTF_OpenFont");
-		return nullptr;
-	}
-	//TTF_RenderText returns a surface to render to, then load it into a texture
-	SDL_Surface* surf = TTF_RenderText_Blended(font, message.c_str(), color);
-	if (surf == nullptr) {
-		TTF_CloseFont(font);
-		logSDLError(std::cout, "TTF_RenderText");
-		return nullptr;
-	}
-	SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surf);
-	if (texture == nullptr) {
-		logSDLError(std::cout, "CreateTexture");
-	}
-	//Clean up the surface and font
-	SDL_FreeSurface(surf);
-	TTF_CloseFont(font);
-	return texture;
-}
-
-int main (int argc, char** argv) {
-	/******************************
-	 * Initialization
-	 ******************************/
-	/* SDL initialization */
-	if (SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-		logSDLError(std::cout, "SDL_Init");
-		return 1;
-	}
-	/* SDL_ttf initialization */
-	if (TTF_Init() != 0) {
-		logSDLError(std::cout, "TTF_Init");
-		SDL_Quit();
-		return 1;
-	}
+int run() {
 	/* Window initialization */
-	SDL_Window* win = SDL_CreateWindow("Lesson 5", 100, 100,
-		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-	if (win == nullptr) {
+	UniqueWindow window(SDL_CreateWindow("Lesson 5", 100, 100,
+		SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN));
+	if (!window) {
 		logSDLError(std::cout, "CreateWindow");
-		SDL_Quit();
 		return 1;
 	}
 	/* Renderer initialization */
-	SDL_Renderer *ren = SDL_CreateRenderer(win, -1,
-		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-	if (ren == nullptr) {
+	UniqueRenderer renderer(createRenderer(window.get(),
+		SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC));
+	if (!renderer) {
 		logSDLError(std::cout, "CreateRenderer");
-		cleanup(win);
-		SDL_Quit();
 		return 1;
 	}
+	logRendererInfo(std::cout, renderer.get());
+	SDL_Renderer* ren = renderer.get();
 
-	/* Texture initialization */
+	/* Font initialization */
 	const std::string resPath = getResourcePath("Lesson6");
-	//Color is in RGBa format
-	SDL_Color color = {255, 255, 255, 255};
-	SDL_Texture* image = renderText("TTF fonts are neat!",
-		resPath + "OpenSans-Regular.ttf", color, 64, ren);
-	if (image == nullptr) {
-		cleanup(ren, win);
-		TTF_Quit();
-		SDL_Quit();
+	//Fonts stay open in the cache so they're only loaded once per size
+	FontCache fonts;
+	TTF_Font* font = fonts.get(resPath + "OpenSans-Regular.ttf", 64);
+	TTF_Font* overlayFont = fonts.get(resPath + "OpenSans-Regular.ttf", 14);
+	//The overlay's text changes every frame so it's drawn a glyph at a time
+	//out of an atlas, every glyph is rendered once up front
+	GlyphAtlas overlayAtlas;
+	if (font == nullptr || overlayFont == nullptr || !overlayAtlas.build(overlayFont, ren)) {
 		return 1;
 	}
+	//Static labels are rendered once into their own texture and kept
+	//until the cache's budget pushes them out
+	TextCache labels(ren);
 
+	const std::string message = "TTF fonts are neat!";
+	//Color is in RGBa format
+	SDL_Color color = {255, 255, 255, 255};
 	int iW, iH;
-	SDL_QueryTexture(image, NULL, NULL, &iW, &iH);
+	if (labels.get(font, message, color, &iW, &iH) == nullptr) {
+		return 1;
+	}
 	const int x = SCREEN_WIDTH / 2 - iW / 2;
 	const int y = SCREEN_HEIGHT / 2 - iH / 2;
 
@@ -158,27 +77,95 @@ int main (int argc, char** argv) {
 	 ******************************/
 	SDL_Event e;
 	bool quit = false;
+	//F3 toggles the profiler overlay
+	bool showProfiler = false;
+	//Time spent on each part of the frame
+	Profiler& prof = profiler();
+	const int eventsScope = prof.scope("events");
+	const int drawScope = prof.scope("draw");
+	const int presentScope = prof.scope("present");
+	//The text never changes, so it's only drawn again when the window needs
+	//it and the loop sleeps waiting for input the rest of the time
+	RetainedCanvas canvas(ren, SCREEN_WIDTH, SCREEN_HEIGHT);
+	//REPLAY_RECORD or REPLAY_PLAY record or play back a session's input
+	Replay replay;
+	if (!replay.configure()) {
+		return 1;
+	}
 
 	while (!quit) {
-		while (SDL_PollEvent(&e)) {
-			if (e.type == SDL_QUIT ||
-				(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)) {
-				quit = true;
+		//Recorded input is already waiting, and the overlay's numbers change
+		//every frame so there's nothing to wait for while it's up
+		if (!replay.playing() && !showProfiler) {
+			canvas.wait(IDLE_WAIT_MS);
+		}
+		if (!replay.beginFrame(nullptr)) {
+			break;
+		}
+		prof.beginFrame();
+		{
+			ProfileScope timer(eventsScope);
+			while (replay.pollEvent(&e)) {
+				canvas.handleEvent(e);
+				if (e.type == SDL_QUIT ||
+					(e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_ESCAPE)) {
+					quit = true;
+				} else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3) {
+					showProfiler = !showProfiler;
+					canvas.invalidate();
+				}
+			}
+		}
+		//The overlay's numbers change every frame
+		if (showProfiler) {
+			canvas.invalidate();
+		}
+		if (canvas.begin()) {
+			{
+				ProfileScope timer(drawScope);
+				//A cache hit, the message isn't rendered again
+				renderTexture(labels.get(font, message, color), ren, x, y);
+				if (showProfiler) {
+					drawProfilerOverlay(ren, overlayAtlas, 0, 0);
+				}
+			}
+			//With vsync on this is where the frame waits
+			{
+				ProfileScope timer(presentScope);
+				replay.endFrame(ren);
+				canvas.present();
 			}
+			prof.endFrame();
+		} else {
+			//Nothing was drawn, so there's no frame to report
+			prof.discardFrame();
 		}
-		SDL_RenderClear(ren);
-		//Text is drawn just like any other texture,
-		//since it's been rendered to a texture.
-		renderTexture(image, ren, x, y);
-		SDL_RenderPresent(ren);
 	}
+	prof.report(std::cout);
+
+	return 0;
+}
 
+int main (int argc, char** argv) {
 	/******************************
-	 * Clean up
+	 * Initialization
 	 ******************************/
-	cleanup(image, ren, win);
-	TTF_Quit();
-	SDL_Quit();
+	/* SDL initialization, only video is started, anything else is started
+	 * when it's first needed */
+	AppInit app(SDL_INIT_VIDEO);
+	if (!app) {
+		logSDLError(std::cout, "SDL_Init");
+		return 1;
+	}
+	//Read resources out of res.pak if it's been built
+	openResourcePack();
+	/* SDL_ttf initialization */
+	if (!app.step("TTF_Init", []() { return TTF_Init() == 0; }, TTF_Quit)) {
+		logSDLError(std::cout, "TTF_Init");
+		return 1;
+	}
+	app.report(std::cout);
 
-	return 0;
+	//SDL_ttf and SDL are shut down when app goes out of scope
+	return run();
 }
@@ -0,0 +1,698 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+
+#include "res_path.h"
+#include "res_pack.h"
+#include "cleanup.h"
+#include "app_init.h"
+#include "command_buffer.h"
+#include "entity_store.h"
+#include "frame_arena.h"
+#include "lesson_util.h"
+#include "profiler.h"
+#include "renderer_select.h"
+#include "sprite_batch.h"
+#include "streaming_texture.h"
+#include "text_atlas.h"
+#include "texture_budget.h"
+#include "tilemap.h"
+
+/*
+ * Headless benchmark of the lessons' render paths: the Lesson3 background
+ * tiling, a large tilemap, the Lesson5 clip grid, the Lesson6 text
+ * drawing, thousands of culled sprites recorded across threads, 100k
+ * entities moved and drawn from component arrays and a streaming
+ * texture written on the CPU, each run for a fixed number of
+ * frames with vsync off. Prints one JSON object per line per scenario so
+ * results can be compared between builds. Naming a render driver, such
+ * as opengl, times that driver so the drivers can be compared.
+ *
+ * Usage: bench [--frames N] [--renderer offscreen|software|accelerated|DRIVER]
+ *              [--scenario tiles|tilemap|clips|text|commands|entities|stream]
+ */
+
+//Screen attributes, the same as the lessons
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int TILE_SIZE = 40;
+//Frames drawn before timing starts, so buffers have already grown
+const int WARMUP_FRAMES = 16;
+
+/******************************
+ * Allocation Counting
+ ******************************/
+static SDL_atomic_t cppAllocs;
+static SDL_atomic_t sdlAllocs;
+
+void* operator new(std::size_t size) {
+	SDL_AtomicAdd(&cppAllocs, 1);
+	void* p = std::malloc(size != 0 ? size : 1);
+	if (p == nullptr) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 7)
+static SDL_malloc_func sdlMalloc;
+static SDL_calloc_func sdlCalloc;
+static SDL_realloc_func sdlRealloc;
+static SDL_free_func sdlFree;
+
+static void* SDLCALL countMalloc(size_t size) {
+	SDL_AtomicAdd(&sdlAllocs, 1);
+	return sdlMalloc(size);
+}
+
+static void* SDLCALL countCalloc(size_t nmemb, size_t size) {
+	SDL_AtomicAdd(&sdlAllocs, 1);
+	return sdlCalloc(nmemb, size);
+}
+
+static void* SDLCALL countRealloc(void* mem, size_t size) {
+	SDL_AtomicAdd(&sdlAllocs, 1);
+	return sdlRealloc(mem, size);
+}
+
+/**
+ * Route SDL's own allocations through the counter, this has to happen
+ * before SDL allocates anything.
+ */
+void countSDLAllocations() {
+	SDL_GetMemoryFunctions(&sdlMalloc, &sdlCalloc, &sdlRealloc, &sdlFree);
+	SDL_SetMemoryFunctions(countMalloc, countCalloc, countRealloc, sdlFree);
+}
+#else
+void countSDLAllocations() {}
+#endif
+
+/**
+ * Loads an image into a texture on the rendering device, always decoding
+ * the image so runs compare the same texture whether or not texconv has
+ * made a .tex of it. Errors go to stderr so stdout stays JSON.
+ *
+ * @param  file The image file to load.
+ * @param  ren  The renderer to load the texture onto.
+ * @return      The loaded texture, or nullptr if something went wrong.
+ */
+SDL_Texture* loadImageTexture(const std::string& file, SDL_Renderer* ren) {
+	SDL_Texture* texture = IMG_LoadTexture_RW(ren, openResource(file), 1);
+
+	if (texture == nullptr) {
+		logSDLError(std::cerr, "LoadImageTexture");
+	}
+	trackTexture(texture);
+
+	return texture;
+}
+
+/******************************
+ * Scenarios
+ ******************************/
+/**
+ * One lesson's render path. frame() draws a single frame between the
+ * harness's clear and present, and returns how many sprites it drew.
+ */
+class Scenario {
+public:
+	virtual ~Scenario() {}
+	virtual const char* name() const = 0;
+	virtual bool setup(SDL_Renderer* ren) = 0;
+	virtual int frame(SDL_Renderer* ren, int index) = 0;
+	virtual void teardown() = 0;
+};
+
+/**
+ * Lesson3: the background scaled into TILE_SIZE tiles across the screen,
+ * with the image drawn in the middle.
+ */
+class TilesScenario : public Scenario {
+public:
+	const char* name() const {
+		return "tiles";
+	}
+	bool setup(SDL_Renderer* ren) {
+		const std::string resPath = getResourcePath("Lesson3");
+		background.reset(loadImageTexture(resPath + "background.png", ren));
+		image.reset(loadImageTexture(resPath + "image.png", ren));
+		if (!background || !image) {
+			return false;
+		}
+		SDL_QueryTexture(image.get(), NULL, NULL, &imageRect.w, &imageRect.h);
+		imageRect.x = SCREEN_WIDTH / 2 - imageRect.w / 2;
+		imageRect.y = SCREEN_HEIGHT / 2 - imageRect.h / 2;
+		return true;
+	}
+	int frame(SDL_Renderer* ren, int) {
+		const int xTiles = SCREEN_WIDTH / TILE_SIZE;
+		const int yTiles = SCREEN_HEIGHT / TILE_SIZE;
+		tiles.clear();
+		for (int i = 0; i < xTiles * yTiles; i++) {
+			SDL_Rect dst = {i % xTiles * TILE_SIZE, i / xTiles * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+			tiles.add(dst);
+		}
+		tiles.draw(ren, background.get());
+		profiler().countDraw(image.get());
+		SDL_RenderCopy(ren, image.get(), NULL, &imageRect);
+		return tiles.size() + 1;
+	}
+	void teardown() {
+		background.reset();
+		image.reset();
+	}
+
+private:
+	UniqueTexture background;
+	UniqueTexture image;
+	SDL_Rect imageRect;
+	SpriteBatch tiles;
+};
+
+/**
+ * A 1000x1000 tile map of the Lesson3 background drawn through a TileLayer,
+ * with the camera panning diagonally across it.
+ */
+class TileMapScenario : public Scenario {
+public:
+	const char* name() const {
+		return "tilemap";
+	}
+	bool setup(SDL_Renderer* ren) {
+		background.reset(loadImageTexture(getResourcePath("Lesson3") + "background.png", ren));
+		if (!background) {
+			return false;
+		}
+		layer.reset(new TileLayer(background.get(), MAP_TILES, MAP_TILES, TILE_SIZE));
+		layer->fill(layer->addTile());
+		return true;
+	}
+	int frame(SDL_Renderer* ren, int index) {
+		//Pan a few pixels a frame so chunks keep coming into view
+		const int range = MAP_TILES * TILE_SIZE - SCREEN_WIDTH;
+		const int offset = index * 7 % range;
+		const SDL_Rect camera = {offset, offset * SCREEN_HEIGHT / SCREEN_WIDTH,
+			SCREEN_WIDTH, SCREEN_HEIGHT};
+		//The chunks it copied, or the tiles without render targets
+		return layer->draw(ren, camera);
+	}
+	void teardown() {
+		layer.reset();
+		background.reset();
+	}
+
+private:
+	static const int MAP_TILES = 1000;
+	UniqueTexture background;
+	std::unique_ptr<TileLayer> layer;
+};
+
+/**
+ * Lesson5: the screen filled with 100x100 clips of the sprite sheet,
+ * switching clip every frame.
+ */
+class ClipsScenario : public Scenario {
+public:
+	const char* name() const {
+		return "clips";
+	}
+	bool setup(SDL_Renderer* ren) {
+		image.reset(loadImageTexture(getResourcePath("Lesson5") + "image.png", ren));
+		return image != nullptr;
+	}
+	int frame(SDL_Renderer* ren, int index) {
+		const int tileW = 100;
+		const int tileH = 100;
+		const int xScreenTiles = SCREEN_WIDTH / tileW + (SCREEN_WIDTH % tileW != 0 ? 1 : 0);
+		const int yScreenTiles = SCREEN_HEIGHT / tileH + (SCREEN_HEIGHT % tileH != 0 ? 1 : 0);
+		//The sheet is 2x2 clips laid out in columns
+		const int useClip = index % 4;
+		const SDL_Rect clip = {useClip / 2 * tileW, useClip % 2 * tileH, tileW, tileH};
+		tiles.clear();
+		for (int i = 0; i < xScreenTiles * yScreenTiles; i++) {
+			SDL_Rect dst = {i / yScreenTiles * tileW, i % yScreenTiles * tileH, tileW, tileH};
+			tiles.add(dst, &clip);
+		}
+		tiles.draw(ren, image.get());
+		return tiles.size();
+	}
+	void teardown() {
+		image.reset();
+	}
+
+private:
+	UniqueTexture image;
+	SpriteBatch tiles;
+};
+
+/**
+ * Lesson6: a line of 64pt text that changes every frame, drawn from the
+ * glyph atlas.
+ */
+class TextScenario : public Scenario {
+public:
+	const char* name() const {
+		return "text";
+	}
+	bool setup(SDL_Renderer* ren) {
+		TTF_Font* font = fonts.get(getResourcePath("Lesson6") + "OpenSans-Regular.ttf", 64);
+		return font != nullptr && atlas.build(font, ren);
+	}
+	int frame(SDL_Renderer* ren, int index) {
+		const SDL_Color color = {255, 255, 255, 255};
+		char message[64];
+		const int len = std::snprintf(message, sizeof(message), "Frame %d: TTF fonts are neat!", index);
+		atlas.draw(ren, message, 0, SCREEN_HEIGHT / 2, color);
+		return len;
+	}
+	void teardown() {
+		atlas.clear();
+		fonts.clear();
+	}
+
+private:
+	FontCache fonts;
+	GlyphAtlas atlas;
+};
+
+/**
+ * Thousands of moving sprites spread over a world larger than the screen,
+ * culled and recorded into command buffers on every core then sorted by
+ * texture and submitted, with a line of text on top.
+ */
+class CommandsScenario : public Scenario {
+public:
+	const char* name() const {
+		return "commands";
+	}
+	bool setup(SDL_Renderer* ren) {
+		textures[0].reset(loadImageTexture(getResourcePath("Lesson3") + "background.png", ren));
+		textures[1].reset(loadImageTexture(getResourcePath("Lesson3") + "image.png", ren));
+		textures[2].reset(loadImageTexture(getResourcePath("Lesson5") + "image.png", ren));
+		TTF_Font* font = fonts.get(getResourcePath("Lesson6") + "OpenSans-Regular.ttf", 32);
+		if (!textures[0] || !textures[1] || !textures[2] || font == nullptr
+			|| !atlas.build(font, ren))
+		{
+			return false;
+		}
+		//Spread the entities out with a fixed seed so every run draws the same
+		Uint32 seed = 1;
+		entities.resize(ENTITY_COUNT);
+		for (int i = 0; i < ENTITY_COUNT; i++) {
+			Entity& e = entities[i];
+			e.x = random(seed) % WORLD_WIDTH;
+			e.y = random(seed) % WORLD_HEIGHT;
+			e.vx = static_cast<int>(random(seed) % 9) - 4;
+			e.vy = static_cast<int>(random(seed) % 9) - 4;
+			e.texture = random(seed) % 3;
+			e.layer = static_cast<Uint16>(e.texture == 0 ? 0 : 1);
+		}
+		recorder.reset(new CommandRecorder());
+		return true;
+	}
+	int frame(SDL_Renderer* ren, int index) {
+		frameIndex = index;
+		//The camera pans across the world so what's culled keeps changing
+		camera.x = index * 3 % (WORLD_WIDTH - SCREEN_WIDTH);
+		camera.y = index * 2 % (WORLD_HEIGHT - SCREEN_HEIGHT);
+		camera.w = SCREEN_WIDTH;
+		camera.h = SCREEN_HEIGHT;
+		recorder->record(ENTITY_COUNT, recordEntities, this);
+		const SDL_Color white = {255, 255, 255, 255};
+		recorder->buffer(0).text(2, atlas, "Recorded on every core", 8, 8, white);
+		return recorder->submit(ren);
+	}
+	void teardown() {
+		recorder.reset();
+		entities.clear();
+		atlas.clear();
+		fonts.clear();
+		for (int i = 0; i < 3; i++) {
+			textures[i].reset();
+		}
+	}
+
+private:
+	static const int ENTITY_COUNT = 20000;
+	static const int WORLD_WIDTH = SCREEN_WIDTH * 8;
+	static const int WORLD_HEIGHT = SCREEN_HEIGHT * 8;
+	static const int ENTITY_SIZE = 32;
+
+	struct Entity {
+		Uint32 x, y;
+		int vx, vy;
+		Uint32 texture;
+		Uint16 layer;
+	};
+
+	//A small LCG, the same on every platform unlike rand()
+	static Uint32 random(Uint32& seed) {
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	//Wrap a position around the edge of the world
+	static int wrap(long long v, int size) {
+		const long long m = v % size;
+		return static_cast<int>(m < 0 ? m + size : m);
+	}
+
+	//Move each entity to where it is this frame and record it if it's in view
+	static void recordEntities(void* data, int begin, int end, CommandBuffer& out) {
+		const CommandsScenario* self = static_cast<const CommandsScenario*>(data);
+		const int frame = self->frameIndex;
+		for (int i = begin; i < end; i++) {
+			const Entity& e = self->entities[i];
+			const int x = wrap(e.x + static_cast<long long>(e.vx) * frame, WORLD_WIDTH);
+			const int y = wrap(e.y + static_cast<long long>(e.vy) * frame, WORLD_HEIGHT);
+			SDL_Rect dst = {x - self->camera.x, y - self->camera.y, ENTITY_SIZE, ENTITY_SIZE};
+			if (dst.x + dst.w <= 0 || dst.y + dst.h <= 0 || dst.x >= self->camera.w || dst.y >= self->camera.h) {
+				continue;
+			}
+			out.sprite(e.layer, self->textures[e.texture].get(), dst);
+		}
+	}
+
+	UniqueTexture textures[3];
+	FontCache fonts;
+	GlyphAtlas atlas;
+	std::vector<Entity> entities;
+	std::unique_ptr<CommandRecorder> recorder;
+	SDL_Rect camera;
+	int frameIndex;
+};
+
+/**
+ * 100k entities in an EntityStore moving around a world larger than the
+ * screen, each frame moved by one pass over their positions then culled,
+ * sorted and batched by EntitySprites.
+ */
+class EntitiesScenario : public Scenario {
+public:
+	const char* name() const {
+		return "entities";
+	}
+	bool setup(SDL_Renderer* ren) {
+		textures[0].reset(loadImageTexture(getResourcePath("Lesson3") + "background.png", ren));
+		textures[1].reset(loadImageTexture(getResourcePath("Lesson3") + "image.png", ren));
+		textures[2].reset(loadImageTexture(getResourcePath("Lesson5") + "image.png", ren));
+		if (!textures[0] || !textures[1] || !textures[2]) {
+			return false;
+		}
+		for (int i = 0; i < 3; i++) {
+			sprites.addTexture(textures[i].get());
+		}
+		//The sheet's top-left clip
+		const int sheetClip = sprites.addClip(CLIP);
+		//Spread the entities out with a fixed seed so every run draws the same
+		Uint32 seed = 1;
+		store.reserve(ENTITY_COUNT);
+		for (int i = 0; i < ENTITY_COUNT; i++) {
+			const Uint16 texture = static_cast<Uint16>(random(seed) % 3);
+			const int id = store.create(static_cast<float>(random(seed) % WORLD_WIDTH),
+				static_cast<float>(random(seed) % WORLD_HEIGHT), ENTITY_SIZE, ENTITY_SIZE,
+				texture, texture == 2 ? sheetClip : -1, texture == 0 ? 0 : 1);
+			const int e = store.index(id);
+			store.velX()[e] = static_cast<float>(static_cast<int>(random(seed) % 9) - 4);
+			store.velY()[e] = static_cast<float>(static_cast<int>(random(seed) % 9) - 4);
+		}
+		return true;
+	}
+	int frame(SDL_Renderer* ren, int index) {
+		moveEntities(store, 1.0f);
+		wrapEntities();
+		//The camera pans across the world so what's culled keeps changing
+		const SDL_Rect camera = {index * 3 % (WORLD_WIDTH - SCREEN_WIDTH),
+			index * 2 % (WORLD_HEIGHT - SCREEN_HEIGHT), SCREEN_WIDTH, SCREEN_HEIGHT};
+		return sprites.draw(ren, store, camera);
+	}
+	void teardown() {
+		store.clear();
+		sprites.clear();
+		for (int i = 0; i < 3; i++) {
+			textures[i].reset();
+		}
+	}
+
+private:
+	static const int ENTITY_COUNT = 100000;
+	static const int WORLD_WIDTH = SCREEN_WIDTH * 16;
+	static const int WORLD_HEIGHT = SCREEN_HEIGHT * 16;
+	static const int ENTITY_SIZE = 32;
+	static const SDL_Rect CLIP;
+
+	//A small LCG, the same on every platform unlike rand()
+	static Uint32 random(Uint32& seed) {
+		seed = seed * 1664525u + 1013904223u;
+		return seed >> 8;
+	}
+
+	//Bring anything that's moved off an edge of the world back on the other
+	void wrapEntities() {
+		const int n = store.size();
+		float* x = store.posX();
+		float* y = store.posY();
+		for (int i = 0; i < n; i++) {
+			x[i] = x[i] < 0 ? x[i] + WORLD_WIDTH : x[i] >= WORLD_WIDTH ? x[i] - WORLD_WIDTH : x[i];
+			y[i] = y[i] < 0 ? y[i] + WORLD_HEIGHT : y[i] >= WORLD_HEIGHT ? y[i] - WORLD_HEIGHT : y[i];
+		}
+	}
+
+	UniqueTexture textures[3];
+	EntityStore store;
+	EntitySprites sprites;
+};
+const SDL_Rect EntitiesScenario::CLIP = {0, 0, 100, 100};
+
+/**
+ * A full screen texture made on the CPU, with a band of rows rewritten
+ * every frame through a double buffered StreamingTexture.
+ */
+class StreamScenario : public Scenario {
+public:
+	const char* name() const {
+		return "stream";
+	}
+	bool setup(SDL_Renderer* ren) {
+		return stream.create(ren, SCREEN_WIDTH, SCREEN_HEIGHT);
+	}
+	int frame(SDL_Renderer* ren, int index) {
+		//The band moves down the screen, wrapping at the bottom
+		const SDL_Rect band = {0, index * 4 % (SCREEN_HEIGHT - BAND_HEIGHT),
+			SCREEN_WIDTH, BAND_HEIGHT};
+		SDL_Rect area;
+		int pitch;
+		Uint32* pixels = stream.lock(&band, &area, &pitch);
+		if (pixels != nullptr) {
+			for (int y = 0; y < area.h; y++) {
+				Uint32* row = reinterpret_cast<Uint32*>(reinterpret_cast<Uint8*>(pixels) + y * pitch);
+				const int py = area.y + y;
+				const bool inBand = py >= band.y && py < band.y + band.h;
+				for (int x = 0; x < area.w; x++) {
+					const Uint32 px = area.x + x;
+					const Uint32 v = inBand ? (px ^ py) + index : px ^ py;
+					row[x] = 0xff000000u | (v & 0xff) << 16 | (v * 3 & 0xff) << 8 | (v * 7 & 0xff);
+				}
+			}
+			stream.unlock();
+		}
+		profiler().countDraw(stream.texture());
+		SDL_RenderCopy(ren, stream.texture(), NULL, NULL);
+		return 1;
+	}
+	void teardown() {
+		stream.clear();
+	}
+
+private:
+	static const int BAND_HEIGHT = 64;
+	StreamingTexture stream;
+};
+
+/**
+ * Run a scenario and print its results as a line of JSON.
+ *
+ * @param  scenario The scenario to run.
+ * @param  ren      The renderer to draw with.
+ * @param  frames   The number of frames to time.
+ * @param  renderer The name of the renderer, for the results.
+ * @return          True if the scenario ran, false if its setup failed.
+ */
+bool runScenario(Scenario& scenario, SDL_Renderer* ren, int frames, const char* renderer) {
+	if (!scenario.setup(ren)) {
+		scenario.teardown();
+		return false;
+	}
+	Profiler& prof = profiler();
+	for (int i = 0; i < WARMUP_FRAMES; i++) {
+		SDL_RenderClear(ren);
+		scenario.frame(ren, i);
+		presentFrame(ren);
+	}
+	//Only the measured frames go into the percentiles, not the warmup or
+	//the scenario before this one
+	prof.reset();
+
+	long long draws = 0;
+	long long sprites = 0;
+	const int cppStart = SDL_AtomicGet(&cppAllocs);
+	const int sdlStart = SDL_AtomicGet(&sdlAllocs);
+	const Uint64 start = SDL_GetPerformanceCounter();
+	for (int i = 0; i < frames; i++) {
+		prof.beginFrame();
+		SDL_RenderClear(ren);
+		sprites += scenario.frame(ren, i);
+		presentFrame(ren);
+		prof.endFrame();
+		draws += prof.lastFrameDrawCalls();
+	}
+	const double ns = (SDL_GetPerformanceCounter() - start) * 1e9 / SDL_GetPerformanceFrequency();
+	const int cpp = SDL_AtomicGet(&cppAllocs) - cppStart;
+	const int sdl = SDL_AtomicGet(&sdlAllocs) - sdlStart;
+	const Profiler::Stats stats = prof.stats();
+
+	std::printf("{\"scenario\":\"%s\",\"renderer\":\"%s\",\"frames\":%d,"
+		"\"fps\":%.1f,\"ns_per_frame\":%.0f,\"p50_ms\":%.4f,\"p99_ms\":%.4f,"
+		"\"draws_per_frame\":%.2f,\"ns_per_draw\":%.1f,"
+		"\"sprites_per_frame\":%.2f,\"ns_per_sprite\":%.1f,"
+		"\"allocs_per_frame\":%.3f,\"sdl_allocs_per_frame\":%.3f}\n",
+		scenario.name(), renderer, frames,
+		frames * 1e9 / ns, ns / frames, stats.p50, stats.p99,
+		static_cast<double>(draws) / frames, draws > 0 ? ns / draws : 0.0,
+		static_cast<double>(sprites) / frames, sprites > 0 ? ns / sprites : 0.0,
+		static_cast<double>(cpp) / frames, static_cast<double>(sdl) / frames);
+	std::fflush(stdout);
+
+	scenario.teardown();
+	return true;
+}
+
+/**
+ * Create the renderer and run the scenarios, everything created here is
+ * freed when it returns so that happens before SDL_Quit.
+ *
+ * @param  offscreen True to draw into a plain surface instead of a window.
+ * @param  renderer  The name of the renderer to create.
+ * @param  only      The scenario to run, or empty to run them all.
+ * @param  frames    The number of frames to time each scenario for.
+ * @return           True if every scenario ran.
+ */
+bool run(bool offscreen, const std::string& renderer, const std::string& only, int frames) {
+	//The renderer is declared last so it's destroyed before what it draws to
+	UniqueSurface target;
+	UniqueWindow win;
+	UniqueRenderer ren;
+	if (offscreen) {
+		target.reset(SDL_CreateRGBSurfaceWithFormat(0, SCREEN_WIDTH, SCREEN_HEIGHT, 32,
+			SDL_PIXELFORMAT_ARGB8888));
+		if (target) {
+			ren.reset(SDL_CreateSoftwareRenderer(target.get()));
+		}
+	} else {
+		win.reset(SDL_CreateWindow("bench", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+			SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN));
+		if (win) {
+			if (renderer == "software") {
+				ren.reset(createRenderer(win.get(), SDL_RENDERER_SOFTWARE, "software"));
+			} else if (renderer == "accelerated") {
+				ren.reset(createRenderer(win.get(), SDL_RENDERER_ACCELERATED));
+			} else if (findRenderDriver(renderer) >= 0) {
+				//Straight to the driver, so a failure isn't timed as another driver
+				ren.reset(SDL_CreateRenderer(win.get(), findRenderDriver(renderer), 0));
+			} else {
+				SDL_SetError("no render driver named %s", renderer.c_str());
+			}
+		}
+	}
+	if (!ren) {
+		logSDLError(std::cerr, "CreateRenderer");
+		return false;
+	}
+	//Results go to stdout, so the report goes to stderr
+	logRendererInfo(std::cerr, ren.get());
+
+	/******************************
+	 * Benchmarks
+	 ******************************/
+	TilesScenario tiles;
+	TileMapScenario tileMap;
+	ClipsScenario clips;
+	TextScenario text;
+	CommandsScenario commands;
+	EntitiesScenario entities;
+	StreamScenario stream;
+	Scenario* scenarios[] = {&tiles, &tileMap, &clips, &text, &commands, &entities, &stream};
+	bool ok = true;
+	for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+		if (!only.empty() && only != scenarios[i]->name()) {
+			continue;
+		}
+		if (!runScenario(*scenarios[i], ren.get(), frames, renderer.c_str())) {
+			std::cerr << "Scenario " << scenarios[i]->name() << " failed to set up" << std::endl;
+			ok = false;
+		}
+	}
+	return ok;
+}
+
+int main(int argc, char** argv) {
+	countSDLAllocations();
+
+	int frames = 1000;
+	std::string renderer = "offscreen";
+	std::string only;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--renderer") == 0 && i + 1 < argc) {
+			renderer = argv[++i];
+		} else if (std::strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+			only = argv[++i];
+		} else {
+			std::cerr << "Usage: " << argv[0] << " [--frames N]"
+				<< " [--renderer offscreen|software|accelerated|DRIVER]"
+				<< " [--scenario tiles|tilemap|clips|text|commands|entities|stream]" << std::endl;
+			return 1;
+		}
+	}
+	if (frames <= 0) {
+		frames = 1;
+	}
+
+	/******************************
+	 * Initialization
+	 ******************************/
+	//The offscreen renderer draws into a plain surface and needs no video subsystem
+	const bool offscreen = renderer == "offscreen";
+	AppInit app(offscreen ? 0 : SDL_INIT_VIDEO);
+	if (!app) {
+		logSDLError(std::cerr, "SDL_Init");
+		return 1;
+	}
+	if (!app.step("TTF_Init", []() { return TTF_Init() == 0; }, TTF_Quit)
+		|| !app.step("IMG_Init", []() { return (IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != 0; }, IMG_Quit))
+	{
+		logSDLError(std::cerr, "Init");
+		return 1;
+	}
+	//Never wait on the display
+	SDL_SetHint(SDL_HINT_RENDER_VSYNC, "0");
+	//Read resources out of res.pak if it's been built
+	openResourcePack();
+	//Results go to stdout, so the report goes to stderr
+	app.report(std::cerr);
+
+	return run(offscreen, renderer, only, frames) ? 0 : 1;
+}
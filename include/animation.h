@@ -0,0 +1,279 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <vector>
+#include <SDL.h>
+
+/**
+ * Frame sequences for sprite animation, such as a walk cycle. Every
+ * sequence's frames are kept in one array of clip indices and one of the
+ * times each frame ends, so sequences are looked up without chasing
+ * pointers. Clip indices are whatever the caller draws with, such as
+ * SpriteAtlas region ids.
+ */
+class AnimationSet {
+public:
+	AnimationSet() {}
+
+	/**
+	 * Add a sequence.
+	 *
+	 * @param  clips     The clip to show for each frame.
+	 * @param  durations How long each frame is shown, in seconds.
+	 * @param  count     The number of frames, at least 1.
+	 * @param  loop      True to start again after the last frame, false to
+	 *                      stay on it.
+	 * @return           The sequence's id, or -1 if it has no frames.
+	 */
+	int add(const int* clips, const float* durations, int count, bool loop = true) {
+		if (count < 1) {
+			return -1;
+		}
+		Sequence seq;
+		seq.first = static_cast<int>(frameClips.size());
+		seq.count = count;
+		seq.loop = loop;
+		float end = 0;
+		bool uniform = true;
+		for (int i = 0; i < count; i++) {
+			end += durations[i];
+			frameClips.push_back(clips[i]);
+			frameEnds.push_back(end);
+			uniform = uniform && durations[i] == durations[0];
+		}
+		seq.length = end;
+		//Frames of one length are found with a multiply instead of a search
+		seq.invFrame = uniform && durations[0] > 0 ? 1.0f / durations[0] : 0.0f;
+		sequences.push_back(seq);
+		return static_cast<int>(sequences.size()) - 1;
+	}
+
+	/**
+	 * Add a sequence where every frame is shown for the same time.
+	 *
+	 * @param  clips    The clip to show for each frame.
+	 * @param  count    The number of frames, at least 1.
+	 * @param  duration How long each frame is shown, in seconds.
+	 * @param  loop     True to start again after the last frame.
+	 * @return          The sequence's id, or -1 if it has no frames.
+	 */
+	int add(const int* clips, int count, float duration, bool loop = true) {
+		std::vector<float> durations(count > 0 ? count : 0, duration);
+		return add(clips, count > 0 ? &durations[0] : nullptr, count, loop);
+	}
+
+	/**
+	 * @return The number of sequences.
+	 */
+	int size() const {
+		return static_cast<int>(sequences.size());
+	}
+
+	/**
+	 * @param  seq A sequence.
+	 * @return     How long it takes to play once, in seconds.
+	 */
+	float length(int seq) const {
+		return sequences[seq].length;
+	}
+
+	/**
+	 * Find the clip shown at some point in a sequence.
+	 *
+	 * @param  seq  The sequence.
+	 * @param  time The time since it started, in seconds, at least 0.
+	 * @return      The clip.
+	 */
+	int clipAt(int seq, float time) const {
+		const Sequence& s = sequences[seq];
+		return frameClips[s.first + frameAt(s, time)];
+	}
+
+private:
+	friend class Animator;
+
+	struct Sequence {
+		int first;
+		int count;
+		float length;
+		float invFrame;
+		bool loop;
+	};
+
+	AnimationSet(const AnimationSet&);
+	AnimationSet& operator=(const AnimationSet&);
+
+	//Wrap a time into the sequence, looping ones go round and others stop
+	//at the end
+	static float wrap(const Sequence& s, float time) {
+		if (time < s.length) {
+			return time;
+		}
+		if (!s.loop || s.length <= 0) {
+			return s.length;
+		}
+		const int laps = static_cast<int>(time / s.length);
+		time -= laps * s.length;
+		//Rounding can leave it a hair past the end
+		return time < s.length ? time : 0.0f;
+	}
+
+	int frameAt(const Sequence& s, float time) const {
+		int frame;
+		if (s.invFrame > 0) {
+			frame = static_cast<int>(time * s.invFrame);
+		} else {
+			const float* ends = &frameEnds[s.first];
+			frame = 0;
+			while (frame < s.count - 1 && time >= ends[frame]) {
+				frame++;
+			}
+		}
+		return frame < s.count ? frame : s.count - 1;
+	}
+
+	std::vector<Sequence> sequences;
+	std::vector<int> frameClips;
+	std::vector<float> frameEnds;
+};
+
+/**
+ * Plays sequences from an AnimationSet on any number of sprites at once.
+ * Each instance's state is split into separate arrays, so update() makes
+ * one pass adding time that the compiler can vectorize, then one pass
+ * wrapping the times and picking the clips that only touches the arrays it
+ * needs. Tens of thousands of instances update in a few cache-friendly
+ * sweeps instead of a call per sprite.
+ * Instances are numbered from 0 in the order they're added, removing one
+ * moves the last instance into its place.
+ */
+class Animator {
+public:
+	/**
+	 * @param anims The sequences to play, it has to outlive the animator.
+	 */
+	explicit Animator(const AnimationSet& anims) : set(anims) {}
+
+	/**
+	 * Start playing a sequence on a new instance.
+	 *
+	 * @param  seq   The sequence to play.
+	 * @param  start How far into it to start, in seconds, so instances
+	 *                  sharing a sequence needn't move in step.
+	 * @param  speed How fast to play it, 1 is normal speed, at least 0.
+	 * @return       The instance's index.
+	 */
+	int add(int seq, float start = 0, float speed = 1) {
+		sequence.push_back(seq);
+		time.push_back(AnimationSet::wrap(set.sequences[seq], start));
+		rate.push_back(speed > 0 ? speed : 0);
+		clips.push_back(set.clipAt(seq, time.back()));
+		return static_cast<int>(sequence.size()) - 1;
+	}
+
+	/**
+	 * Remove an instance, the last instance takes its index.
+	 *
+	 * @param i The instance to remove.
+	 */
+	void remove(int i) {
+		sequence[i] = sequence.back();
+		time[i] = time.back();
+		rate[i] = rate.back();
+		clips[i] = clips.back();
+		sequence.pop_back();
+		time.pop_back();
+		rate.pop_back();
+		clips.pop_back();
+	}
+
+	/**
+	 * Remove every instance, keeping the storage.
+	 */
+	void clear() {
+		sequence.clear();
+		time.clear();
+		rate.clear();
+		clips.clear();
+	}
+
+	/**
+	 * Switch an instance to another sequence, starting from its beginning.
+	 *
+	 * @param i   The instance.
+	 * @param seq The sequence to play.
+	 */
+	void play(int i, int seq) {
+		sequence[i] = seq;
+		time[i] = 0;
+		clips[i] = set.clipAt(seq, 0);
+	}
+
+	/**
+	 * @param i     The instance.
+	 * @param speed How fast to play its sequence, 0 pauses it. Sequences
+	 *                 can't play backwards.
+	 */
+	void setSpeed(int i, float speed) {
+		rate[i] = speed > 0 ? speed : 0;
+	}
+
+	/**
+	 * Advance every instance.
+	 *
+	 * @param dt The time that's passed, in seconds.
+	 */
+	void update(float dt) {
+		const int n = size();
+		if (n == 0) {
+			return;
+		}
+		//Plain arrays so the compiler knows they don't overlap
+		float* __restrict t = &time[0];
+		const float* __restrict r = &rate[0];
+		for (int i = 0; i < n; i++) {
+			t[i] += r[i] * dt;
+		}
+		const int* seqs = &sequence[0];
+		int* out = &clips[0];
+		for (int i = 0; i < n; i++) {
+			const AnimationSet::Sequence& s = set.sequences[seqs[i]];
+			t[i] = AnimationSet::wrap(s, t[i]);
+			out[i] = set.frameClips[s.first + set.frameAt(s, t[i])];
+		}
+	}
+
+	/**
+	 * @param  i The instance.
+	 * @return   The clip it's showing.
+	 */
+	int clip(int i) const {
+		return clips[i];
+	}
+
+	/**
+	 * @return Every instance's clip, indexed by instance.
+	 */
+	const std::vector<int>& allClips() const {
+		return clips;
+	}
+
+	/**
+	 * @return The number of instances.
+	 */
+	int size() const {
+		return static_cast<int>(sequence.size());
+	}
+
+private:
+	Animator(const Animator&);
+	Animator& operator=(const Animator&);
+
+	const AnimationSet& set;
+	std::vector<int> sequence;
+	std::vector<float> time;
+	std::vector<float> rate;
+	std::vector<int> clips;
+};
+
+#endif
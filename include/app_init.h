@@ -0,0 +1,141 @@
+#ifndef APP_INIT_H
+#define APP_INIT_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+/**
+ * Starts only the parts of SDL a program asks for, instead of
+ * SDL_INIT_EVERYTHING bringing up audio, haptics and controllers that may
+ * never be used and on some headless systems fail to start at all.
+ * Anything else is started on first use with require(), and libraries
+ * such as SDL_image and SDL_ttf are started as steps. Each step is timed
+ * for report(), and when the AppInit goes out of scope everything is shut
+ * down again, the libraries first in the reverse order they were started.
+ *
+ *	AppInit app(SDL_INIT_VIDEO);
+ *	if (!app || !app.step("TTF_Init", []() { return TTF_Init() == 0; }, TTF_Quit)) {
+ *		...log SDL_GetError() and exit...
+ *	}
+ */
+class AppInit {
+public:
+	typedef bool (*InitFunc)();
+	typedef void (*QuitFunc)();
+
+	/**
+	 * Start SDL with some of its subsystems.
+	 *
+	 * @param subsystems The SDL_INIT_* flags to start, 0 for none.
+	 */
+	explicit AppInit(Uint32 subsystems) : started(false) {
+		const Uint64 start = SDL_GetPerformanceCounter();
+		started = SDL_Init(subsystems) == 0;
+		record("SDL_Init" + subsystemNames(subsystems), start);
+	}
+	~AppInit() {
+		for (std::vector<Step>::reverse_iterator it = steps.rbegin(); it != steps.rend(); ++it) {
+			if (it->quit != nullptr) {
+				it->quit();
+			}
+		}
+		SDL_Quit();
+	}
+
+	/**
+	 * @return True if SDL started.
+	 */
+	explicit operator bool() const {
+		return started;
+	}
+
+	/**
+	 * Start a library or anything else that's shut down when the app is.
+	 *
+	 * @param  name The name to report the step's time under.
+	 * @param  init Starts it, returning true if it did.
+	 * @param  quit Shuts it down, or nullptr if there's nothing to do.
+	 * @return      True if it started.
+	 */
+	bool step(const char* name, InitFunc init, QuitFunc quit = nullptr) {
+		const Uint64 start = SDL_GetPerformanceCounter();
+		const bool ok = init();
+		record(name, start, ok ? quit : nullptr);
+		return ok;
+	}
+
+	/**
+	 * Start SDL subsystems that aren't running yet, call this before the
+	 * first use of audio, controllers and so on.
+	 *
+	 * @param  subsystems The SDL_INIT_* flags needed.
+	 * @return            True if they're all running.
+	 */
+	bool require(Uint32 subsystems) {
+		const Uint32 missing = subsystems & ~SDL_WasInit(subsystems);
+		if (missing == 0) {
+			return true;
+		}
+		const Uint64 start = SDL_GetPerformanceCounter();
+		const bool ok = SDL_InitSubSystem(missing) == 0;
+		record("SDL_InitSubSystem" + subsystemNames(missing), start);
+		return ok;
+	}
+
+	/**
+	 * Write how long each step took.
+	 *
+	 * @param os The output stream to write the report to.
+	 */
+	void report(std::ostream& os) const {
+		double total = 0;
+		for (std::vector<Step>::const_iterator it = steps.begin(); it != steps.end(); ++it) {
+			os << "Startup " << it->name << ": " << it->ms << "ms" << std::endl;
+			total += it->ms;
+		}
+		os << "Startup total: " << total << "ms" << std::endl;
+	}
+
+private:
+	struct Step {
+		std::string name;
+		double ms;
+		QuitFunc quit;
+	};
+
+	AppInit(const AppInit&);
+	AppInit& operator=(const AppInit&);
+
+	static std::string subsystemNames(Uint32 subsystems) {
+		static const struct {
+			Uint32 flag;
+			const char* name;
+		} names[] = {
+			{SDL_INIT_TIMER, "timer"}, {SDL_INIT_AUDIO, "audio"}, {SDL_INIT_VIDEO, "video"},
+			{SDL_INIT_JOYSTICK, "joystick"}, {SDL_INIT_HAPTIC, "haptic"},
+			{SDL_INIT_GAMECONTROLLER, "gamecontroller"}, {SDL_INIT_EVENTS, "events"}
+		};
+		std::string result;
+		for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+			if (subsystems & names[i].flag) {
+				result += std::string(" ") + names[i].name;
+			}
+		}
+		return result;
+	}
+
+	void record(const std::string& name, Uint64 start, QuitFunc quit = nullptr) {
+		Step s;
+		s.name = name;
+		s.ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+		s.quit = quit;
+		steps.push_back(s);
+	}
+
+	bool started;
+	std::vector<Step> steps;
+};
+
+#endif
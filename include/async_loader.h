@@ -0,0 +1,270 @@
+#ifndef ASYNC_LOADER_H
+#define ASYNC_LOADER_H
+
+#include <deque>
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "cleanup.h"
+#include "raw_texture.h"
+#include "res_pack.h"
+
+/**
+ * Decodes images on worker threads so the main thread never blocks on
+ * IMG_Load. An image that texconv has converted to a .tex file is read from
+ * that instead, skipping the decode. Decoded images wait in a completion
+ * queue until the render thread uploads them with upload(), which stops
+ * once its time budget for the frame is used up, so streaming in textures
+ * doesn't cause hitches.
+ * Everything except the decoding itself must be called from the thread
+ * that owns the renderer.
+ */
+class AsyncTextureLoader {
+public:
+	/**
+	 * @param ren     The renderer to upload textures to.
+	 * @param workers The number of decoding threads, default 0 picks one
+	 *                   per spare CPU core.
+	 */
+	AsyncTextureLoader(SDL_Renderer* ren, int workers = 0)
+		: renderer(ren), mutex(SDL_CreateMutex()), wake(SDL_CreateCond()),
+		quit(false), nextId(0), outstanding(0)
+	{
+		//Load the decoders up front, initializing them lazily from several
+		//workers at once isn't safe
+		IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG);
+
+		if (workers <= 0) {
+			workers = SDL_GetCPUCount() - 1;
+			workers = workers < 1 ? 1 : (workers > MAX_WORKERS ? MAX_WORKERS : workers);
+		}
+		for (int i = 0; i < workers; i++) {
+			SDL_Thread* thread = SDL_CreateThread(work, "AsyncTextureLoader", this);
+			if (thread != nullptr) {
+				threads.push_back(thread);
+			} else {
+				std::cout << "CreateThread error: " << SDL_GetError() << std::endl;
+			}
+		}
+	}
+
+	~AsyncTextureLoader() {
+		stop();
+		SDL_DestroyCond(wake);
+		SDL_DestroyMutex(mutex);
+	}
+
+	/**
+	 * Stop the workers and free anything that was never taken. Must be
+	 * called before the renderer is destroyed, requests made afterwards
+	 * are decoded on the calling thread.
+	 */
+	void stop() {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(wake);
+		SDL_UnlockMutex(mutex);
+		for (std::vector<SDL_Thread*>::size_type i = 0; i < threads.size(); i++) {
+			SDL_WaitThread(threads[i], NULL);
+		}
+		threads.clear();
+
+		outstanding = 0;
+		pending.clear();
+		decoded.clear();
+		uploaded.clear();
+	}
+
+	/**
+	 * Queue an image to be decoded in the background.
+	 *
+	 * @param  file The image file to load.
+	 * @return      The id to collect the texture with.
+	 */
+	int request(const std::string& file) {
+		Job job;
+		job.id = nextId++;
+		job.file = file;
+		const int id = job.id;
+		outstanding++;
+
+		SDL_LockMutex(mutex);
+		if (threads.empty()) {
+			//No workers could be started, so decode on this thread
+			SDL_UnlockMutex(mutex);
+			decode(job);
+			SDL_LockMutex(mutex);
+			decoded.push_back(std::move(job));
+		} else {
+			pending.push_back(std::move(job));
+			SDL_CondSignal(wake);
+		}
+		SDL_UnlockMutex(mutex);
+		return id;
+	}
+
+	/**
+	 * Turn decoded images into textures until the time budget runs out.
+	 * At least one image is uploaded per call if any are ready, so loading
+	 * always makes progress.
+	 *
+	 * @param  budgetMs How long to spend uploading, in milliseconds.
+	 * @return          The number of requests finished by this call.
+	 */
+	int upload(double budgetMs) {
+		const Uint64 start = SDL_GetPerformanceCounter();
+		const Uint64 budget = static_cast<Uint64>(budgetMs * SDL_GetPerformanceFrequency() / 1000.0);
+		int finished = 0;
+
+		for (;;) {
+			SDL_LockMutex(mutex);
+			if (decoded.empty()) {
+				SDL_UnlockMutex(mutex);
+				break;
+			}
+			Job job = std::move(decoded.front());
+			decoded.pop_front();
+			SDL_UnlockMutex(mutex);
+
+			complete(job);
+			finished++;
+			if (SDL_GetPerformanceCounter() - start >= budget) {
+				break;
+			}
+		}
+		return finished;
+	}
+
+	/**
+	 * Block until every request has been decoded and uploaded.
+	 */
+	void finish() {
+		while (outstanding > 0) {
+			SDL_LockMutex(mutex);
+			while (decoded.empty()) {
+				SDL_CondWait(wake, mutex);
+			}
+			Job job = std::move(decoded.front());
+			decoded.pop_front();
+			SDL_UnlockMutex(mutex);
+
+			complete(job);
+		}
+	}
+
+	/**
+	 * @param  id The request to check on.
+	 * @return    True if the request has been uploaded, or has failed.
+	 */
+	bool ready(int id) const {
+		return uploaded.find(id) != uploaded.end();
+	}
+
+	/**
+	 * @return True if there are no requests left to decode or upload.
+	 */
+	bool idle() const {
+		return outstanding == 0;
+	}
+
+	/**
+	 * Collect the texture for a finished request.
+	 *
+	 * @param  id The request to collect.
+	 * @return    The loaded texture, empty if it failed or isn't ready.
+	 */
+	UniqueTexture take(int id) {
+		std::map<int, UniqueTexture>::iterator it = uploaded.find(id);
+		if (it == uploaded.end()) {
+			return UniqueTexture();
+		}
+		UniqueTexture texture = std::move(it->second);
+		uploaded.erase(it);
+		return texture;
+	}
+
+private:
+	//Decoding is mostly memory bound, more threads than this don't help
+	static const int MAX_WORKERS = 4;
+
+	struct Job {
+		int id;
+		std::string file;
+		UniqueSurface surface;
+		RawImage raw;
+	};
+
+	AsyncTextureLoader(const AsyncTextureLoader&);
+	AsyncTextureLoader& operator=(const AsyncTextureLoader&);
+
+	static int work(void* data) {
+		AsyncTextureLoader* loader = static_cast<AsyncTextureLoader*>(data);
+		SDL_LockMutex(loader->mutex);
+		for (;;) {
+			while (!loader->quit && loader->pending.empty()) {
+				SDL_CondWait(loader->wake, loader->mutex);
+			}
+			if (loader->quit) {
+				break;
+			}
+			Job job = std::move(loader->pending.front());
+			loader->pending.pop_front();
+			SDL_UnlockMutex(loader->mutex);
+
+			decode(job);
+
+			SDL_LockMutex(loader->mutex);
+			loader->decoded.push_back(std::move(job));
+			//Workers and finish() share the condition, so wake everyone
+			SDL_CondBroadcast(loader->wake);
+		}
+		SDL_UnlockMutex(loader->mutex);
+		return 0;
+	}
+
+	//Load a job's image, preferring its converted .tex file
+	static void decode(Job& job) {
+		if (rawTextureCurrent(job.file) && readRawImage(rawTexturePath(job.file), job.raw)) {
+			return;
+		}
+		job.surface.reset(IMG_Load_RW(openResource(job.file), 1));
+		if (!job.surface) {
+			std::cout << "IMG_Load error: " << SDL_GetError() << std::endl;
+		}
+	}
+
+	void complete(Job& job) {
+		UniqueTexture texture;
+		if (job.raw.pixels != nullptr) {
+			texture.reset(createRawTexture(renderer, job.raw));
+		} else if (job.surface) {
+			texture.reset(SDL_CreateTextureFromSurface(renderer, job.surface.get()));
+			if (!texture) {
+				std::cout << "CreateTextureFromSurface error: " << SDL_GetError() << std::endl;
+			}
+			job.surface.reset();
+		}
+		uploaded[job.id] = std::move(texture);
+		outstanding--;
+	}
+
+	SDL_Renderer* renderer;
+	std::vector<SDL_Thread*> threads;
+	SDL_mutex* mutex;
+	SDL_cond* wake;
+	//Guarded by the mutex
+	bool quit;
+	std::deque<Job> pending;
+	std::deque<Job> decoded;
+	//Only touched by the render thread
+	int nextId;
+	int outstanding;
+	std::map<int, UniqueTexture> uploaded;
+};
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include <SDL.h>
+
+/**
+ * The part of the world that's on screen. Positions are in world pixels,
+ * the view's top-left corner is drawn at the screen's top-left corner.
+ */
+class Camera {
+public:
+	/**
+	 * @param viewW The width of the view, normally the screen's width.
+	 * @param viewH The height of the view, normally the screen's height.
+	 */
+	Camera(int viewW, int viewH) : bounded(false) {
+		area.x = 0;
+		area.y = 0;
+		area.w = viewW;
+		area.h = viewH;
+		limits = area;
+	}
+
+	/**
+	 * Keep the view inside the world. If the world is smaller than the view
+	 * along an axis the view is lined up with its left or top edge.
+	 *
+	 * @param world The area the view has to stay in.
+	 */
+	void setBounds(const SDL_Rect& world) {
+		limits = world;
+		bounded = true;
+		moveTo(area.x, area.y);
+	}
+
+	/**
+	 * Move the view's top-left corner, keeping it inside the bounds.
+	 *
+	 * @param x The x coordinate in the world to move to.
+	 * @param y The y coordinate in the world to move to.
+	 */
+	void moveTo(int x, int y) {
+		if (bounded) {
+			x = clamp(x, limits.x, limits.x + limits.w - area.w);
+			y = clamp(y, limits.y, limits.y + limits.h - area.h);
+		}
+		area.x = x;
+		area.y = y;
+	}
+
+	/**
+	 * Move the view so a point is in the middle of it, as far as the
+	 * bounds allow.
+	 *
+	 * @param x The x coordinate in the world to look at.
+	 * @param y The y coordinate in the world to look at.
+	 */
+	void centerOn(int x, int y) {
+		moveTo(x - area.w / 2, y - area.h / 2);
+	}
+
+	/**
+	 * @return The area of the world that's on screen.
+	 */
+	const SDL_Rect& view() const {
+		return area;
+	}
+
+	/**
+	 * @param  r A rect in the world.
+	 * @return   True if any of it is on screen.
+	 */
+	bool sees(const SDL_Rect& r) const {
+		return r.x < area.x + area.w && r.x + r.w > area.x
+			&& r.y < area.y + area.h && r.y + r.h > area.y;
+	}
+
+	/**
+	 * @param  r A rect in the world.
+	 * @return   Where the rect is drawn on screen.
+	 */
+	SDL_Rect toScreen(const SDL_Rect& r) const {
+		SDL_Rect screen = {r.x - area.x, r.y - area.y, r.w, r.h};
+		return screen;
+	}
+
+private:
+	//Clamp a coordinate to [low, high], preferring low if the range is empty
+	static int clamp(int v, int low, int high) {
+		if (v > high) {
+			v = high;
+		}
+		return v < low ? low : v;
+	}
+
+	SDL_Rect area;
+	SDL_Rect limits;
+	bool bounded;
+};
+
+#endif
@@ -1,9 +1,12 @@
 #ifndef CLEANUP_H
 #define CLEANUP_H
 
+#include <memory>
 #include <utility>
 #include <SDL.h>
 
+#include "texture_budget.h"
+
 template<typename T, typename... Args>
 void cleanup(T* t, Args&&... args) {
 	//Cleanup the first item and recurse
@@ -32,6 +35,7 @@ inline void cleanup<SDL_Texture>(SDL_Texture* tex) {
 	if (!tex) {
 		return;
 	}
+	textureBudget().forget(tex);
 	SDL_DestroyTexture(tex);
 }
 
@@ -43,4 +47,29 @@ inline void cleanup<SDL_Surface>(SDL_Surface* surf) {
 	SDL_FreeSurface(surf);
 }
 
+/**
+ * Deleter that frees an SDL object with its cleanup specialization, it has
+ * no state so a Unique handle is the same size as the raw pointer.
+ */
+template<typename T>
+struct Cleanup {
+	void operator()(T* t) const {
+		cleanup(t);
+	}
+};
+
+/**
+ * A move only handle that owns an SDL object and frees it when the handle
+ * goes out of scope, so error paths don't have to clean up by hand and the
+ * objects can be kept in containers or passed between threads.
+ * Types other than the ones above need a cleanup specialization first.
+ */
+template<typename T>
+using Unique = std::unique_ptr<T, Cleanup<T> >;
+
+typedef Unique<SDL_Window> UniqueWindow;
+typedef Unique<SDL_Renderer> UniqueRenderer;
+typedef Unique<SDL_Texture> UniqueTexture;
+typedef Unique<SDL_Surface> UniqueSurface;
+
 #endif
@@ -0,0 +1,286 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <iostream>
+#include <vector>
+#include <SDL.h>
+
+#include "draw_queue.h"
+#include "text_atlas.h"
+
+/**
+ * Draws recorded by one thread. Nothing here touches the renderer or any
+ * shared state, so each thread records into its own buffer with no locking
+ * and the buffers are submitted together afterwards.
+ * The buffer keeps its storage between frames, so recording the same number
+ * of draws again doesn't allocate.
+ */
+class CommandBuffer {
+public:
+	CommandBuffer() {}
+
+	/**
+	 * Record a sprite.
+	 *
+	 * @param layer Lower layers are drawn first.
+	 * @param tex   The texture to draw from.
+	 * @param dst   The destination rectangle to draw the sprite to.
+	 * @param clip  The sub-section of the texture to draw, default nullptr
+	 *                 draws the entire texture.
+	 */
+	void sprite(Uint16 layer, SDL_Texture* tex, const SDL_Rect& dst,
+			const SDL_Rect* clip = nullptr) {
+		static const SDL_Rect whole = {0, 0, -1, -1};
+		static const SDL_Color white = {255, 255, 255, 255};
+		DrawCommand cmd = {tex, clip != nullptr ? *clip : whole, dst, white, layer};
+		commands.push_back(cmd);
+	}
+
+	/**
+	 * Record a string, as one command per glyph.
+	 *
+	 * @param layer Lower layers are drawn first.
+	 * @param atlas The glyph atlas to draw the text from.
+	 * @param text  The text to draw, may contain newlines.
+	 * @param x     The x coordinate to draw to.
+	 * @param y     The y coordinate to draw to.
+	 * @param color The text color.
+	 */
+	void text(Uint16 layer, const GlyphAtlas& atlas, const char* text, int x, int y,
+			SDL_Color color) {
+		SDL_Texture* tex = atlas.texture();
+		if (tex == nullptr) {
+			return;
+		}
+		std::vector<DrawCommand>& out = commands;
+		atlas.layout(text, x, y, [&](const SDL_Rect& dst, const SDL_Rect& clip) {
+			DrawCommand cmd = {tex, clip, dst, color, layer};
+			out.push_back(cmd);
+		});
+	}
+
+	/**
+	 * Remove every recorded command, keeping the storage for the next frame.
+	 */
+	void clear() {
+		commands.clear();
+	}
+
+	/**
+	 * @return The number of recorded commands.
+	 */
+	int size() const {
+		return static_cast<int>(commands.size());
+	}
+
+	/**
+	 * @return The recorded commands, in the order they were recorded.
+	 */
+	const std::vector<DrawCommand>& recorded() const {
+		return commands;
+	}
+
+private:
+	CommandBuffer(const CommandBuffer&);
+	CommandBuffer& operator=(const CommandBuffer&);
+
+	std::vector<DrawCommand> commands;
+};
+
+/**
+ * Records a frame's draws across worker threads, then submits them through
+ * a DrawQueue from the thread that owns the renderer.
+ * record() splits a range of items, such as entities to cull and draw,
+ * into one slice per thread. Slice i is always recorded into buffer(i), so
+ * joining the buffers in order gives the same commands as recording the
+ * whole range on one thread, and the queue's sort keeps that order for
+ * draws from the same texture on a layer.
+ */
+class CommandRecorder {
+public:
+	/**
+	 * Record draws for items [begin, end) into a buffer. Called on worker
+	 * threads, it mustn't touch the renderer.
+	 */
+	typedef void (*RecordFunc)(void* data, int begin, int end, CommandBuffer& out);
+
+	/**
+	 * @param threads The number of threads to record on, including the
+	 *                   calling thread, default 0 picks one per CPU core.
+	 */
+	CommandRecorder(int threads = 0)
+		: mutex(SDL_CreateMutex()), wake(SDL_CreateCond()), done(SDL_CreateCond()),
+		quit(false), generation(0), running(0), func(nullptr), funcData(nullptr), itemCount(0)
+	{
+		if (threads <= 0) {
+			threads = SDL_GetCPUCount();
+			threads = threads < 1 ? 1 : (threads > MAX_THREADS ? MAX_THREADS : threads);
+		}
+		//The calling thread records the first slice itself
+		for (int i = 1; i < threads; i++) {
+			Worker* worker = new Worker();
+			worker->recorder = this;
+			worker->index = i;
+			worker->thread = SDL_CreateThread(work, "CommandRecorder", worker);
+			if (worker->thread == nullptr) {
+				std::cout << "CreateThread error: " << SDL_GetError() << std::endl;
+				delete worker;
+				break;
+			}
+			workers.push_back(worker);
+		}
+		buffers.resize(workers.size() + 1);
+		for (std::vector<CommandBuffer*>::size_type i = 0; i < buffers.size(); i++) {
+			buffers[i] = new CommandBuffer();
+		}
+	}
+
+	~CommandRecorder() {
+		SDL_LockMutex(mutex);
+		quit = true;
+		SDL_CondBroadcast(wake);
+		SDL_UnlockMutex(mutex);
+		for (std::vector<Worker*>::size_type i = 0; i < workers.size(); i++) {
+			SDL_WaitThread(workers[i]->thread, NULL);
+			delete workers[i];
+		}
+		for (std::vector<CommandBuffer*>::size_type i = 0; i < buffers.size(); i++) {
+			delete buffers[i];
+		}
+		SDL_DestroyCond(done);
+		SDL_DestroyCond(wake);
+		SDL_DestroyMutex(mutex);
+	}
+
+	/**
+	 * @return The number of buffers, one per recording thread.
+	 */
+	int bufferCount() const {
+		return static_cast<int>(buffers.size());
+	}
+
+	/**
+	 * @param  i The buffer to get, from 0 to bufferCount() - 1.
+	 * @return   The buffer, for recording on the calling thread outside of record().
+	 */
+	CommandBuffer& buffer(int i) {
+		return *buffers[i];
+	}
+
+	/**
+	 * Record draws for items [0, count) across every thread, returning once
+	 * they've all finished.
+	 *
+	 * @param count The number of items to split between the threads.
+	 * @param fn    The function that records a slice of the items.
+	 * @param data  Passed through to fn.
+	 */
+	void record(int count, RecordFunc fn, void* data) {
+		if (workers.empty() || count < 2) {
+			fn(data, 0, count, *buffers[0]);
+			return;
+		}
+		SDL_LockMutex(mutex);
+		func = fn;
+		funcData = data;
+		itemCount = count;
+		running = static_cast<int>(workers.size());
+		generation++;
+		SDL_CondBroadcast(wake);
+		SDL_UnlockMutex(mutex);
+
+		int begin, end;
+		slice(0, count, &begin, &end);
+		fn(data, begin, end, *buffers[0]);
+
+		SDL_LockMutex(mutex);
+		while (running > 0) {
+			SDL_CondWait(done, mutex);
+		}
+		SDL_UnlockMutex(mutex);
+	}
+
+	/**
+	 * Sort every buffer's commands and draw them, then clear the buffers.
+	 * Must be called from the thread that owns the renderer.
+	 *
+	 * @param  ren The renderer to draw to.
+	 * @return     The number of commands drawn.
+	 */
+	int submit(SDL_Renderer* ren) {
+		queue.clear();
+		for (std::vector<CommandBuffer*>::size_type i = 0; i < buffers.size(); i++) {
+			queue.add(buffers[i]->recorded());
+			buffers[i]->clear();
+		}
+		queue.draw(ren);
+		return queue.size();
+	}
+
+private:
+	//Recording is cheap per item, past this more threads just add overhead
+	static const int MAX_THREADS = 8;
+
+	struct Worker {
+		CommandRecorder* recorder;
+		int index;
+		SDL_Thread* thread;
+	};
+
+	CommandRecorder(const CommandRecorder&);
+	CommandRecorder& operator=(const CommandRecorder&);
+
+	static int work(void* data) {
+		Worker* worker = static_cast<Worker*>(data);
+		CommandRecorder* recorder = worker->recorder;
+		unsigned seen = 0;
+		SDL_LockMutex(recorder->mutex);
+		for (;;) {
+			while (!recorder->quit && recorder->generation == seen) {
+				SDL_CondWait(recorder->wake, recorder->mutex);
+			}
+			if (recorder->quit) {
+				break;
+			}
+			seen = recorder->generation;
+			RecordFunc fn = recorder->func;
+			void* fnData = recorder->funcData;
+			int begin, end;
+			recorder->slice(worker->index, recorder->itemCount, &begin, &end);
+			SDL_UnlockMutex(recorder->mutex);
+
+			fn(fnData, begin, end, *recorder->buffers[worker->index]);
+
+			SDL_LockMutex(recorder->mutex);
+			if (--recorder->running == 0) {
+				SDL_CondSignal(recorder->done);
+			}
+		}
+		SDL_UnlockMutex(recorder->mutex);
+		return 0;
+	}
+
+	//Get the items thread i records, the slices are contiguous and in order
+	void slice(int i, int count, int* begin, int* end) const {
+		const int threads = static_cast<int>(buffers.size());
+		*begin = static_cast<int>(static_cast<long long>(count) * i / threads);
+		*end = static_cast<int>(static_cast<long long>(count) * (i + 1) / threads);
+	}
+
+	std::vector<Worker*> workers;
+	std::vector<CommandBuffer*> buffers;
+	SDL_mutex* mutex;
+	SDL_cond* wake;
+	SDL_cond* done;
+	//Guarded by the mutex
+	bool quit;
+	unsigned generation;
+	int running;
+	RecordFunc func;
+	void* funcData;
+	int itemCount;
+	//Kept between frames so submitting doesn't allocate once it's grown
+	DrawQueue queue;
+};
+
+#endif
@@ -0,0 +1,290 @@
+#ifndef DRAW_QUEUE_H
+#define DRAW_QUEUE_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include <SDL.h>
+
+#include "frame_arena.h"
+#include "sprite_batch.h"
+
+/**
+ * One queued draw: a sprite, or a single glyph of some text.
+ */
+struct DrawCommand {
+	SDL_Texture* texture;
+	//A negative size means the entire texture
+	SDL_Rect src;
+	SDL_Rect dst;
+	//Multiplied with the texture's own color and alpha mod, white draws
+	//the texture the way it'd be drawn on its own
+	SDL_Color color;
+	Uint16 layer;
+};
+
+/**
+ * Collects a frame's draws from any number of textures, then sorts them so
+ * each texture is drawn once per layer instead of breaking the renderer's
+ * batch every time the texture changes.
+ * Every draw gets a 64-bit sort key:
+ *
+ *	bits 52-63  layer, lower layers are drawn first
+ *	bits 48-51  blend mode of the texture
+ *	bits 32-47  texture and color, numbered in the order first queued
+ *	bits 0-31   the draw's position in the queue
+ *
+ * and the keys are radix sorted. Since the low bits keep the queue order,
+ * draws from the same texture on a layer stay in the order they were
+ * queued, draws from different textures on a layer don't. Anything that
+ * must overlap in a set order should go on different layers.
+ * The queue keeps its storage between frames, so queueing the same number
+ * of draws again doesn't allocate, and the sort keys only live in the
+ * frame arena while draw() runs.
+ */
+class DrawQueue {
+public:
+	//Layers above this are drawn with it
+	static const Uint16 MAX_LAYER = 4095;
+
+	DrawQueue() {}
+
+	/**
+	 * Queue a sprite.
+	 *
+	 * @param layer Lower layers are drawn first, at most MAX_LAYER.
+	 * @param tex   The texture to draw from.
+	 * @param dst   The destination rectangle to draw the sprite to.
+	 * @param clip  The sub-section of the texture to draw, default nullptr
+	 *                 draws the entire texture.
+	 */
+	void add(Uint16 layer, SDL_Texture* tex, const SDL_Rect& dst, const SDL_Rect* clip = nullptr) {
+		static const SDL_Rect whole = {0, 0, -1, -1};
+		static const SDL_Color white = {255, 255, 255, 255};
+		DrawCommand cmd = {tex, clip != nullptr ? *clip : whole, dst, white, layer};
+		commands.push_back(cmd);
+	}
+	void add(const DrawCommand& cmd) {
+		commands.push_back(cmd);
+	}
+	void add(const std::vector<DrawCommand>& cmds) {
+		commands.insert(commands.end(), cmds.begin(), cmds.end());
+	}
+
+	/**
+	 * Remove every queued draw, keeping the storage for the next frame.
+	 */
+	void clear() {
+		commands.clear();
+	}
+
+	/**
+	 * @return The number of queued draws.
+	 */
+	int size() const {
+		return static_cast<int>(commands.size());
+	}
+
+	/**
+	 * Sort the queued draws and submit them, each run of the same texture
+	 * and color as one batch. The queue is left as is so it can be drawn
+	 * again, call clear() to start the next frame.
+	 *
+	 * @param  ren The renderer to draw to.
+	 * @return     The number of batches drawn.
+	 */
+	int draw(SDL_Renderer* ren) {
+		if (commands.empty()) {
+			return 0;
+		}
+		FrameArena::Scope scope(frameArena());
+		const Uint32 total = static_cast<Uint32>(commands.size());
+		Uint64* keys = buildKeys();
+		keys = radixSort(keys, total);
+
+		int batches = 0;
+		Uint32 start = 0;
+		while (start < total) {
+			//Everything but the queue position matches within a run
+			const Uint64 run = keys[start] >> 32;
+			const DrawCommand& first = commands[static_cast<Uint32>(keys[start])];
+			Uint32 end = start;
+			batch.clear();
+			while (end < total && keys[end] >> 32 == run) {
+				const DrawCommand& cmd = commands[static_cast<Uint32>(keys[end])];
+				if (cmd.texture != first.texture || !sameColor(cmd.color, first.color)) {
+					break;
+				}
+				batch.add(cmd.dst, cmd.src.w < 0 ? nullptr : &cmd.src);
+				end++;
+			}
+			drawTinted(ren, first.texture, first.color);
+			batches++;
+			start = end;
+		}
+		return batches;
+	}
+
+	/**
+	 * LSD radix sort 64-bit keys a byte at a time, skipping any byte that's
+	 * the same in every key. The scratch copy comes from the frame arena.
+	 *
+	 * @param  keys  The keys to sort.
+	 * @param  total The number of keys, at least 1.
+	 * @return       Whichever of keys and its scratch copy ends up sorted.
+	 */
+	static Uint64* radixSort(Uint64* keys, Uint32 total) {
+		Uint32 counts[8][256] = {{0}};
+		for (Uint32 i = 0; i < total; i++) {
+			const Uint64 k = keys[i];
+			for (int b = 0; b < 8; b++) {
+				counts[b][(k >> (b * 8)) & 0xff]++;
+			}
+		}
+		Uint64* scratch = frameArena().alloc<Uint64>(total);
+		for (int b = 0; b < 8; b++) {
+			Uint32* count = counts[b];
+			const Uint64 first = (keys[0] >> (b * 8)) & 0xff;
+			if (count[first] == total) {
+				continue;
+			}
+			Uint32 offset = 0;
+			for (int i = 0; i < 256; i++) {
+				const Uint32 c = count[i];
+				count[i] = offset;
+				offset += c;
+			}
+			for (Uint32 i = 0; i < total; i++) {
+				const Uint64 k = keys[i];
+				scratch[count[(k >> (b * 8)) & 0xff]++] = k;
+			}
+			std::swap(keys, scratch);
+		}
+		return keys;
+	}
+
+private:
+	static const int MATERIAL_BITS = 16;
+	static const Uint32 MAX_MATERIALS = 1 << MATERIAL_BITS;
+
+	//A texture drawn with a color, the part of the key that picks a batch
+	struct Material {
+		SDL_Texture* texture;
+		SDL_Color color;
+		Uint32 blend;
+	};
+
+	DrawQueue(const DrawQueue&);
+	DrawQueue& operator=(const DrawQueue&);
+
+	static bool sameColor(const SDL_Color& a, const SDL_Color& b) {
+		return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+	}
+
+	static bool isWhite(const SDL_Color& c) {
+		return c.r == 255 && c.g == 255 && c.b == 255 && c.a == 255;
+	}
+
+	//Multiply two color channels, as the renderer does with a color mod
+	static Uint8 modulate(Uint8 a, Uint8 b) {
+		return static_cast<Uint8>((a * b + 127) / 255);
+	}
+
+	//Pack the common blend modes into the key's 4 bits, sorting custom modes last
+	static Uint32 blendBits(SDL_Texture* tex) {
+		SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+		SDL_GetTextureBlendMode(tex, &mode);
+		switch (mode) {
+			case SDL_BLENDMODE_NONE:
+				return 0;
+			case SDL_BLENDMODE_BLEND:
+				return 1;
+			case SDL_BLENDMODE_ADD:
+				return 2;
+			case SDL_BLENDMODE_MOD:
+				return 3;
+			default:
+				return 15;
+		}
+	}
+
+	static Uint32 hash(SDL_Texture* tex, const SDL_Color& color) {
+		const Uint64 p = static_cast<Uint64>(reinterpret_cast<uintptr_t>(tex));
+		const Uint32 c = static_cast<Uint32>(color.r) | color.g << 8 | color.b << 16
+			| static_cast<Uint32>(color.a) << 24;
+		const Uint64 h = (p ^ (p >> 29) ^ c) * 0x9e3779b97f4a7c15ull;
+		return static_cast<Uint32>(h >> 32);
+	}
+
+	//Number every texture and color pair in first-queued order, using an
+	//open addressed table so a frame with many textures stays linear
+	Uint32 material(int* table, Uint32 mask, SDL_Texture* tex, const SDL_Color& color) {
+		for (Uint32 slot = hash(tex, color) & mask; ; slot = (slot + 1) & mask) {
+			const int id = table[slot];
+			if (id < 0) {
+				if (materials.size() >= MAX_MATERIALS) {
+					//Out of ids, the extra textures share the last one and
+					//draw() splits them back into their own batches
+					return MAX_MATERIALS - 1;
+				}
+				Material m = {tex, color, blendBits(tex)};
+				table[slot] = static_cast<int>(materials.size());
+				materials.push_back(m);
+				return table[slot];
+			}
+			const Material& m = materials[id];
+			if (m.texture == tex && sameColor(m.color, color)) {
+				return static_cast<Uint32>(id);
+			}
+		}
+	}
+
+	Uint64* buildKeys() {
+		//Keep the table at most half full so probes stay short
+		Uint32 tableSize = 64;
+		while (tableSize < commands.size() * 2 && tableSize < MAX_MATERIALS * 2) {
+			tableSize *= 2;
+		}
+		int* table = frameArena().alloc<int>(tableSize);
+		for (Uint32 i = 0; i < tableSize; i++) {
+			table[i] = -1;
+		}
+		materials.clear();
+
+		Uint64* keys = frameArena().alloc<Uint64>(commands.size());
+		for (std::vector<DrawCommand>::size_type i = 0; i < commands.size(); i++) {
+			const DrawCommand& cmd = commands[i];
+			const Uint32 id = material(table, tableSize - 1, cmd.texture, cmd.color);
+			const Uint64 layer = cmd.layer < MAX_LAYER ? cmd.layer : MAX_LAYER;
+			keys[i] = layer << 52 | static_cast<Uint64>(materials[id].blend) << 48
+				| static_cast<Uint64>(id) << 32 | static_cast<Uint64>(i);
+		}
+		return keys;
+	}
+
+	//Draw the batch with the texture's tint multiplied by color, then put
+	//its tint back. White leaves the tint as it is
+	void drawTinted(SDL_Renderer* ren, SDL_Texture* tex, const SDL_Color& color) {
+		SDL_Color old;
+		const bool tint = !isWhite(color);
+		if (tint) {
+			SDL_GetTextureColorMod(tex, &old.r, &old.g, &old.b);
+			SDL_GetTextureAlphaMod(tex, &old.a);
+			SDL_SetTextureColorMod(tex, modulate(old.r, color.r), modulate(old.g, color.g),
+				modulate(old.b, color.b));
+			SDL_SetTextureAlphaMod(tex, modulate(old.a, color.a));
+		}
+		batch.draw(ren, tex);
+		if (tint) {
+			SDL_SetTextureColorMod(tex, old.r, old.g, old.b);
+			SDL_SetTextureAlphaMod(tex, old.a);
+		}
+	}
+
+	std::vector<DrawCommand> commands;
+	//Kept between frames so drawing doesn't allocate once they've grown
+	std::vector<Material> materials;
+	SpriteBatch batch;
+};
+
+#endif
@@ -0,0 +1,395 @@
+#ifndef ENTITY_STORE_H
+#define ENTITY_STORE_H
+
+#include <cmath>
+#include <vector>
+#include <SDL.h>
+
+#include "draw_queue.h"
+#include "frame_arena.h"
+#include "sprite_batch.h"
+
+/**
+ * Sprites kept as entities, with each component in its own array rather
+ * than an object per sprite: position, velocity, size, clip, texture and
+ * layer. Systems walk the arrays they need front to back, so moving 100k
+ * entities only streams the positions and velocities through the cache
+ * and never touches their clips or layers.
+ * Entities are referred to by ids that stay the same while they're alive,
+ * the arrays are kept packed by moving the last entity into the place of
+ * one that's destroyed, so an entity's index into the arrays can change and
+ * should be looked up with index() when needed. Ids of destroyed entities
+ * are reused.
+ */
+class EntityStore {
+public:
+	EntityStore() {}
+
+	/**
+	 * Add an entity, standing still.
+	 *
+	 * @param  x       The x coordinate of its top-left corner, in the world.
+	 * @param  y       The y coordinate of its top-left corner, in the world.
+	 * @param  w       The width to draw it at.
+	 * @param  h       The height to draw it at.
+	 * @param  texture The id of the texture to draw it from, see
+	 *                    EntitySprites::addTexture.
+	 * @param  clip    The id of the clip to draw, see EntitySprites::addClip,
+	 *                    or -1 to draw the entire texture.
+	 * @param  layer   Lower layers are drawn first.
+	 * @return         The entity's id.
+	 */
+	int create(float x, float y, int w, int h, Uint16 texture, int clip = -1, Uint16 layer = 0) {
+		int id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+		} else {
+			id = static_cast<int>(slots.size());
+			slots.push_back(-1);
+		}
+		slots[id] = size();
+		ids.push_back(id);
+		xs.push_back(x);
+		ys.push_back(y);
+		vxs.push_back(0);
+		vys.push_back(0);
+		ws.push_back(w);
+		hs.push_back(h);
+		clipIds.push_back(clip);
+		textureIds.push_back(texture);
+		layers.push_back(layer);
+		return id;
+	}
+
+	/**
+	 * Remove an entity, the last entity takes its index.
+	 *
+	 * @param id The entity to remove.
+	 */
+	void destroy(int id) {
+		const int i = slots[id];
+		const int last = size() - 1;
+		if (i != last) {
+			ids[i] = ids[last];
+			xs[i] = xs[last];
+			ys[i] = ys[last];
+			vxs[i] = vxs[last];
+			vys[i] = vys[last];
+			ws[i] = ws[last];
+			hs[i] = hs[last];
+			clipIds[i] = clipIds[last];
+			textureIds[i] = textureIds[last];
+			layers[i] = layers[last];
+			slots[ids[i]] = i;
+		}
+		ids.pop_back();
+		xs.pop_back();
+		ys.pop_back();
+		vxs.pop_back();
+		vys.pop_back();
+		ws.pop_back();
+		hs.pop_back();
+		clipIds.pop_back();
+		textureIds.pop_back();
+		layers.pop_back();
+		slots[id] = -1;
+		freeIds.push_back(id);
+	}
+
+	/**
+	 * Remove every entity, keeping the storage.
+	 */
+	void clear() {
+		ids.clear();
+		xs.clear();
+		ys.clear();
+		vxs.clear();
+		vys.clear();
+		ws.clear();
+		hs.clear();
+		clipIds.clear();
+		textureIds.clear();
+		layers.clear();
+		slots.clear();
+		freeIds.clear();
+	}
+
+	/**
+	 * Make room for a number of entities, so creating them doesn't
+	 * reallocate every array as it goes.
+	 *
+	 * @param count The number of entities.
+	 */
+	void reserve(int count) {
+		ids.reserve(count);
+		xs.reserve(count);
+		ys.reserve(count);
+		vxs.reserve(count);
+		vys.reserve(count);
+		ws.reserve(count);
+		hs.reserve(count);
+		clipIds.reserve(count);
+		textureIds.reserve(count);
+		layers.reserve(count);
+		slots.reserve(count);
+	}
+
+	/**
+	 * @return The number of entities.
+	 */
+	int size() const {
+		return static_cast<int>(ids.size());
+	}
+
+	/**
+	 * @param  id An entity's id.
+	 * @return    True if the entity hasn't been destroyed.
+	 */
+	bool alive(int id) const {
+		return id >= 0 && id < static_cast<int>(slots.size()) && slots[id] >= 0;
+	}
+
+	/**
+	 * @param  id A live entity's id.
+	 * @return    Its index into the component arrays, valid until an
+	 *               entity is destroyed.
+	 */
+	int index(int id) const {
+		return slots[id];
+	}
+
+	/**
+	 * @param  i An index into the component arrays.
+	 * @return   The id of the entity there.
+	 */
+	int id(int i) const {
+		return ids[i];
+	}
+
+	/**
+	 * The component arrays, size() long and indexed the same way. The
+	 * pointers are valid until an entity is created or the store cleared.
+	 */
+	float* posX() {
+		return data(xs);
+	}
+	float* posY() {
+		return data(ys);
+	}
+	float* velX() {
+		return data(vxs);
+	}
+	float* velY() {
+		return data(vys);
+	}
+	int* width() {
+		return data(ws);
+	}
+	int* height() {
+		return data(hs);
+	}
+	int* clip() {
+		return data(clipIds);
+	}
+	Uint16* texture() {
+		return data(textureIds);
+	}
+	Uint16* layer() {
+		return data(layers);
+	}
+	const float* posX() const {
+		return data(xs);
+	}
+	const float* posY() const {
+		return data(ys);
+	}
+	const float* velX() const {
+		return data(vxs);
+	}
+	const float* velY() const {
+		return data(vys);
+	}
+	const int* width() const {
+		return data(ws);
+	}
+	const int* height() const {
+		return data(hs);
+	}
+	const int* clip() const {
+		return data(clipIds);
+	}
+	const Uint16* texture() const {
+		return data(textureIds);
+	}
+	const Uint16* layer() const {
+		return data(layers);
+	}
+
+private:
+	EntityStore(const EntityStore&);
+	EntityStore& operator=(const EntityStore&);
+
+	template<typename T>
+	static T* data(std::vector<T>& v) {
+		return v.empty() ? nullptr : &v[0];
+	}
+	template<typename T>
+	static const T* data(const std::vector<T>& v) {
+		return v.empty() ? nullptr : &v[0];
+	}
+
+	//Index to id, and id to index or -1 if it's free
+	std::vector<int> ids;
+	std::vector<int> slots;
+	std::vector<int> freeIds;
+	std::vector<float> xs;
+	std::vector<float> ys;
+	std::vector<float> vxs;
+	std::vector<float> vys;
+	std::vector<int> ws;
+	std::vector<int> hs;
+	std::vector<int> clipIds;
+	std::vector<Uint16> textureIds;
+	std::vector<Uint16> layers;
+};
+
+/**
+ * Move every entity by its velocity.
+ *
+ * @param store The entities.
+ * @param dt    The time that's passed, in the units the velocities are in.
+ */
+inline void moveEntities(EntityStore& store, float dt) {
+	const int n = store.size();
+	if (n == 0) {
+		return;
+	}
+	//Plain arrays so the compiler knows they don't overlap
+	float* __restrict x = store.posX();
+	float* __restrict y = store.posY();
+	const float* __restrict vx = store.velX();
+	const float* __restrict vy = store.velY();
+	for (int i = 0; i < n; i++) {
+		x[i] += vx[i] * dt;
+		y[i] += vy[i] * dt;
+	}
+}
+
+/**
+ * Draws the entities in an EntityStore through a SpriteBatch, turning their
+ * texture and clip ids back into textures and rects. Each frame draw()
+ * makes one pass over the positions and sizes culling what's out of view,
+ * sorts what's left by layer and texture, and submits a batch per run of
+ * the same texture on a layer. If the entities in view are already stored
+ * in that order, as when they're created a texture at a time, the sort is
+ * skipped.
+ */
+class EntitySprites {
+public:
+	EntitySprites() {}
+
+	/**
+	 * Add a texture entities can be drawn from.
+	 *
+	 * @param  tex The texture, it has to outlive the renderer's use of it.
+	 * @return     The texture's id.
+	 */
+	Uint16 addTexture(SDL_Texture* tex) {
+		textures.push_back(tex);
+		return static_cast<Uint16>(textures.size() - 1);
+	}
+
+	/**
+	 * Add a sub-section of a texture entities can be drawn with.
+	 *
+	 * @param  clip The rect to draw, in the texture's pixels.
+	 * @return      The clip's id.
+	 */
+	int addClip(const SDL_Rect& clip) {
+		clips.push_back(clip);
+		return static_cast<int>(clips.size()) - 1;
+	}
+
+	/**
+	 * Forget every texture and clip.
+	 */
+	void clear() {
+		textures.clear();
+		clips.clear();
+	}
+
+	/**
+	 * Draw every entity that's in view.
+	 *
+	 * @param  ren   The renderer to draw to.
+	 * @param  store The entities to draw.
+	 * @param  view  The area of the world that's on screen, its top-left
+	 *                  corner is drawn at the screen's.
+	 * @return       The number of entities drawn.
+	 */
+	int draw(SDL_Renderer* ren, const EntityStore& store, const SDL_Rect& view) {
+		const int n = store.size();
+		if (n == 0) {
+			return 0;
+		}
+		FrameArena::Scope scope(frameArena());
+		const float* x = store.posX();
+		const float* y = store.posY();
+		const int* w = store.width();
+		const int* h = store.height();
+		const Uint16* layer = store.layer();
+		const Uint16* texture = store.texture();
+		//The layer and texture pick the batch, the index keeps store order
+		Uint64* keys = frameArena().alloc<Uint64>(n);
+		Uint32 visible = 0;
+		bool sorted = true;
+		for (int i = 0; i < n; i++) {
+			const int left = static_cast<int>(std::floor(x[i])) - view.x;
+			const int top = static_cast<int>(std::floor(y[i])) - view.y;
+			if (left >= view.w || top >= view.h || left + w[i] <= 0 || top + h[i] <= 0) {
+				continue;
+			}
+			const Uint64 key = static_cast<Uint64>(layer[i]) << 48
+				| static_cast<Uint64>(texture[i]) << 32 | static_cast<Uint64>(i);
+			sorted = sorted && (visible == 0 || key > keys[visible - 1]);
+			keys[visible++] = key;
+		}
+		if (visible == 0) {
+			return 0;
+		}
+		if (!sorted) {
+			keys = DrawQueue::radixSort(keys, visible);
+		}
+
+		const int* clip = store.clip();
+		Uint32 start = 0;
+		while (start < visible) {
+			const Uint64 run = keys[start] >> 32;
+			SDL_Texture* tex = textures[static_cast<Uint16>(run)];
+			batch.clear();
+			Uint32 end = start;
+			while (end < visible && keys[end] >> 32 == run) {
+				const int i = static_cast<int>(static_cast<Uint32>(keys[end]));
+				const SDL_Rect dst = {static_cast<int>(std::floor(x[i])) - view.x,
+					static_cast<int>(std::floor(y[i])) - view.y, w[i], h[i]};
+				batch.add(dst, clip[i] >= 0 ? &clips[clip[i]] : nullptr);
+				end++;
+			}
+			batch.draw(ren, tex);
+			start = end;
+		}
+		return static_cast<int>(visible);
+	}
+
+private:
+	EntitySprites(const EntitySprites&);
+	EntitySprites& operator=(const EntitySprites&);
+
+	std::vector<SDL_Texture*> textures;
+	std::vector<SDL_Rect> clips;
+	//Kept between frames so drawing doesn't allocate once it's grown
+	SpriteBatch batch;
+};
+
+#endif
@@ -0,0 +1,287 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * Watches directories for files being written, so resources can be
+ * reloaded while the program runs, such as with TextureCache::reloadChanged.
+ * The system tells us what changed, through inotify on Linux and
+ * ReadDirectoryChangesW on Windows, other systems scan the directories'
+ * modified times every POLL_INTERVAL_MS. A file is only reported once it
+ * hasn't changed for SETTLE_MS, so one that's being saved in several writes
+ * is reported once, after the last of them.
+ * Subdirectories aren't watched, and resources read out of res.pak don't
+ * change when their files do, so watch with the pack closed.
+ */
+class FileWatch {
+public:
+	//How long a file has to go unchanged before it's reported
+	static const Uint32 SETTLE_MS = 100;
+	//How often directories are scanned where the system can't tell us
+	static const Uint32 POLL_INTERVAL_MS = 500;
+
+	FileWatch() {
+#if defined(__linux__)
+		fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd < 0) {
+			std::cout << "FileWatch error: inotify_init1 failed" << std::endl;
+		}
+#elif !defined(_WIN32)
+		lastScan = 0;
+#endif
+	}
+	~FileWatch() {
+#if defined(_WIN32)
+		for (std::vector<Directory*>::size_type i = 0; i < dirs.size(); i++) {
+			close(dirs[i]);
+		}
+#elif defined(__linux__)
+		if (fd >= 0) {
+			close(fd);
+		}
+#endif
+	}
+
+	/**
+	 * Start watching a directory.
+	 *
+	 * @param  dir The directory, such as one from getResourcePath.
+	 * @return     True if it's being watched.
+	 */
+	bool watch(const std::string& dir) {
+		std::string path = dir;
+		if (!path.empty() && path[path.size() - 1] != '/' && path[path.size() - 1] != '\\') {
+			path += '/';
+		}
+#if defined(_WIN32)
+		//The system writes to the directory's buffer and overlapped until
+		//it's closed, so they mustn't move
+		Directory* d = new Directory();
+		d->path = path;
+		d->handle = CreateFileA(path.c_str(), FILE_LIST_DIRECTORY,
+			FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+			FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+		ZeroMemory(&d->overlapped, sizeof(d->overlapped));
+		d->overlapped.hEvent = CreateEventA(NULL, TRUE, FALSE, NULL);
+		if (d->handle == INVALID_HANDLE_VALUE || d->overlapped.hEvent == NULL || !request(*d)) {
+			std::cout << "FileWatch error: couldn't watch " << path << std::endl;
+			close(d);
+			return false;
+		}
+		dirs.push_back(d);
+		return true;
+#elif defined(__linux__)
+		if (fd < 0) {
+			return false;
+		}
+		const int wd = inotify_add_watch(fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (wd < 0) {
+			std::cout << "FileWatch error: couldn't watch " << path << std::endl;
+			return false;
+		}
+		dirs[wd] = path;
+		return true;
+#else
+		Directory d;
+		d.path = path;
+		if (!scan(d, SDL_GetTicks(), false)) {
+			std::cout << "FileWatch error: couldn't watch " << path << std::endl;
+			return false;
+		}
+		dirs.push_back(d);
+		return true;
+#endif
+	}
+
+	/**
+	 * Get the files that have been written and have since settled. Doesn't
+	 * block, call once a frame or so.
+	 *
+	 * @param  changed Set to the changed files' paths, the watched
+	 *                    directory's path followed by the file's name.
+	 * @return         The number of changed files.
+	 */
+	int poll(std::vector<std::string>& changed) {
+		changed.clear();
+		const Uint32 now = SDL_GetTicks();
+		gather(now);
+		std::map<std::string, Uint32>::iterator it = pending.begin();
+		while (it != pending.end()) {
+			if (now - it->second >= SETTLE_MS) {
+				changed.push_back(it->first);
+				pending.erase(it++);
+			} else {
+				++it;
+			}
+		}
+		return static_cast<int>(changed.size());
+	}
+
+	/**
+	 * @return True if files have changed that haven't settled yet, so
+	 *            poll() should be called again soon.
+	 */
+	bool settling() const {
+		return !pending.empty();
+	}
+
+private:
+	FileWatch(const FileWatch&);
+	FileWatch& operator=(const FileWatch&);
+
+#if defined(_WIN32)
+	struct Directory {
+		std::string path;
+		HANDLE handle;
+		OVERLAPPED overlapped;
+		//ReadDirectoryChangesW needs DWORD aligned space to write to
+		DWORD buffer[4096];
+	};
+
+	static bool request(Directory& d) {
+		ResetEvent(d.overlapped.hEvent);
+		return ReadDirectoryChangesW(d.handle, d.buffer, sizeof(d.buffer), FALSE,
+			FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME, NULL,
+			&d.overlapped, NULL) != 0;
+	}
+
+	static void close(Directory* d) {
+		if (d->handle != INVALID_HANDLE_VALUE) {
+			//Wait for the cancelled read so nothing's written to d after it's freed
+			CancelIo(d->handle);
+			DWORD bytes;
+			GetOverlappedResult(d->handle, &d->overlapped, &bytes, TRUE);
+			CloseHandle(d->handle);
+		}
+		if (d->overlapped.hEvent != NULL) {
+			CloseHandle(d->overlapped.hEvent);
+		}
+		delete d;
+	}
+
+	void gather(Uint32 now) {
+		for (std::vector<Directory*>::size_type i = 0; i < dirs.size(); i++) {
+			Directory& d = *dirs[i];
+			DWORD bytes = 0;
+			if (!GetOverlappedResult(d.handle, &d.overlapped, &bytes, FALSE)) {
+				continue;
+			}
+			const Uint8* p = reinterpret_cast<const Uint8*>(d.buffer);
+			while (bytes > 0) {
+				const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(p);
+				if (info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_ADDED
+					|| info->Action == FILE_ACTION_RENAMED_NEW_NAME)
+				{
+					const int chars = static_cast<int>(info->FileNameLength / sizeof(WCHAR));
+					char name[MAX_PATH * 3];
+					const int len = WideCharToMultiByte(CP_UTF8, 0, info->FileName, chars,
+						name, sizeof(name), NULL, NULL);
+					if (len > 0) {
+						pending[d.path + std::string(name, len)] = now;
+					}
+				}
+				if (info->NextEntryOffset == 0) {
+					break;
+				}
+				p += info->NextEntryOffset;
+			}
+			//An overflowed buffer reports no bytes, the changes are lost
+			request(d);
+		}
+	}
+
+	std::vector<Directory*> dirs;
+#elif defined(__linux__)
+	void gather(Uint32 now) {
+		if (fd < 0) {
+			return;
+		}
+		//inotify_event is followed by its name, so keep the buffer aligned for it
+		alignas(inotify_event) char buffer[4096];
+		for (;;) {
+			const ssize_t bytes = read(fd, buffer, sizeof(buffer));
+			if (bytes <= 0) {
+				break;
+			}
+			for (ssize_t at = 0; at < bytes; ) {
+				const inotify_event* e = reinterpret_cast<const inotify_event*>(buffer + at);
+				std::map<int, std::string>::const_iterator dir = dirs.find(e->wd);
+				if (e->len > 0 && dir != dirs.end()) {
+					pending[dir->second + e->name] = now;
+				}
+				at += sizeof(inotify_event) + e->len;
+			}
+		}
+	}
+
+	int fd;
+	std::map<int, std::string> dirs;
+#else
+	struct Directory {
+		std::string path;
+		std::map<std::string, time_t> modified;
+	};
+
+	//Read the directory's modified times, reporting any that changed
+	bool scan(Directory& d, Uint32 now, bool report) {
+		DIR* dir = opendir(d.path.c_str());
+		if (dir == nullptr) {
+			return false;
+		}
+		while (dirent* entry = readdir(dir)) {
+			const std::string path = d.path + entry->d_name;
+			struct stat info;
+			if (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+				continue;
+			}
+			std::map<std::string, time_t>::iterator it = d.modified.find(entry->d_name);
+			if (it == d.modified.end() || it->second != info.st_mtime) {
+				d.modified[entry->d_name] = info.st_mtime;
+				if (report) {
+					pending[path] = now;
+				}
+			}
+		}
+		closedir(dir);
+		return true;
+	}
+
+	void gather(Uint32 now) {
+		if (now - lastScan < POLL_INTERVAL_MS) {
+			return;
+		}
+		lastScan = now;
+		for (std::vector<Directory>::size_type i = 0; i < dirs.size(); i++) {
+			scan(dirs[i], now, true);
+		}
+	}
+
+	std::vector<Directory> dirs;
+	Uint32 lastScan;
+#endif
+	//Files that have changed, and the last time they did
+	std::map<std::string, Uint32> pending;
+};
+
+#endif
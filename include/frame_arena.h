@@ -0,0 +1,215 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+#include <SDL.h>
+
+#include "texture_budget.h"
+
+/**
+ * A linear allocator for data that only lives for a frame, or less, such
+ * as vertices, rects and sort keys. Allocating is a pointer bump and
+ * everything is freed at once by reset(), which presentFrame() does after
+ * SDL_RenderPresent. Code that only needs memory for one call can instead
+ * take a Scope, which gives back what was allocated while it was alive.
+ * When a frame needs more than the arena holds the extra comes from the
+ * heap, and once the arena is next empty it grows to fit the most a frame
+ * has used, so in steady state nothing is allocated.
+ * Only types that don't need destructing can be allocated, since nothing
+ * is destructed. The shared arena from frameArena() is for the thread that
+ * renders.
+ */
+class FrameArena {
+public:
+	//256KB, about 12000 sprites' vertices
+	static const size_t DEFAULT_CAPACITY = 256 * 1024;
+
+	/**
+	 * A point to rewind the arena to.
+	 */
+	struct Marker {
+		size_t offset;
+		size_t spills;
+	};
+
+	/**
+	 * Rewinds the arena when it goes out of scope, freeing whatever was
+	 * allocated while it was alive.
+	 */
+	class Scope {
+	public:
+		explicit Scope(FrameArena& owner) : arena(owner), marker(owner.mark()) {}
+		~Scope() {
+			arena.rewind(marker);
+		}
+
+	private:
+		Scope(const Scope&);
+		Scope& operator=(const Scope&);
+
+		FrameArena& arena;
+		const Marker marker;
+	};
+
+	/**
+	 * @param capacity The bytes to allocate up front.
+	 */
+	explicit FrameArena(size_t capacity = DEFAULT_CAPACITY)
+		: block(new Uint8[capacity > 0 ? capacity : 1]), cap(capacity > 0 ? capacity : 1),
+		offset(0), spillBytes(0), peak(0) {}
+	~FrameArena() {
+		freeSpills(0);
+		delete[] block;
+	}
+
+	/**
+	 * Allocate space for count objects, left uninitialized.
+	 *
+	 * @param  count The number of objects.
+	 * @return       The first object, valid until the arena is reset or
+	 *                  rewound past it.
+	 */
+	template<typename T>
+	T* alloc(size_t count) {
+		static_assert(std::is_trivially_destructible<T>::value,
+			"FrameArena never runs destructors");
+		return static_cast<T*>(allocBytes(count * sizeof(T), alignof(T)));
+	}
+
+	/**
+	 * @return A marker that rewind() can return the arena to.
+	 */
+	Marker mark() const {
+		Marker m = {offset, spills.size()};
+		return m;
+	}
+
+	/**
+	 * Free everything allocated since a marker was taken.
+	 *
+	 * @param m The marker, from mark().
+	 */
+	void rewind(const Marker& m) {
+		freeSpills(m.spills);
+		offset = m.offset;
+		if (offset == 0) {
+			grow();
+		}
+	}
+
+	/**
+	 * Free everything, called once a frame has been presented.
+	 */
+	void reset() {
+		freeSpills(0);
+		offset = 0;
+		grow();
+	}
+
+	/**
+	 * @return The bytes allocated right now.
+	 */
+	size_t used() const {
+		return offset + spillBytes;
+	}
+
+	/**
+	 * @return The bytes the arena holds without going to the heap.
+	 */
+	size_t capacity() const {
+		return cap;
+	}
+
+	/**
+	 * @return The most bytes that have been allocated at once.
+	 */
+	size_t highWater() const {
+		return peak;
+	}
+
+private:
+	FrameArena(const FrameArena&);
+	FrameArena& operator=(const FrameArena&);
+
+	void* allocBytes(size_t bytes, size_t align) {
+		const uintptr_t base = reinterpret_cast<uintptr_t>(block);
+		const uintptr_t start = (base + offset + align - 1) & ~static_cast<uintptr_t>(align - 1);
+		const size_t end = static_cast<size_t>(start - base) + bytes;
+		if (end <= cap) {
+			offset = end;
+			track();
+			return reinterpret_cast<void*>(start);
+		}
+		//Out of room, new[] is aligned for any type so spills don't need padding
+		Uint8* spill = new Uint8[bytes > 0 ? bytes : 1];
+		spills.push_back(spill);
+		spillSizes.push_back(bytes);
+		spillBytes += bytes;
+		track();
+		return spill;
+	}
+
+	void track() {
+		if (used() > peak) {
+			peak = used();
+		}
+	}
+
+	void freeSpills(size_t keep) {
+		while (spills.size() > keep) {
+			delete[] spills.back();
+			spillBytes -= spillSizes.back();
+			spills.pop_back();
+			spillSizes.pop_back();
+		}
+	}
+
+	//While empty, grow to the most that's been used so the next frame fits
+	void grow() {
+		if (peak <= cap) {
+			return;
+		}
+		size_t size = cap;
+		while (size < peak) {
+			size *= 2;
+		}
+		delete[] block;
+		block = new Uint8[size];
+		cap = size;
+	}
+
+	Uint8* block;
+	size_t cap;
+	size_t offset;
+	std::vector<Uint8*> spills;
+	std::vector<size_t> spillSizes;
+	size_t spillBytes;
+	size_t peak;
+};
+
+/**
+ * Get the arena shared by everything that renders, reset by presentFrame().
+ *
+ * @return The arena.
+ */
+inline FrameArena& frameArena() {
+	static FrameArena arena;
+	return arena;
+}
+
+/**
+ * Present the frame and free everything allocated for it, and let the
+ * textures it drew be evicted from the textureBudget again.
+ *
+ * @param ren The renderer to present.
+ */
+inline void presentFrame(SDL_Renderer* ren) {
+	SDL_RenderPresent(ren);
+	frameArena().reset();
+	textureBudget().endFrame();
+}
+
+#endif
@@ -0,0 +1,195 @@
+#ifndef GAME_LOOP_H
+#define GAME_LOOP_H
+
+#include <SDL.h>
+
+/**
+ * Drives a loop with a fixed rate simulation and a variable rate render.
+ * Real time is fed into an accumulator each frame and drained in fixed
+ * steps, so the simulation does the same work per second on a 30Hz display
+ * as on a 240Hz one. Rendering happens once per frame and uses alpha() to
+ * blend between the last two simulation states.
+ * If a frame takes too long only maxSteps updates are run and the rest of
+ * the time is dropped, so a slow frame can't snowball into slower ones.
+ *
+ * A frame looks like:
+ *
+ *	loop.beginFrame();
+ *	while (loop.step()) {
+ *		...previous = current; update current by loop.dt()...
+ *	}
+ *	...draw previous + (current - previous) * loop.alpha()...
+ *	SDL_RenderPresent(ren);
+ *	loop.endFrame();
+ */
+class GameLoop {
+public:
+	/**
+	 * @param updateHz The number of simulation steps per second.
+	 * @param maxSteps The most steps to run in one frame before dropping time.
+	 */
+	GameLoop(double updateHz, int maxSteps = 8)
+		: frequency(SDL_GetPerformanceFrequency()), stepCounts(0), limitCounts(0),
+		maxStepCount(maxSteps < 1 ? 1 : maxSteps), lastFrame(0), accumulator(0),
+		elapsed(0), steps(0), updateCount(0), dropped(0)
+	{
+		setUpdateRate(updateHz);
+		reset();
+	}
+
+	/**
+	 * @param hz The number of simulation steps per second.
+	 */
+	void setUpdateRate(double hz) {
+		stepCounts = static_cast<Uint64>(frequency / (hz > 0 ? hz : 60.0));
+		if (stepCounts == 0) {
+			stepCounts = 1;
+		}
+	}
+
+	/**
+	 * Cap the frame rate, for when vsync is off or unavailable.
+	 *
+	 * @param fps The most frames per second to run at, 0 for no limit.
+	 */
+	void setFrameLimit(double fps) {
+		limitCounts = fps > 0 ? static_cast<Uint64>(frequency / fps) : 0;
+	}
+
+	/**
+	 * Forget the time since the last frame, such as after loading or after
+	 * the loop has been asleep waiting for input, so it isn't caught up on.
+	 */
+	void reset() {
+		lastFrame = SDL_GetPerformanceCounter();
+		accumulator = 0;
+		steps = 0;
+	}
+
+	/**
+	 * Start a frame, adding the real time since the last one to the steps
+	 * that are due.
+	 */
+	void beginFrame() {
+		const Uint64 now = SDL_GetPerformanceCounter();
+		advance(now - lastFrame);
+		lastFrame = now;
+	}
+
+	/**
+	 * Start a frame that took a given time instead of the real time, such
+	 * as one read back from a recording, so the same steps are run.
+	 *
+	 * @param seconds The time since the last frame.
+	 */
+	void beginFrame(double seconds) {
+		lastFrame = SDL_GetPerformanceCounter();
+		advance(seconds > 0 ? static_cast<Uint64>(seconds * frequency + 0.5) : 0);
+	}
+
+	/**
+	 * Take the next simulation step if one is due.
+	 *
+	 * @return True if an update should be run.
+	 */
+	bool step() {
+		if (accumulator < stepCounts || steps >= maxStepCount) {
+			return false;
+		}
+		accumulator -= stepCounts;
+		steps++;
+		updateCount++;
+		return true;
+	}
+
+	/**
+	 * Finish the frame, sleeping if it came in under the frame limit.
+	 */
+	void endFrame() {
+		if (limitCounts == 0) {
+			return;
+		}
+		const Uint64 target = lastFrame + limitCounts;
+		for (;;) {
+			const Uint64 now = SDL_GetPerformanceCounter();
+			if (now >= target) {
+				break;
+			}
+			//SDL_Delay can oversleep by a millisecond or so, spin for the last bit
+			const Uint32 ms = static_cast<Uint32>((target - now) * 1000 / frequency);
+			if (ms > 1) {
+				SDL_Delay(ms - 1);
+			}
+		}
+	}
+
+	/**
+	 * @return The length of a simulation step, in seconds.
+	 */
+	double dt() const {
+		return static_cast<double>(stepCounts) / frequency;
+	}
+
+	/**
+	 * @return How far between the last two simulation steps the frame is,
+	 *            from 0 to 1, for interpolating what's drawn.
+	 */
+	double alpha() const {
+		return static_cast<double>(accumulator) / stepCounts;
+	}
+
+	/**
+	 * @return The time the frame started with beginFrame() covers, in
+	 *            seconds, before any of it was dropped.
+	 */
+	double frameTime() const {
+		return static_cast<double>(elapsed) / frequency;
+	}
+
+	/**
+	 * @return The number of steps run this frame.
+	 */
+	int frameSteps() const {
+		return steps;
+	}
+
+	/**
+	 * @return The number of steps run since the loop was created.
+	 */
+	Uint64 updates() const {
+		return updateCount;
+	}
+
+	/**
+	 * @return The number of steps dropped because frames ran too long.
+	 */
+	Uint64 droppedSteps() const {
+		return dropped;
+	}
+
+private:
+	void advance(Uint64 counts) {
+		elapsed = counts;
+		accumulator += counts;
+		steps = 0;
+		//Drop whatever can't be caught up on this frame
+		const Uint64 maxLag = stepCounts * maxStepCount;
+		if (accumulator > maxLag) {
+			dropped += (accumulator - maxLag) / stepCounts;
+			accumulator = maxLag;
+		}
+	}
+
+	const Uint64 frequency;
+	Uint64 stepCounts;
+	Uint64 limitCounts;
+	const int maxStepCount;
+	Uint64 lastFrame;
+	Uint64 accumulator;
+	Uint64 elapsed;
+	int steps;
+	Uint64 updateCount;
+	Uint64 dropped;
+};
+
+#endif
@@ -0,0 +1,305 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <cstring>
+#include <SDL.h>
+
+/**
+ * Gathers a frame's input in one go. update() drains the event queue with
+ * SDL_PeepEvents, many events per call, straight into a ring buffer that's
+ * allocated once, then snapshots the keyboard and mouse. Game code asks
+ * about actions, such as "scroll left", rather than keys; keys and mouse
+ * buttons are bound to actions through a table indexed by scancode, so
+ * looking one up is constant time whatever the number of bindings.
+ * The frame's events stay readable until the next update() for anything
+ * else that wants them, such as a RetainedCanvas.
+ * For input that SDL didn't generate itself, such as a Replay's, the keys
+ * and mouse can instead be tracked from the events alone.
+ */
+class Input {
+public:
+	//Most actions that can be bound
+	static const int MAX_ACTIONS = 64;
+	//Events kept per frame, if a frame has more only the newest are kept
+	//for event(), though all of them update the input state
+	static const int EVENT_CAPACITY = 256;
+
+	Input() : head(0), count(0), quit(false), eventState(false), mouseX(0), mouseY(0),
+		mouseButtons(0), wheelX(0), wheelY(0)
+	{
+		std::memset(keyActions, NO_ACTION, sizeof(keyActions));
+		std::memset(buttonActions, NO_ACTION, sizeof(buttonActions));
+		std::memset(keys, 0, sizeof(keys));
+		clearActions();
+	}
+
+	/**
+	 * Bind a key to an action, replacing the key's old binding.
+	 *
+	 * @param key    The physical key, so bindings work on any layout.
+	 * @param action The action, from 0 to MAX_ACTIONS - 1.
+	 */
+	void bindKey(SDL_Scancode key, int action) {
+		if (static_cast<unsigned>(key) < SDL_NUM_SCANCODES && action >= 0 && action < MAX_ACTIONS) {
+			keyActions[key] = static_cast<Uint8>(action);
+		}
+	}
+
+	/**
+	 * Bind a mouse button to an action, replacing the button's old binding.
+	 *
+	 * @param button The button, such as SDL_BUTTON_LEFT.
+	 * @param action The action, from 0 to MAX_ACTIONS - 1.
+	 */
+	void bindButton(Uint8 button, int action) {
+		if (button < MAX_BUTTONS && action >= 0 && action < MAX_ACTIONS) {
+			buttonActions[button] = static_cast<Uint8>(action);
+		}
+	}
+
+	/**
+	 * Track the keys and mouse from the events instead of SDL's snapshot of
+	 * them, which events pushed onto the queue don't change. The queue also
+	 * isn't pumped, so only events already on it are seen, whoever pushed
+	 * them.
+	 *
+	 * @param fromEvents True to track them from the events.
+	 */
+	void setEventState(bool fromEvents) {
+		eventState = fromEvents;
+	}
+
+	/**
+	 * Drain every pending event and take this frame's snapshot of the
+	 * keyboard and mouse. Call once per frame, as late as possible before
+	 * the update so the input is as fresh as it can be.
+	 *
+	 * @return The number of events drained.
+	 */
+	int update() {
+		clearActions();
+		head = 0;
+		count = 0;
+		wheelX = 0;
+		wheelY = 0;
+
+		if (!eventState) {
+			SDL_PumpEvents();
+		}
+		int drained = 0;
+		for (;;) {
+			//Peep straight into the ring, as much as fits before it wraps
+			const int start = (head + count) % EVENT_CAPACITY;
+			const int n = SDL_PeepEvents(&ring[start], EVENT_CAPACITY - start, SDL_GETEVENT,
+				SDL_FIRSTEVENT, SDL_LASTEVENT);
+			if (n <= 0) {
+				break;
+			}
+			for (int i = 0; i < n; i++) {
+				handle(ring[start + i]);
+			}
+			drained += n;
+			//When the ring is full the oldest events are dropped from view
+			if (count + n > EVENT_CAPACITY) {
+				head = (head + count + n - EVENT_CAPACITY) % EVENT_CAPACITY;
+				count = EVENT_CAPACITY;
+			} else {
+				count += n;
+			}
+		}
+
+		if (!eventState) {
+			int numKeys = 0;
+			const Uint8* state = SDL_GetKeyboardState(&numKeys);
+			std::memcpy(keys, state, numKeys < SDL_NUM_SCANCODES ? numKeys : SDL_NUM_SCANCODES);
+			mouseButtons = SDL_GetMouseState(&mouseX, &mouseY);
+		}
+
+		//An action is held while any of its keys or buttons is
+		for (int k = 0; k < SDL_NUM_SCANCODES; k++) {
+			if (keys[k] && keyActions[k] != NO_ACTION) {
+				actions[keyActions[k]].down = true;
+			}
+		}
+		for (int b = 1; b < MAX_BUTTONS; b++) {
+			if ((mouseButtons & SDL_BUTTON(b)) && buttonActions[b] != NO_ACTION) {
+				actions[buttonActions[b]].down = true;
+			}
+		}
+		return drained;
+	}
+
+	/**
+	 * @return True if the action's key or button is held down.
+	 */
+	bool down(int action) const {
+		return actions[action].down;
+	}
+
+	/**
+	 * @return True if the action's key or button went down this frame,
+	 *            even if it was released again before the frame ended.
+	 */
+	bool pressed(int action) const {
+		return actions[action].pressed;
+	}
+
+	/**
+	 * @return True if the action's key or button was released this frame.
+	 */
+	bool released(int action) const {
+		return actions[action].released;
+	}
+
+	/**
+	 * @return True if the window was asked to close.
+	 */
+	bool quitRequested() const {
+		return quit;
+	}
+
+	/**
+	 * @param  key A physical key.
+	 * @return     True if it was held when the frame's snapshot was taken.
+	 */
+	bool keyDown(SDL_Scancode key) const {
+		return static_cast<unsigned>(key) < SDL_NUM_SCANCODES && keys[key] != 0;
+	}
+
+	/**
+	 * Get the mouse position when the frame's snapshot was taken.
+	 *
+	 * @param x Set to the x coordinate in the window.
+	 * @param y Set to the y coordinate in the window.
+	 * @return  The held buttons, test them with SDL_BUTTON.
+	 */
+	Uint32 mouse(int* x, int* y) const {
+		if (x != nullptr) {
+			*x = mouseX;
+		}
+		if (y != nullptr) {
+			*y = mouseY;
+		}
+		return mouseButtons;
+	}
+
+	/**
+	 * Get how far the mouse wheel moved this frame.
+	 *
+	 * @param x Set to the horizontal distance.
+	 * @param y Set to the vertical distance.
+	 */
+	void wheel(int* x, int* y) const {
+		*x = wheelX;
+		*y = wheelY;
+	}
+
+	/**
+	 * @return The number of events kept from this frame.
+	 */
+	int eventCount() const {
+		return count;
+	}
+
+	/**
+	 * @param  i The event to get, from 0 to eventCount() - 1, oldest first.
+	 * @return   The event.
+	 */
+	const SDL_Event& event(int i) const {
+		return ring[(head + i) % EVENT_CAPACITY];
+	}
+
+private:
+	static const Uint8 NO_ACTION = 0xff;
+	static const int MAX_BUTTONS = 8;
+
+	struct ActionState {
+		bool down;
+		bool pressed;
+		bool released;
+	};
+
+	Input(const Input&);
+	Input& operator=(const Input&);
+
+	void clearActions() {
+		std::memset(actions, 0, sizeof(actions));
+	}
+
+	void handle(const SDL_Event& e) {
+		switch (e.type) {
+			case SDL_QUIT:
+				quit = true;
+				break;
+			case SDL_KEYDOWN:
+			case SDL_KEYUP: {
+				const SDL_Scancode key = e.key.keysym.scancode;
+				if (eventState && static_cast<unsigned>(key) < SDL_NUM_SCANCODES) {
+					keys[key] = e.type == SDL_KEYDOWN;
+				}
+				if (e.key.repeat || static_cast<unsigned>(key) >= SDL_NUM_SCANCODES
+					|| keyActions[key] == NO_ACTION)
+				{
+					break;
+				}
+				ActionState& action = actions[keyActions[key]];
+				if (e.type == SDL_KEYDOWN) {
+					action.pressed = true;
+				} else {
+					action.released = true;
+				}
+				break;
+			}
+			case SDL_MOUSEMOTION:
+				if (eventState) {
+					mouseX = e.motion.x;
+					mouseY = e.motion.y;
+				}
+				break;
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP: {
+				const Uint8 button = e.button.button;
+				if (eventState) {
+					mouseX = e.button.x;
+					mouseY = e.button.y;
+					if (e.type == SDL_MOUSEBUTTONDOWN) {
+						mouseButtons |= SDL_BUTTON(button);
+					} else {
+						mouseButtons &= ~SDL_BUTTON(button);
+					}
+				}
+				if (button >= MAX_BUTTONS || buttonActions[button] == NO_ACTION) {
+					break;
+				}
+				ActionState& action = actions[buttonActions[button]];
+				if (e.type == SDL_MOUSEBUTTONDOWN) {
+					action.pressed = true;
+				} else {
+					action.released = true;
+				}
+				break;
+			}
+			case SDL_MOUSEWHEEL:
+				wheelX += e.wheel.x;
+				wheelY += e.wheel.y;
+				break;
+		}
+	}
+
+	SDL_Event ring[EVENT_CAPACITY];
+	int head;
+	int count;
+	bool quit;
+	bool eventState;
+	Uint8 keyActions[SDL_NUM_SCANCODES];
+	Uint8 buttonActions[MAX_BUTTONS];
+	ActionState actions[MAX_ACTIONS];
+	Uint8 keys[SDL_NUM_SCANCODES];
+	int mouseX;
+	int mouseY;
+	Uint32 mouseButtons;
+	int wheelX;
+	int wheelY;
+};
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef LESSON_IMAGE_H
+#define LESSON_IMAGE_H
+
+#include <string>
+#include <SDL.h>
+
+//The lesson helpers that need SDL_image, built into the sdl2lessons_image
+//library so the lessons that don't use it needn't link it
+
+/**
+ * Loads an image into a texture on the rendering device. If texconv has
+ * converted the image to a .tex file that's uploaded instead, skipping the
+ * image decode, unless the image has been saved since.
+ *
+ * @param  file The image file to load.
+ * @param  ren  The renderer to load the texture onto.
+ * @return      The loaded texture, or nullptr if something went wrong.
+ */
+SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren);
+
+#endif
@@ -0,0 +1,99 @@
+#ifndef LESSON_UTIL_H
+#define LESSON_UTIL_H
+
+#include <iostream>
+#include <string>
+#include <SDL.h>
+
+#include "draw_queue.h"
+
+//The helpers every lesson used to carry its own copy of. They're built once
+//into the sdl2lessons_core library, so an optimization made here reaches
+//every lesson, and with ENABLE_LTO they're still inlined into the draw loops.
+//It only needs SDL, loading images with SDL_image is in lesson_image.h
+
+/**
+ * Log an SDL error with an error message to the output stream.
+ *
+ * @param os  The output stream to write the message to.
+ * @param msg The error message to write, with format "{msg} error: {SDL_GetError()}".
+ */
+void logSDLError(std::ostream& os, const std::string& msg);
+
+/**
+ * Loads a BMP image into a texture on the rendering device, without
+ * SDL_image.
+ *
+ * @param  file The BMP image file to load.
+ * @param  ren  The renderer to load the texture onto.
+ * @return      The loaded texture, or nullptr if something went wrong.
+ */
+SDL_Texture* loadBMPTexture(const std::string& file, SDL_Renderer* ren);
+
+/**
+ * Draw an SDL_Texture to an SDL_Renderer at some destination
+ * rectangle, with optional clipping rectangle.
+ *
+ * @param tex  The source texture we want to draw.
+ * @param ren  The renderer we want to draw to.
+ * @param dst  The destination rectangle to render the texture to.
+ * @param clip The sub-section of the texture to draw, default nullptr
+ *                draws the entire texture.
+ */
+void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, SDL_Rect dst, SDL_Rect* clip = nullptr);
+
+/**
+ * Draw an SDL_Texture to an SDL_Renderer at (x,y), preserving
+ * the texture's width and height and optionally taking a clip of
+ * the texture. If a clip is passed, the clip's width and height
+ * will be used instead of the texture's.
+ *
+ * @param tex  The source texture we want to draw.
+ * @param ren  The renderer we want to draw to.
+ * @param x    The x coordinate to draw to.
+ * @param y    The y coordinate to draw to.
+ * @param clip The sub-section of the texture to draw, default nullptr
+ *                draws the entire texture.
+ */
+void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, SDL_Rect* clip = nullptr);
+
+/**
+ * Draw an SDL_Texture to an SDL_Renderer at (x,y), with
+ * specified width and height.
+ *
+ * @param tex The source texture we want to draw.
+ * @param ren The renderer we want to draw to.
+ * @param x   The x coordinate to draw to.
+ * @param y   The y coordinate to draw to.
+ * @param w   The width of the texture to draw.
+ * @param h   The height of the texture to draw.
+ */
+void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, int w, int h);
+
+/**
+ * Queue an SDL_Texture to be drawn at (x,y), with
+ * specified width and height.
+ *
+ * @param tex   The source texture we want to draw.
+ * @param queue The draw queue we want to draw with.
+ * @param layer The layer to draw the texture on.
+ * @param x     The x coordinate to draw to.
+ * @param y     The y coordinate to draw to.
+ * @param w     The width of the texture to draw.
+ * @param h     The height of the texture to draw.
+ */
+void renderTexture(SDL_Texture* tex, DrawQueue& queue, Uint16 layer, int x, int y, int w, int h);
+
+/**
+ * Queue an SDL_Texture to be drawn at (x,y), preserving
+ * the texture's width and height.
+ *
+ * @param tex   The source texture we want to draw.
+ * @param queue The draw queue we want to draw with.
+ * @param layer The layer to draw the texture on.
+ * @param x     The x coordinate to draw to.
+ * @param y     The y coordinate to draw to.
+ */
+void renderTexture(SDL_Texture* tex, DrawQueue& queue, Uint16 layer, int x, int y);
+
+#endif
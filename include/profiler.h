@@ -0,0 +1,288 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <SDL.h>
+
+/**
+ * Frame timing and draw counting for the render loops, built on
+ * SDL_GetPerformanceCounter. Time is collected per named scope and the
+ * last HISTORY frame times are kept for percentiles, so it's easy to see
+ * whether a loop is CPU bound or waiting on present.
+ */
+class Profiler {
+public:
+	//Number of frames the rolling frame time history covers
+	static const int HISTORY = 256;
+	//Maximum number of named scopes
+	static const int MAX_SCOPES = 16;
+
+	/**
+	 * Summary of the frame times in the history along with the counters
+	 * of the last finished frame. Times are in milliseconds.
+	 */
+	struct Stats {
+		int frames;
+		double last;
+		double p50;
+		double p99;
+		double max;
+		int drawCalls;
+		int textureBinds;
+	};
+
+	Profiler() : toMs(1000.0 / SDL_GetPerformanceFrequency()), scopeCount(0),
+		frameCount(0), frameStart(0), drawCalls(0), textureBinds(0),
+		lastDrawCalls(0), lastTextureBinds(0), boundTexture(nullptr) {}
+
+	/**
+	 * Get the id of a named scope, registering it if it's new.
+	 *
+	 * @param  name The scope's name, it must outlive the profiler.
+	 * @return      The scope id, or -1 if there are too many scopes.
+	 */
+	int scope(const char* name) {
+		for (int i = 0; i < scopeCount; i++) {
+			if (std::strcmp(scopes[i].name, name) == 0) {
+				return i;
+			}
+		}
+		if (scopeCount == MAX_SCOPES) {
+			return -1;
+		}
+		scopes[scopeCount].name = name;
+		scopes[scopeCount].ticks = 0;
+		scopes[scopeCount].lastMs = 0;
+		return scopeCount++;
+	}
+
+	/**
+	 * Add time spent in a scope to the current frame.
+	 *
+	 * @param id    The scope to add to.
+	 * @param ticks The performance counter ticks spent.
+	 */
+	void addTime(int id, Uint64 ticks) {
+		if (id >= 0 && id < scopeCount) {
+			scopes[id].ticks += ticks;
+		}
+	}
+
+	/**
+	 * Mark the start of a frame, resetting the per frame counters.
+	 */
+	void beginFrame() {
+		frameStart = SDL_GetPerformanceCounter();
+		drawCalls = 0;
+		textureBinds = 0;
+		boundTexture = nullptr;
+	}
+
+	/**
+	 * Mark the end of a frame, recording its time and counters.
+	 */
+	void endFrame() {
+		frames[frameCount % HISTORY] = (SDL_GetPerformanceCounter() - frameStart) * toMs;
+		frameCount++;
+		lastDrawCalls = drawCalls;
+		lastTextureBinds = textureBinds;
+		for (int i = 0; i < scopeCount; i++) {
+			scopes[i].lastMs = scopes[i].ticks * toMs;
+			scopes[i].ticks = 0;
+		}
+	}
+
+	/**
+	 * End a frame that wasn't drawn, such as a loop iteration that only
+	 * waited for input, without recording it, so its scope times aren't
+	 * added to the next frame that is.
+	 */
+	void discardFrame() {
+		drawCalls = 0;
+		textureBinds = 0;
+		boundTexture = nullptr;
+		for (int i = 0; i < scopeCount; i++) {
+			scopes[i].ticks = 0;
+		}
+	}
+
+	/**
+	 * Count a draw call, and a texture bind if it uses a different
+	 * texture than the draw before it.
+	 *
+	 * @param tex The texture being drawn.
+	 */
+	void countDraw(SDL_Texture* tex) {
+		drawCalls++;
+		if (tex != boundTexture) {
+			textureBinds++;
+			boundTexture = tex;
+		}
+	}
+
+	/**
+	 * Forget every frame and counter recorded so far, keeping the scopes
+	 * that have been registered, so the stats only cover what's measured
+	 * after this, such as once a warmup is over.
+	 */
+	void reset() {
+		frameCount = 0;
+		std::fill(frames, frames + HISTORY, 0.0);
+		drawCalls = 0;
+		textureBinds = 0;
+		lastDrawCalls = 0;
+		lastTextureBinds = 0;
+		boundTexture = nullptr;
+		for (int i = 0; i < scopeCount; i++) {
+			scopes[i].ticks = 0;
+			scopes[i].lastMs = 0;
+		}
+	}
+
+	/**
+	 * @return The frame time percentiles and last frame's counters.
+	 */
+	Stats stats() const {
+		Stats s;
+		s.frames = frameCount;
+		s.drawCalls = lastDrawCalls;
+		s.textureBinds = lastTextureBinds;
+		s.last = s.p50 = s.p99 = s.max = 0;
+
+		const int n = frameCount < HISTORY ? frameCount : HISTORY;
+		if (n == 0) {
+			return s;
+		}
+		s.last = frames[(frameCount - 1) % HISTORY];
+		std::copy(frames, frames + n, sorted);
+		s.p50 = percentile(n, 0.5);
+		s.p99 = percentile(n, 0.99);
+		s.max = *std::max_element(sorted, sorted + n);
+		return s;
+	}
+
+	/**
+	 * @return The number of draw calls made last frame, cheaper than stats().
+	 */
+	int lastFrameDrawCalls() const {
+		return lastDrawCalls;
+	}
+
+	/**
+	 * @return The number of texture binds made last frame, cheaper than stats().
+	 */
+	int lastFrameTextureBinds() const {
+		return lastTextureBinds;
+	}
+
+	/**
+	 * @return The number of registered scopes.
+	 */
+	int numScopes() const {
+		return scopeCount;
+	}
+
+	/**
+	 * @param  id The scope to look up.
+	 * @return    The scope's name.
+	 */
+	const char* scopeName(int id) const {
+		return scopes[id].name;
+	}
+
+	/**
+	 * @param  id The scope to look up.
+	 * @return    The time spent in the scope last frame, in milliseconds.
+	 */
+	double scopeMs(int id) const {
+		return scopes[id].lastMs;
+	}
+
+	/**
+	 * Write a summary of the frame times and scopes.
+	 *
+	 * @param os The output stream to write the summary to.
+	 */
+	void report(std::ostream& os) const {
+		const Stats s = stats();
+		char line[128];
+		std::snprintf(line, sizeof(line), "frames %d  p50 %.2f ms  p99 %.2f ms  max %.2f ms",
+			s.frames, s.p50, s.p99, s.max);
+		os << line << std::endl;
+		std::snprintf(line, sizeof(line), "draw calls %d  texture binds %d",
+			s.drawCalls, s.textureBinds);
+		os << line << std::endl;
+		for (int i = 0; i < scopeCount; i++) {
+			std::snprintf(line, sizeof(line), "%s %.3f ms", scopes[i].name, scopes[i].lastMs);
+			os << line << std::endl;
+		}
+	}
+
+private:
+	struct Scope {
+		const char* name;
+		Uint64 ticks;
+		double lastMs;
+	};
+
+	Profiler(const Profiler&);
+	Profiler& operator=(const Profiler&);
+
+	//Expects the history to have been copied into sorted
+	double percentile(int n, double p) const {
+		const int i = static_cast<int>(p * (n - 1) + 0.5);
+		std::nth_element(sorted, sorted + i, sorted + n);
+		return sorted[i];
+	}
+
+	const double toMs;
+	Scope scopes[MAX_SCOPES];
+	int scopeCount;
+	double frames[HISTORY];
+	//Scratch space for the percentiles so stats() doesn't allocate
+	mutable double sorted[HISTORY];
+	int frameCount;
+	Uint64 frameStart;
+	int drawCalls;
+	int textureBinds;
+	int lastDrawCalls;
+	int lastTextureBinds;
+	SDL_Texture* boundTexture;
+};
+
+/**
+ * @return The profiler shared by the render loop and the drawing helpers.
+ */
+inline Profiler& profiler() {
+	static Profiler instance;
+	return instance;
+}
+
+/**
+ * Times the rest of the enclosing block and adds it to a profiler scope.
+ */
+class ProfileScope {
+public:
+	/**
+	 * @param id   The scope to add the time to.
+	 * @param prof The profiler the scope belongs to.
+	 */
+	ProfileScope(int id, Profiler& prof = profiler())
+		: profile(prof), scope(id), start(SDL_GetPerformanceCounter()) {}
+	~ProfileScope() {
+		profile.addTime(scope, SDL_GetPerformanceCounter() - start);
+	}
+
+private:
+	ProfileScope(const ProfileScope&);
+	ProfileScope& operator=(const ProfileScope&);
+
+	Profiler& profile;
+	const int scope;
+	const Uint64 start;
+};
+
+#endif
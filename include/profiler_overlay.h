@@ -0,0 +1,65 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include <cstdio>
+#include <SDL.h>
+
+#include "profiler.h"
+#include "text_atlas.h"
+#include "texture_budget.h"
+
+/**
+ * Draw the profiler's frame times, draw counters, texture memory and scope
+ * times as text over a translucent box, using a glyph atlas so it costs no
+ * allocations.
+ *
+ * @param ren   The renderer to draw to.
+ * @param atlas The glyph atlas to draw the text with.
+ * @param x     The x coordinate to draw to.
+ * @param y     The y coordinate to draw to.
+ * @param prof  The profiler to show, default is the shared profiler.
+ */
+inline void drawProfilerOverlay(SDL_Renderer* ren, GlyphAtlas& atlas, int x, int y,
+		const Profiler& prof = profiler()) {
+	const Profiler::Stats s = prof.stats();
+	char text[1024];
+	int len = std::snprintf(text, sizeof(text),
+		"frame %.2f ms  p50 %.2f  p99 %.2f  max %.2f\ndraw calls %d  texture binds %d",
+		s.last, s.p50, s.p99, s.max, s.drawCalls, s.textureBinds);
+	const TextureBudget::Stats t = textureBudget().stats();
+	const double mb = 1024.0 * 1024.0;
+	if (len > 0 && len < static_cast<int>(sizeof(text))) {
+		len += std::snprintf(text + len, sizeof(text) - len,
+			"\ntextures %d  %.1f MB (%.1f pinned)  peak %.1f", t.textures, t.bytes / mb,
+			t.pinnedBytes / mb, t.peakBytes / mb);
+	}
+	if (t.budget > 0 && len > 0 && len < static_cast<int>(sizeof(text))) {
+		len += std::snprintf(text + len, sizeof(text) - len, " / %.0f MB  evicted %d",
+			t.budget / mb, t.evictions);
+	}
+	for (int i = 0; i < prof.numScopes() && len > 0 && len < static_cast<int>(sizeof(text)); i++) {
+		len += std::snprintf(text + len, sizeof(text) - len, "\n%s %.3f ms",
+			prof.scopeName(i), prof.scopeMs(i));
+	}
+
+	//Back the text with a box so it's readable over anything
+	const int margin = 4;
+	SDL_Rect box = {x, y, 0, 0};
+	atlas.measure(text, &box.w, &box.h);
+	box.w += margin * 2;
+	box.h += margin * 2;
+	Uint8 r, g, b, a;
+	SDL_BlendMode blend;
+	SDL_GetRenderDrawColor(ren, &r, &g, &b, &a);
+	SDL_GetRenderDrawBlendMode(ren, &blend);
+	SDL_SetRenderDrawBlendMode(ren, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(ren, 0, 0, 0, 192);
+	SDL_RenderFillRect(ren, &box);
+	SDL_SetRenderDrawColor(ren, r, g, b, a);
+	SDL_SetRenderDrawBlendMode(ren, blend);
+
+	const SDL_Color color = {255, 255, 0, 255};
+	atlas.draw(ren, text, x + margin, y + margin, color);
+}
+
+#endif
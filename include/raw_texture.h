@@ -0,0 +1,330 @@
+#ifndef RAW_TEXTURE_H
+#define RAW_TEXTURE_H
+
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <SDL.h>
+
+#include "res_pack.h"
+
+//Premultiplied alpha needs a custom blend mode, added in SDL 2.0.6
+#if SDL_VERSION_ATLEAST(2, 0, 6)
+#define RAW_TEXTURE_PREMULTIPLIED_BLEND
+#endif
+
+/**
+ * The .tex format written by tools/texconv: pixels already in the
+ * renderer's ARGB8888 layout with premultiplied alpha, optionally LZ4
+ * compressed, so loading one is a copy or an LZ4 decode and a single
+ * SDL_UpdateTexture instead of a PNG inflate and a format conversion.
+ *
+ * The file is little endian:
+ *
+ *	char[4]  magic "RTEX"
+ *	Uint16   version, currently 1
+ *	Uint16   flags, RAW_TEXTURE_PREMULTIPLIED | RAW_TEXTURE_LZ4
+ *	Uint32   width
+ *	Uint32   height
+ *	Uint32   pixel format, SDL_PIXELFORMAT_ARGB8888
+ *	Uint32   payload size
+ *	payload: width * height Uint32 pixels, as one LZ4 block if compressed
+ */
+const Uint16 RAW_TEXTURE_VERSION = 1;
+const Uint16 RAW_TEXTURE_PREMULTIPLIED = 1;
+const Uint16 RAW_TEXTURE_LZ4 = 2;
+const int RAW_TEXTURE_HEADER_SIZE = 24;
+//Larger than any texture a renderer will take, anything bigger is corrupt
+const Uint32 RAW_TEXTURE_MAX_SIZE = 16384;
+
+/**
+ * A decoded .tex file, ready to upload.
+ */
+struct RawImage {
+	RawImage() : w(0), h(0), flags(0), pixels(nullptr) {}
+
+	int w;
+	int h;
+	Uint16 flags;
+	//Either the file in the resource pack or storage
+	const Uint8* pixels;
+	std::vector<Uint8> storage;
+};
+
+/**
+ * Decompress an LZ4 block.
+ *
+ * @param  src     The compressed block.
+ * @param  srcSize The size of the block.
+ * @param  dst     The output buffer.
+ * @param  dstSize The size the block decompresses to.
+ * @return         True if the block decompressed to exactly dstSize bytes.
+ */
+inline bool lz4Decompress(const Uint8* src, size_t srcSize, Uint8* dst, size_t dstSize) {
+	const Uint8* ip = src;
+	const Uint8* const iend = src + srcSize;
+	Uint8* op = dst;
+	Uint8* const oend = dst + dstSize;
+
+	while (ip < iend) {
+		const Uint8 token = *ip++;
+		size_t literals = token >> 4;
+		if (literals == 15) {
+			Uint8 b;
+			do {
+				if (ip >= iend) {
+					return false;
+				}
+				b = *ip++;
+				literals += b;
+			} while (b == 255);
+		}
+		if (literals > static_cast<size_t>(iend - ip) || literals > static_cast<size_t>(oend - op)) {
+			return false;
+		}
+		std::memcpy(op, ip, literals);
+		ip += literals;
+		op += literals;
+		//The last sequence is only literals
+		if (ip == iend) {
+			break;
+		}
+
+		if (iend - ip < 2) {
+			return false;
+		}
+		const size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > static_cast<size_t>(op - dst)) {
+			return false;
+		}
+		size_t length = token & 15;
+		if (length == 15) {
+			Uint8 b;
+			do {
+				if (ip >= iend) {
+					return false;
+				}
+				b = *ip++;
+				length += b;
+			} while (b == 255);
+		}
+		length += 4;
+		if (length > static_cast<size_t>(oend - op)) {
+			return false;
+		}
+		//Matches can overlap the bytes they produce, so copy forwards a byte at a time
+		const Uint8* match = op - offset;
+		for (size_t i = 0; i < length; i++) {
+			op[i] = match[i];
+		}
+		op += length;
+	}
+	return op == oend;
+}
+
+/**
+ * Read and decompress a .tex file. This doesn't touch the renderer, so it's
+ * safe to call from a loading thread.
+ *
+ * @param  file  The .tex file to read.
+ * @param  image Filled with the image.
+ * @return       True if the file was read, false if it's missing or malformed.
+ *                  Only malformed files are logged.
+ */
+inline bool readRawImage(const std::string& file, RawImage& image) {
+	//Read in place out of the pack when one's loaded, only going to disk when
+	//there's no pack, so probing for a .tex the pack doesn't have costs no IO
+	std::vector<Uint8> contents;
+	size_t bytes = 0;
+	const Uint8* data = static_cast<const Uint8*>(findResource(file, &bytes));
+	if (data == nullptr) {
+		if (resourcePack().isOpen()) {
+			return false;
+		}
+		SDL_RWops* rw = SDL_RWFromFile(file.c_str(), "rb");
+		if (rw == nullptr) {
+			return false;
+		}
+		const Sint64 size = SDL_RWsize(rw);
+		contents.resize(size > 0 ? static_cast<size_t>(size) : 0);
+		const bool read = !contents.empty() && SDL_RWread(rw, &contents[0], contents.size(), 1) == 1;
+		SDL_RWclose(rw);
+		if (!read) {
+			std::cout << "RawTexture error: can't read " << file << std::endl;
+			return false;
+		}
+		data = &contents[0];
+		bytes = contents.size();
+	}
+
+	Uint16 version = 0, flags = 0;
+	Uint32 w = 0, h = 0, format = 0, payload = 0;
+	if (bytes >= static_cast<size_t>(RAW_TEXTURE_HEADER_SIZE)) {
+		std::memcpy(&version, data + 4, 2);
+		std::memcpy(&flags, data + 6, 2);
+		std::memcpy(&w, data + 8, 4);
+		std::memcpy(&h, data + 12, 4);
+		std::memcpy(&format, data + 16, 4);
+		std::memcpy(&payload, data + 20, 4);
+		version = SDL_SwapLE16(version);
+		flags = SDL_SwapLE16(flags);
+		w = SDL_SwapLE32(w);
+		h = SDL_SwapLE32(h);
+		format = SDL_SwapLE32(format);
+		payload = SDL_SwapLE32(payload);
+	}
+	const size_t pixelBytes = static_cast<size_t>(w) * h * 4;
+	if (bytes < static_cast<size_t>(RAW_TEXTURE_HEADER_SIZE) || std::memcmp(data, "RTEX", 4) != 0
+		|| version != RAW_TEXTURE_VERSION || format != SDL_PIXELFORMAT_ARGB8888
+		|| w == 0 || h == 0 || w > RAW_TEXTURE_MAX_SIZE || h > RAW_TEXTURE_MAX_SIZE
+		|| payload > bytes - RAW_TEXTURE_HEADER_SIZE
+		|| ((flags & RAW_TEXTURE_LZ4) == 0 && payload != pixelBytes))
+	{
+		std::cout << "RawTexture error: " << file << " is not a valid texture" << std::endl;
+		return false;
+	}
+
+	image.w = static_cast<int>(w);
+	image.h = static_cast<int>(h);
+	image.flags = flags;
+	const Uint8* body = data + RAW_TEXTURE_HEADER_SIZE;
+	if (flags & RAW_TEXTURE_LZ4) {
+		image.storage.resize(pixelBytes);
+		if (!lz4Decompress(body, payload, &image.storage[0], pixelBytes)) {
+			std::cout << "RawTexture error: " << file << " is corrupt" << std::endl;
+			return false;
+		}
+		image.pixels = &image.storage[0];
+	} else if (contents.empty()) {
+		//Straight out of the mapped pack, no copy
+		image.pixels = body;
+	} else {
+		image.storage.assign(body, body + pixelBytes);
+		image.pixels = &image.storage[0];
+	}
+	return true;
+}
+
+/**
+ * Upload a raw image into a new static texture with one SDL_UpdateTexture.
+ * Premultiplied images get a premultiplied blend mode, on renderers that
+ * can't do custom blend modes the alpha is divided back out first.
+ *
+ * @param  ren   The renderer to upload the texture to.
+ * @param  image The image to upload, its pixels may be modified.
+ * @return       The texture, or nullptr if something went wrong.
+ */
+inline SDL_Texture* createRawTexture(SDL_Renderer* ren, RawImage& image) {
+	SDL_Texture* texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+		SDL_TEXTUREACCESS_STATIC, image.w, image.h);
+	if (texture == nullptr) {
+		std::cout << "CreateTexture error: " << SDL_GetError() << std::endl;
+		return nullptr;
+	}
+
+	//Pixels are stored little endian, big endian machines need them swapped
+	//and renderers without premultiplied blending need them unpremultiplied
+	const bool swap = SDL_BYTEORDER == SDL_BIG_ENDIAN;
+	bool unpremultiply = false;
+	if (image.flags & RAW_TEXTURE_PREMULTIPLIED) {
+#ifdef RAW_TEXTURE_PREMULTIPLIED_BLEND
+		const SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+		unpremultiply = SDL_SetTextureBlendMode(texture, premultiplied) != 0;
+#else
+		unpremultiply = true;
+#endif
+	}
+	if (unpremultiply) {
+		SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	}
+
+	if (swap || unpremultiply) {
+		if (image.storage.empty()) {
+			image.storage.assign(image.pixels, image.pixels + static_cast<size_t>(image.w) * image.h * 4);
+			image.pixels = &image.storage[0];
+		}
+		Uint8* p = &image.storage[0];
+		const size_t count = static_cast<size_t>(image.w) * image.h;
+		for (size_t i = 0; i < count; i++, p += 4) {
+			//Bytes are B, G, R, A
+			if (unpremultiply && p[3] != 0 && p[3] != 255) {
+				const unsigned a = p[3];
+				p[0] = static_cast<Uint8>((p[0] * 255 + a / 2) / a);
+				p[1] = static_cast<Uint8>((p[1] * 255 + a / 2) / a);
+				p[2] = static_cast<Uint8>((p[2] * 255 + a / 2) / a);
+			}
+			if (swap) {
+				Uint32 v;
+				std::memcpy(&v, p, 4);
+				v = SDL_SwapLE32(v);
+				std::memcpy(p, &v, 4);
+			}
+		}
+	}
+
+	if (SDL_UpdateTexture(texture, NULL, image.pixels, image.w * 4) != 0) {
+		std::cout << "UpdateTexture error: " << SDL_GetError() << std::endl;
+		SDL_DestroyTexture(texture);
+		return nullptr;
+	}
+	return texture;
+}
+
+/**
+ * Load a .tex file into a texture, this matches the TextureLoader signature
+ * so it can be used with a TextureCache.
+ *
+ * @param  file The .tex file to load.
+ * @param  ren  The renderer to load the texture onto.
+ * @return      The loaded texture, or nullptr if it's missing or something went wrong.
+ */
+inline SDL_Texture* loadRawTexture(const std::string& file, SDL_Renderer* ren) {
+	RawImage image;
+	if (!readRawImage(file, image)) {
+		return nullptr;
+	}
+	return createRawTexture(ren, image);
+}
+
+/**
+ * Get the path texconv writes an image's converted texture to, the same
+ * path with a .tex extension.
+ *
+ * @param  file The image file.
+ * @return      The path of its .tex file.
+ */
+inline std::string rawTexturePath(const std::string& file) {
+	const std::string::size_type dot = file.rfind('.');
+	const std::string::size_type sep = file.find_last_of("/\\");
+	if (dot == std::string::npos || (sep != std::string::npos && dot < sep)) {
+		return file + ".tex";
+	}
+	return file.substr(0, dot) + ".tex";
+}
+
+/**
+ * Check whether an image's .tex file is up to date, so it can be loaded
+ * instead of the image. Out of the pack it always is, on disk it isn't if
+ * the image has been saved since texconv ran, such as while it's being
+ * edited and reloaded by a FileWatch.
+ *
+ * @param  file The image file.
+ * @return      False if the image is newer than its .tex file.
+ */
+inline bool rawTextureCurrent(const std::string& file) {
+	if (resourcePack().isOpen()) {
+		return true;
+	}
+	struct stat image, raw;
+	if (stat(file.c_str(), &image) != 0 || stat(rawTexturePath(file).c_str(), &raw) != 0) {
+		return true;
+	}
+	return image.st_mtime <= raw.st_mtime;
+}
+
+#endif
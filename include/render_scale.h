@@ -0,0 +1,197 @@
+#ifndef RENDER_SCALE_H
+#define RENDER_SCALE_H
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <SDL.h>
+
+#include "cleanup.h"
+#include "frame_arena.h"
+#include "texture_budget.h"
+
+/**
+ * Draws the scene at a lower (or higher) internal resolution than the
+ * window and stretches it to fit, trading sharpness for fill rate. Drawing
+ * code keeps using the logical size, such as 640x480, whatever the window
+ * or the internal resolution are: between begin() and present() the
+ * renderer draws into a target texture scaled from logical coordinates to
+ * the internal resolution, and present() letterboxes it into the window.
+ * The scale defaults to the RENDER_SCALE environment variable, such as 0.5
+ * for half resolution. At a scale of 1, or without render target support,
+ * the scene is drawn straight to the window through SDL_RenderSetLogicalSize,
+ * so it still fits the window but saves no fill rate.
+ * The target must be cleared before the renderer is destroyed.
+ *
+ *	scale.begin();
+ *	...draw in logical coordinates...
+ *	scale.present();
+ */
+class RenderScale {
+public:
+	/**
+	 * @param ren The renderer to draw with.
+	 * @param w   The width the scene is laid out in.
+	 * @param h   The height the scene is laid out in.
+	 */
+	RenderScale(SDL_Renderer* ren, int w, int h)
+		: renderer(ren), target(nullptr), logical(false), logicalW(w), logicalH(h),
+		internalW(w), internalH(h)
+	{
+		const char* env = SDL_getenv("RENDER_SCALE");
+		setScale(env != nullptr ? static_cast<float>(std::atof(env)) : 1.0f);
+	}
+	~RenderScale() {
+		clear();
+	}
+
+	/**
+	 * Change the internal resolution to a fraction of the logical size.
+	 *
+	 * @param  scale The fraction, 0.5 draws a quarter of the pixels. Values
+	 *                  out of 0.1 to 4 are taken as 1.
+	 * @param  smooth True to filter when stretching, false for sharp pixels.
+	 * @return       True if the scene is drawn at that resolution, false if
+	 *                  it's drawn at the window's size instead.
+	 */
+	bool setScale(float scale, bool smooth = true) {
+		if (!(scale >= 0.1f && scale <= 4.0f)) {
+			scale = 1.0f;
+		}
+		clear();
+		internalW = static_cast<int>(logicalW * scale + 0.5f);
+		internalH = static_cast<int>(logicalH * scale + 0.5f);
+		if (internalW < 1) {
+			internalW = 1;
+		}
+		if (internalH < 1) {
+			internalH = 1;
+		}
+		if (scale != 1.0f && SDL_RenderTargetSupported(renderer)) {
+			//Filtering is picked when the texture is made
+			const char* quality = SDL_GetHint(SDL_HINT_RENDER_SCALE_QUALITY);
+			const std::string old = quality != nullptr ? quality : "";
+			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, smooth ? "linear" : "nearest");
+			target = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_TARGET, internalW, internalH);
+			SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, old.empty() ? NULL : old.c_str());
+			if (target == nullptr) {
+				std::cout << "RenderScale error: " << SDL_GetError() << std::endl;
+			}
+			trackTexture(target);
+		}
+		if (target == nullptr) {
+			SDL_RenderSetLogicalSize(renderer, logicalW, logicalH);
+			logical = true;
+			return scale == 1.0f;
+		}
+		return true;
+	}
+
+	/**
+	 * Destroy the target texture, must be called before the renderer is
+	 * destroyed. The scene is then drawn at the window's size.
+	 */
+	void clear() {
+		cleanup(target);
+		target = nullptr;
+		if (logical) {
+			SDL_RenderSetLogicalSize(renderer, 0, 0);
+			logical = false;
+		}
+	}
+
+	/**
+	 * Start drawing a frame, in logical coordinates.
+	 */
+	void begin() {
+		if (target != nullptr) {
+			SDL_SetRenderTarget(renderer, target);
+			SDL_RenderSetScale(renderer, static_cast<float>(internalW) / logicalW,
+				static_cast<float>(internalH) / logicalH);
+		}
+		SDL_RenderClear(renderer);
+	}
+
+	/**
+	 * Stretch the frame to the window and present it.
+	 */
+	void present() {
+		if (target != nullptr) {
+			SDL_SetRenderTarget(renderer, NULL);
+			SDL_RenderSetScale(renderer, 1.0f, 1.0f);
+			SDL_RenderSetViewport(renderer, NULL);
+			//Black bars around the frame if the window's shape differs
+			Uint8 r, g, b, a;
+			SDL_GetRenderDrawColor(renderer, &r, &g, &b, &a);
+			SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+			SDL_RenderClear(renderer);
+			SDL_SetRenderDrawColor(renderer, r, g, b, a);
+			const SDL_Rect dst = output();
+			SDL_RenderCopy(renderer, target, NULL, &dst);
+		}
+		presentFrame(renderer);
+	}
+
+	/**
+	 * @return Where the frame lands in the window, the largest rect with
+	 *            the logical size's shape that fits, centered.
+	 */
+	SDL_Rect output() const {
+		int w, h;
+		SDL_GetRendererOutputSize(renderer, &w, &h);
+		SDL_Rect dst = {0, 0, w, h};
+		//Compare w / h to logicalW / logicalH without dividing
+		if (static_cast<long long>(w) * logicalH > static_cast<long long>(h) * logicalW) {
+			dst.w = static_cast<int>(static_cast<long long>(h) * logicalW / logicalH);
+			dst.x = (w - dst.w) / 2;
+		} else {
+			dst.h = static_cast<int>(static_cast<long long>(w) * logicalH / logicalW);
+			dst.y = (h - dst.h) / 2;
+		}
+		return dst;
+	}
+
+	/**
+	 * Map a window position, such as the mouse's, to logical coordinates.
+	 *
+	 * @param wx The x coordinate in the window.
+	 * @param wy The y coordinate in the window.
+	 * @param x  Set to the x coordinate in the scene.
+	 * @param y  Set to the y coordinate in the scene.
+	 */
+	void toLogical(int wx, int wy, int* x, int* y) const {
+		const SDL_Rect dst = output();
+		*x = dst.w > 0 ? (wx - dst.x) * logicalW / dst.w : 0;
+		*y = dst.h > 0 ? (wy - dst.y) * logicalH / dst.h : 0;
+	}
+
+	/**
+	 * @return The width the scene is drawn at.
+	 */
+	int w() const {
+		return target != nullptr ? internalW : logicalW;
+	}
+
+	/**
+	 * @return The height the scene is drawn at.
+	 */
+	int h() const {
+		return target != nullptr ? internalH : logicalH;
+	}
+
+private:
+	RenderScale(const RenderScale&);
+	RenderScale& operator=(const RenderScale&);
+
+	SDL_Renderer* renderer;
+	SDL_Texture* target;
+	//True if the fallback SDL_RenderSetLogicalSize is in use
+	bool logical;
+	const int logicalW;
+	const int logicalH;
+	int internalW;
+	int internalH;
+};
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef RENDERER_SELECT_H
+#define RENDERER_SELECT_H
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <SDL.h>
+
+/*
+ * Picking the render driver ourselves instead of leaving it to SDL, which
+ * on some systems picks a slow one, and reporting what the renderer can do.
+ * The order drivers are tried in can be changed with the RENDER_DRIVERS
+ * environment variable, a comma separated list such as "opengles2,opengl".
+ * Setting SDL_RENDER_DRIVER still forces a single driver, as it does in SDL.
+ */
+
+//The order drivers are tried in, fastest first
+const char* const DEFAULT_RENDER_DRIVERS =
+	"direct3d11,direct3d12,metal,opengl,opengles2,direct3d,opengles,software";
+
+/**
+ * Find a render driver by name.
+ *
+ * @param  name The driver's name, as in SDL_RendererInfo.
+ * @param  info Set to the driver's info if it's found and this isn't nullptr.
+ * @return      The driver's index for SDL_CreateRenderer, or -1 if it
+ *                 isn't available.
+ */
+inline int findRenderDriver(const std::string& name, SDL_RendererInfo* info = nullptr) {
+	SDL_RendererInfo found;
+	const int count = SDL_GetNumRenderDrivers();
+	for (int i = 0; i < count; i++) {
+		if (SDL_GetRenderDriverInfo(i, &found) == 0 && name == found.name) {
+			if (info != nullptr) {
+				*info = found;
+			}
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Create a renderer with the first driver in the preference order that
+ * supports the flags, falling back to SDL's own choice. Render batching is
+ * turned on, so many draws go to the GPU as one.
+ *
+ * @param  win    The window to render to.
+ * @param  flags  The SDL_RendererFlags to create it with.
+ * @param  order  Comma separated driver names to try, nullptr for the
+ *                   RENDER_DRIVERS environment variable or, if that's not
+ *                   set, DEFAULT_RENDER_DRIVERS.
+ * @return        The renderer, or nullptr if none could be created.
+ */
+inline SDL_Renderer* createRenderer(SDL_Window* win, Uint32 flags, const char* order = nullptr) {
+#ifdef SDL_HINT_RENDER_BATCHING
+	SDL_SetHint(SDL_HINT_RENDER_BATCHING, "1");
+#endif
+	//A forced driver is SDL's to pick
+	const char* forced = SDL_GetHint(SDL_HINT_RENDER_DRIVER);
+	if (forced == nullptr || *forced == '\0') {
+		if (order == nullptr) {
+			order = SDL_getenv("RENDER_DRIVERS");
+		}
+		if (order == nullptr || *order == '\0') {
+			order = DEFAULT_RENDER_DRIVERS;
+		}
+		//Vsync can be asked of any driver, the rest have to be supported
+		const Uint32 needed = flags & ~static_cast<Uint32>(SDL_RENDERER_PRESENTVSYNC);
+		std::istringstream names(order);
+		std::string name;
+		while (std::getline(names, name, ',')) {
+			SDL_RendererInfo info;
+			const int index = findRenderDriver(name, &info);
+			if (index < 0 || (info.flags & needed) != needed) {
+				continue;
+			}
+			SDL_Renderer* ren = SDL_CreateRenderer(win, index, flags);
+			if (ren != nullptr) {
+				return ren;
+			}
+			std::cout << "CreateRenderer " << name << " error: " << SDL_GetError() << std::endl;
+		}
+	}
+	return SDL_CreateRenderer(win, -1, flags);
+}
+
+/**
+ * Log the available drivers and what a renderer supports: its flags, the
+ * largest texture it can make and the texture formats it takes.
+ *
+ * @param os  The output stream to write the report to.
+ * @param ren The renderer to report on.
+ */
+inline void logRendererInfo(std::ostream& os, SDL_Renderer* ren) {
+	os << "Render drivers:";
+	const int count = SDL_GetNumRenderDrivers();
+	for (int i = 0; i < count; i++) {
+		SDL_RendererInfo driver;
+		if (SDL_GetRenderDriverInfo(i, &driver) == 0) {
+			os << " " << driver.name;
+		}
+	}
+	os << std::endl;
+
+	SDL_RendererInfo info;
+	if (SDL_GetRendererInfo(ren, &info) != 0) {
+		os << "GetRendererInfo error: " << SDL_GetError() << std::endl;
+		return;
+	}
+	os << "Renderer: " << info.name
+		<< ((info.flags & SDL_RENDERER_ACCELERATED) ? " accelerated" : "")
+		<< ((info.flags & SDL_RENDERER_SOFTWARE) ? " software" : "")
+		<< ((info.flags & SDL_RENDERER_PRESENTVSYNC) ? " vsync" : "")
+		<< ((info.flags & SDL_RENDERER_TARGETTEXTURE) ? " targets" : "") << std::endl;
+	os << "Max texture size: " << info.max_texture_width << "x" << info.max_texture_height
+		<< std::endl;
+	os << "Texture formats:";
+	for (Uint32 i = 0; i < info.num_texture_formats; i++) {
+		os << " " << SDL_GetPixelFormatName(info.texture_formats[i]);
+	}
+	os << std::endl;
+}
+
+#endif
@@ -0,0 +1,468 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+#include "game_loop.h"
+
+/**
+ * Records a session's input to a compact binary log and plays it back, so
+ * the same heavy session can be run against every build and the frame
+ * times compared. While recording, each frame's events and the time the
+ * frame covered are written as they're read; while playing, real input is
+ * thrown away and each frame gets the recorded events pushed onto the
+ * queue and the recorded time given to the GameLoop, so the program runs
+ * the same steps on the same input however fast or slow it runs.
+ * Either way, the real time of every frame can be written to a text file,
+ * optionally with a hash of what was drawn read back with
+ * SDL_RenderReadPixels, which costs a read back from the GPU each frame.
+ * The environment variables REPLAY_RECORD and REPLAY_PLAY name the log to
+ * record or play, REPLAY_DUMP the file to write the frame times to and
+ * REPLAY_HASH=1 turns on the hashes.
+ *
+ * While recording or playing, beginFrame() is the only thing that pumps
+ * the queue: it takes every event that's waiting, records them or swaps in
+ * the recorded ones, and puts that frame's events back on the queue. The
+ * program then has to read them without pumping, so nothing arrives that
+ * isn't in the log. Read them with pollEvent() instead of SDL_PollEvent, or
+ * with an Input tracking the keys from the events, see
+ * Input::setEventState, which doesn't pump and which pushed events need
+ * since they don't change SDL's snapshot of the keyboard.
+ * Events of types that aren't recorded, such as a window being exposed,
+ * are passed through as they come, whether recording or playing.
+ * The events are written as SDL_Event lays them out in memory, padding and
+ * all, so a log only plays back with the same SDL version on the same
+ * kind of machine it was recorded with.
+ * If writing the log fails, such as when the disk fills up, the error's
+ * logged once and recording stops, leaving the frames written so far.
+ *
+ * A frame looks like:
+ *
+ *	if (!replay.beginFrame(&loop)) {
+ *		...the recording's over...
+ *	}
+ *	while (replay.pollEvent(&e)) {
+ *		...
+ *	}
+ *	...update...
+ *	replay.endFrame(ren);
+ *	SDL_RenderPresent(ren);
+ */
+class Replay {
+public:
+	Replay() : log(nullptr), dump(nullptr), writing(false), hashing(false), finished(false),
+		inFrame(false), frame(0), frameStart(0), hash(0), hashed(false), lastTimestamp(0) {}
+	~Replay() {
+		close();
+	}
+
+	/**
+	 * Start recording or playing, and dumping, as the environment
+	 * variables say.
+	 *
+	 * @return False if a file couldn't be opened.
+	 */
+	bool configure() {
+		bool ok = true;
+		const char* file = SDL_getenv("REPLAY_PLAY");
+		if (file != nullptr && *file != '\0') {
+			ok = play(file);
+		} else if ((file = SDL_getenv("REPLAY_RECORD")) != nullptr && *file != '\0') {
+			ok = record(file);
+		}
+		file = SDL_getenv("REPLAY_DUMP");
+		if (file != nullptr && *file != '\0') {
+			const char* hashes = SDL_getenv("REPLAY_HASH");
+			ok = dumpFrames(file, hashes != nullptr && std::strcmp(hashes, "1") == 0) && ok;
+		}
+		return ok;
+	}
+
+	/**
+	 * Start recording the input to a log, replacing the file.
+	 *
+	 * @param  file The log to write.
+	 * @return      False if it couldn't be opened.
+	 */
+	bool record(const std::string& file) {
+		closeLog();
+		log = SDL_RWFromFile(file.c_str(), "wb");
+		if (log == nullptr) {
+			std::cout << "Replay error: " << SDL_GetError() << std::endl;
+			return false;
+		}
+		writing = true;
+		if (SDL_WriteLE32(log, MAGIC) != 1) {
+			failWrite();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Start playing back a log.
+	 *
+	 * @param  file The log to read.
+	 * @return      False if it couldn't be opened or isn't a log.
+	 */
+	bool play(const std::string& file) {
+		closeLog();
+		log = SDL_RWFromFile(file.c_str(), "rb");
+		if (log == nullptr) {
+			std::cout << "Replay error: " << SDL_GetError() << std::endl;
+			return false;
+		}
+		if (SDL_ReadLE32(log) != MAGIC) {
+			std::cout << "Replay error: " << file << " isn't a replay log" << std::endl;
+			closeLog();
+			return false;
+		}
+		writing = false;
+		finished = false;
+		return true;
+	}
+
+	/**
+	 * Start writing each frame's real time, as lines of
+	 * "frame,milliseconds,hash".
+	 *
+	 * @param  file   The text file to write.
+	 * @param  hashes True to hash what's drawn each frame, 0 is written for
+	 *                   frames that aren't drawn or hashed.
+	 * @return        False if it couldn't be opened.
+	 */
+	bool dumpFrames(const std::string& file, bool hashes) {
+		closeDump();
+		dump = std::fopen(file.c_str(), "w");
+		if (dump == nullptr) {
+			std::cout << "Replay error: couldn't open " << file << std::endl;
+			return false;
+		}
+		hashing = hashes;
+		std::fprintf(dump, "frame,ms,hash\n");
+		return true;
+	}
+
+	/**
+	 * Stop recording, playing and dumping, closing the files.
+	 */
+	void close() {
+		closeLog();
+		closeDump();
+	}
+
+	/**
+	 * @return True if input is being recorded.
+	 */
+	bool recording() const {
+		return log != nullptr && writing;
+	}
+
+	/**
+	 * @return True if input is being played back, until the log runs out.
+	 */
+	bool playing() const {
+		return log != nullptr && !writing;
+	}
+
+	/**
+	 * Start a frame: record its events and time, or swap in the recorded
+	 * ones, and start the loop's frame with that time.
+	 *
+	 * @param  loop The loop to start the frame of, or nullptr for a
+	 *                 program without one.
+	 * @return      False once a recording being played has run out.
+	 */
+	bool beginFrame(GameLoop* loop) {
+		const Uint64 now = SDL_GetPerformanceCounter();
+		const double sinceLast = inFrame
+			? static_cast<double>(now - frameStart) / SDL_GetPerformanceFrequency() : 0;
+		if (inFrame) {
+			writeDump(now);
+		}
+		frameStart = now;
+		hashed = false;
+		inFrame = true;
+		frame++;
+		if (playing()) {
+			double seconds = 0;
+			if (!readFrame(&seconds)) {
+				closeLog();
+				finished = true;
+				inFrame = false;
+				return false;
+			}
+			if (loop != nullptr) {
+				loop->beginFrame(seconds);
+			}
+			return true;
+		}
+		if (loop != nullptr) {
+			loop->beginFrame();
+		}
+		if (recording() && !writeFrame(loop != nullptr ? loop->frameTime() : sinceLast)) {
+			failWrite();
+		}
+		return !finished;
+	}
+
+	/**
+	 * Get the next of this frame's events. While recording or playing it
+	 * doesn't pump, so it only returns the events beginFrame() put on the
+	 * queue, otherwise it's SDL_PollEvent.
+	 *
+	 * @param  e Set to the event.
+	 * @return   False once there are no more.
+	 */
+	bool pollEvent(SDL_Event* e) {
+		if (log == nullptr) {
+			return SDL_PollEvent(e) == 1;
+		}
+		return SDL_PeepEvents(e, 1, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) == 1;
+	}
+
+	/**
+	 * Finish drawing a frame, call before it's presented. Hashes what's
+	 * been drawn to the current render target if hashes are on.
+	 *
+	 * @param ren The renderer that drew the frame.
+	 */
+	void endFrame(SDL_Renderer* ren) {
+		if (!hashing || dump == nullptr) {
+			return;
+		}
+		SDL_Rect view;
+		SDL_RenderGetViewport(ren, &view);
+		if (view.w <= 0 || view.h <= 0) {
+			return;
+		}
+		pixels.resize(static_cast<size_t>(view.w) * view.h);
+		if (SDL_RenderReadPixels(ren, NULL, SDL_PIXELFORMAT_ARGB8888, &pixels[0], view.w * 4) != 0) {
+			std::cout << "Replay error: " << SDL_GetError() << std::endl;
+			hashing = false;
+			return;
+		}
+		//FNV-1a over the pixels
+		Uint64 h = 14695981039346656037ull;
+		for (std::vector<Uint32>::size_type i = 0; i < pixels.size(); i++) {
+			h = (h ^ pixels[i]) * 1099511628211ull;
+		}
+		hash = h;
+		hashed = true;
+	}
+
+private:
+	//"SRPL" at the start of the file
+	static const Uint32 MAGIC = 0x4c505253;
+
+	Replay(const Replay&);
+	Replay& operator=(const Replay&);
+
+	//The size of each type of event that's recorded, 0 for the rest. The
+	//bytes after the type and timestamp are written as they are
+	static size_t eventSize(Uint32 type) {
+		switch (type) {
+			case SDL_QUIT:
+				return sizeof(SDL_QuitEvent);
+			case SDL_WINDOWEVENT:
+				return sizeof(SDL_WindowEvent);
+			case SDL_KEYDOWN:
+			case SDL_KEYUP:
+				return sizeof(SDL_KeyboardEvent);
+			case SDL_TEXTINPUT:
+				return sizeof(SDL_TextInputEvent);
+			case SDL_MOUSEMOTION:
+				return sizeof(SDL_MouseMotionEvent);
+			case SDL_MOUSEBUTTONDOWN:
+			case SDL_MOUSEBUTTONUP:
+				return sizeof(SDL_MouseButtonEvent);
+			case SDL_MOUSEWHEEL:
+				return sizeof(SDL_MouseWheelEvent);
+			default:
+				return 0;
+		}
+	}
+
+	//Numbers are written 7 bits a byte, so small ones take a single byte
+	bool writeNumber(Uint64 v) {
+		Uint8 bytes[10];
+		int n = 0;
+		do {
+			bytes[n] = static_cast<Uint8>(v & 0x7f);
+			v >>= 7;
+			if (v != 0) {
+				bytes[n] |= 0x80;
+			}
+			n++;
+		} while (v != 0);
+		return SDL_RWwrite(log, bytes, 1, n) == static_cast<size_t>(n);
+	}
+
+	bool readNumber(Uint64* v) {
+		*v = 0;
+		for (int shift = 0; shift < 64; shift += 7) {
+			Uint8 b;
+			if (SDL_RWread(log, &b, 1, 1) != 1) {
+				return false;
+			}
+			*v |= static_cast<Uint64>(b & 0x7f) << shift;
+			if ((b & 0x80) == 0) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	//Take every event that's been pumped onto the queue
+	void takeEvents() {
+		SDL_PumpEvents();
+		queued.clear();
+		SDL_Event chunk[64];
+		int n;
+		while ((n = SDL_PeepEvents(chunk, 64, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT)) > 0) {
+			queued.insert(queued.end(), chunk, chunk + n);
+		}
+	}
+
+	//Put the frame's events back on the queue for the program to read
+	void giveEvents() {
+		if (!queued.empty() && SDL_PeepEvents(&queued[0], static_cast<int>(queued.size()),
+			SDL_ADDEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT) < 0)
+		{
+			std::cout << "Replay error: " << SDL_GetError() << std::endl;
+		}
+	}
+
+	//A frame is its time in nanoseconds, the number of events then each
+	//event's type, timestamp from the last event and payload. The events are
+	//put back on the queue even if writing them fails
+	bool writeFrame(double seconds) {
+		takeEvents();
+		Uint64 kept = 0;
+		for (std::vector<SDL_Event>::size_type i = 0; i < queued.size(); i++) {
+			if (eventSize(queued[i].type) > 0) {
+				kept++;
+			}
+		}
+		bool ok = writeNumber(static_cast<Uint64>(seconds * 1e9 + 0.5)) && writeNumber(kept);
+		for (std::vector<SDL_Event>::size_type i = 0; ok && i < queued.size(); i++) {
+			const SDL_Event& e = queued[i];
+			if (eventSize(e.type) == 0) {
+				continue;
+			}
+			const size_t size = eventSize(e.type) - sizeof(SDL_CommonEvent);
+			ok = writeNumber(e.type) && writeNumber(e.common.timestamp - lastTimestamp)
+				&& writeNumber(size)
+				&& SDL_RWwrite(log, reinterpret_cast<const Uint8*>(&e) + sizeof(SDL_CommonEvent),
+					1, size) == size;
+			lastTimestamp = e.common.timestamp;
+		}
+		giveEvents();
+		return ok;
+	}
+
+	bool readFrame(double* seconds) {
+		//Real input is dropped, other than asking to quit and the events
+		//that aren't recorded
+		takeEvents();
+		std::vector<SDL_Event>::size_type live = 0;
+		for (std::vector<SDL_Event>::size_type i = 0; i < queued.size(); i++) {
+			if (queued[i].type == SDL_QUIT || eventSize(queued[i].type) == 0) {
+				queued[live++] = queued[i];
+			}
+		}
+		queued.resize(live);
+		Uint64 ns, count;
+		if (!readNumber(&ns) || !readNumber(&count)) {
+			giveEvents();
+			return false;
+		}
+		*seconds = ns / 1e9;
+		for (Uint64 i = 0; i < count; i++) {
+			Uint64 type, timestamp, size;
+			if (!readNumber(&type) || !readNumber(&timestamp) || !readNumber(&size)
+				|| size > sizeof(SDL_Event) - sizeof(SDL_CommonEvent))
+			{
+				giveEvents();
+				return false;
+			}
+			SDL_Event e;
+			std::memset(&e, 0, sizeof(e));
+			if (size > 0 && SDL_RWread(log, reinterpret_cast<Uint8*>(&e) + sizeof(SDL_CommonEvent),
+				static_cast<size_t>(size), 1) != 1)
+			{
+				giveEvents();
+				return false;
+			}
+			e.type = static_cast<Uint32>(type);
+			lastTimestamp += static_cast<Uint32>(timestamp);
+			e.common.timestamp = lastTimestamp;
+			queued.push_back(e);
+		}
+		giveEvents();
+		return true;
+	}
+
+	void writeDump(Uint64 now) {
+		if (dump == nullptr) {
+			return;
+		}
+		const double ms = (now - frameStart) * 1000.0 / SDL_GetPerformanceFrequency();
+		std::fprintf(dump, "%d,%.3f,%016llx\n", frame, ms,
+			static_cast<unsigned long long>(hashed ? hash : 0));
+	}
+
+	//Closing a log that's being written flushes it, which can fail too
+	void closeLog(bool quiet = false) {
+		if (log != nullptr) {
+			if (SDL_RWclose(log) != 0 && writing && !quiet) {
+				std::cout << "Replay error: couldn't write the log, " << SDL_GetError() << std::endl;
+			}
+			log = nullptr;
+		}
+		lastTimestamp = 0;
+	}
+
+	//Stop recording after a write to the log failed, it's only reported once
+	void failWrite() {
+		std::cout << "Replay error: couldn't write the log, recording stopped, "
+			<< SDL_GetError() << std::endl;
+		closeLog(true);
+	}
+
+	void closeDump() {
+		if (dump != nullptr) {
+			if (inFrame) {
+				writeDump(SDL_GetPerformanceCounter());
+			}
+			std::fclose(dump);
+			dump = nullptr;
+		}
+	}
+
+	SDL_RWops* log;
+	std::FILE* dump;
+	//True if the log is being written, false if it's being read
+	bool writing;
+	bool hashing;
+	//True once the log being played has run out
+	bool finished;
+	//True between a frame starting and the next, while its time is dumped
+	bool inFrame;
+	int frame;
+	Uint64 frameStart;
+	Uint64 hash;
+	bool hashed;
+	Uint32 lastTimestamp;
+	//The frame's events, kept between frames so taking them doesn't allocate
+	std::vector<SDL_Event> queued;
+	std::vector<Uint32> pixels;
+};
+
+#endif
@@ -0,0 +1,330 @@
+#ifndef RES_PACK_H
+#define RES_PACK_H
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "res_path.h"
+
+/**
+ * Everything under res/ packed into one file by tools/respack. The pack is
+ * memory mapped once at startup and files are read straight out of the
+ * mapping with SDL_RWFromConstMem, so loading an asset never opens or stats
+ * a file of its own.
+ *
+ * The file is little endian:
+ *
+ *	char[4]  magic "RPAK"
+ *	Uint32   version, currently 1
+ *	Uint32   file count
+ *	Uint32   alignment of the blobs
+ *	index:   Uint64 offset, Uint64 size, Uint16 length, then the path
+ *	            relative to res/ with / separators, sorted by path
+ *	blobs:   each file's contents, starting on a multiple of the alignment
+ */
+class ResourcePack {
+public:
+	static const Uint32 VERSION = 1;
+
+	ResourcePack() : data(nullptr), size(0)
+#ifdef _WIN32
+		, file(INVALID_HANDLE_VALUE), mapping(NULL)
+#endif
+	{}
+	~ResourcePack() {
+		close();
+	}
+
+	/**
+	 * Map a pack, replacing any pack already open.
+	 *
+	 * @param  path The pack file to open.
+	 * @return      True if the pack was mapped, false if it's missing or malformed.
+	 */
+	bool open(const std::string& path) {
+		close();
+		if (!map(path)) {
+			return false;
+		}
+		if (!readIndex()) {
+			std::cout << "ResourcePack error: " << path << " is not a valid pack" << std::endl;
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Unmap the pack. Anything still reading from it, such as an open
+	 * font, must be closed first.
+	 */
+	void close() {
+		entries.clear();
+		if (data == nullptr) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+		CloseHandle(file);
+		mapping = NULL;
+		file = INVALID_HANDLE_VALUE;
+#else
+		munmap(const_cast<Uint8*>(data), size);
+#endif
+		data = nullptr;
+		size = 0;
+	}
+
+	/**
+	 * @return True if a pack is open.
+	 */
+	bool isOpen() const {
+		return data != nullptr;
+	}
+
+	/**
+	 * Find a file's contents in the pack.
+	 *
+	 * @param  name  The file's path relative to res/, with / separators.
+	 * @param  bytes Set to the file's size if it's found.
+	 * @return       The file's contents, or nullptr if it isn't in the pack.
+	 */
+	const void* find(const std::string& name, size_t* bytes) const {
+		std::vector<Entry>::const_iterator it = std::lower_bound(entries.begin(),
+			entries.end(), name, nameLess);
+		if (it == entries.end() || it->name != name) {
+			return nullptr;
+		}
+		*bytes = it->size;
+		return data + it->offset;
+	}
+
+	/**
+	 * Open a file in the pack for reading.
+	 *
+	 * @param  name The file's path relative to res/, with / separators.
+	 * @return      A read only SDL_RWops over the file, or nullptr if it isn't
+	 *                 in the pack. Close it with SDL_RWclose.
+	 */
+	SDL_RWops* openRW(const std::string& name) const {
+		size_t bytes = 0;
+		const void* contents = find(name, &bytes);
+		return contents != nullptr ? SDL_RWFromConstMem(contents, static_cast<int>(bytes)) : nullptr;
+	}
+
+	/**
+	 * @return The number of files in the pack.
+	 */
+	int count() const {
+		return static_cast<int>(entries.size());
+	}
+
+private:
+	struct Entry {
+		std::string name;
+		Uint64 offset;
+		Uint64 size;
+	};
+
+	ResourcePack(const ResourcePack&);
+	ResourcePack& operator=(const ResourcePack&);
+
+	static bool nameLess(const Entry& e, const std::string& name) {
+		return e.name < name;
+	}
+
+	bool map(const std::string& path) {
+#ifdef _WIN32
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+			OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) {
+			return false;
+		}
+		LARGE_INTEGER length;
+		if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+			CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+			return false;
+		}
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		const void* view = mapping != NULL ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+		if (view == NULL) {
+			std::cout << "ResourcePack error: can't map " << path << std::endl;
+			if (mapping != NULL) {
+				CloseHandle(mapping);
+				mapping = NULL;
+			}
+			CloseHandle(file);
+			file = INVALID_HANDLE_VALUE;
+			return false;
+		}
+		data = static_cast<const Uint8*>(view);
+		size = static_cast<size_t>(length.QuadPart);
+#else
+		const int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			return false;
+		}
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		//The mapping stays valid after the descriptor is closed
+		void* view = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+		if (view == MAP_FAILED) {
+			std::cout << "ResourcePack error: can't map " << path << std::endl;
+			return false;
+		}
+		data = static_cast<const Uint8*>(view);
+		size = static_cast<size_t>(info.st_size);
+#endif
+		return true;
+	}
+
+	//The smallest an index entry can be, with a one character path
+	static const Uint32 ENTRY_BYTES = 8 + 8 + 2 + 1;
+
+	bool readIndex() {
+		//SDL_RWops sizes are ints, so the index has to be in the first 2GB,
+		//and every entry is read through one so none can be bigger than that
+		const size_t indexSize = std::min(size, static_cast<size_t>(INT_MAX));
+		SDL_RWops* rw = SDL_RWFromConstMem(data, static_cast<int>(indexSize));
+		if (rw == nullptr) {
+			return false;
+		}
+		char magic[4];
+		bool ok = SDL_RWread(rw, magic, sizeof(magic), 1) == 1
+			&& SDL_memcmp(magic, "RPAK", 4) == 0
+			&& SDL_ReadLE32(rw) == VERSION;
+		const Uint32 total = ok ? SDL_ReadLE32(rw) : 0;
+		SDL_ReadLE32(rw);
+
+		//A count the index can't hold is malformed, don't reserve with it
+		const Sint64 pos = SDL_RWtell(rw);
+		ok = ok && pos >= 0 && total <= (indexSize - static_cast<size_t>(pos)) / ENTRY_BYTES;
+		if (ok) {
+			entries.reserve(total);
+		}
+		for (Uint32 i = 0; ok && i < total; i++) {
+			Entry e;
+			e.offset = SDL_ReadLE64(rw);
+			e.size = SDL_ReadLE64(rw);
+			const Uint16 len = SDL_ReadLE16(rw);
+			e.name.resize(len);
+			ok = len > 0 && SDL_RWread(rw, &e.name[0], len, 1) == 1
+				&& e.offset <= size && e.size <= size - e.offset && e.size <= INT_MAX
+				&& (entries.empty() || entries.back().name < e.name);
+			entries.push_back(e);
+		}
+		SDL_RWclose(rw);
+		if (!ok) {
+			entries.clear();
+		}
+		return ok;
+	}
+
+	const Uint8* data;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#endif
+	std::vector<Entry> entries;
+};
+
+/**
+ * @return The pack the lessons load their resources from.
+ */
+inline ResourcePack& resourcePack() {
+	static ResourcePack pack;
+	return pack;
+}
+
+/**
+ * Get the path of the resource pack, res.pak next to the res/ directory.
+ *
+ * @return The path of the pack file.
+ */
+inline std::string getResourcePackPath() {
+	std::string base = getResourcePath();
+	//Replace the trailing res/ with res.pak
+	const std::string::size_type pos = base.rfind("res");
+	if (pos != std::string::npos) {
+		base.erase(pos);
+	}
+	return base + "res.pak";
+}
+
+/**
+ * Map the resource pack if one has been built, otherwise resources are
+ * read from their own files under res/. Call once after SDL_Init, before
+ * anything is loaded.
+ *
+ * @return True if the pack was mapped.
+ */
+inline bool openResourcePack() {
+	return resourcePack().open(getResourcePackPath());
+}
+
+/**
+ * Find a resource's contents in the pack, to read it in place.
+ *
+ * @param  file  The resource's path, as built from getResourcePath.
+ * @param  bytes Set to the resource's size if it's found.
+ * @return       The resource's contents, or nullptr if there's no pack or
+ *                  it doesn't have the file.
+ */
+inline const void* findResource(const std::string& file, size_t* bytes) {
+	const ResourcePack& pack = resourcePack();
+	if (!pack.isOpen()) {
+		return nullptr;
+	}
+	const std::string base = getResourcePath();
+	if (file.compare(0, base.size(), base) != 0) {
+		return nullptr;
+	}
+	std::string name = file.substr(base.size());
+	std::replace(name.begin(), name.end(), '\\', '/');
+	return pack.find(name, bytes);
+}
+
+/**
+ * Open a resource for reading, out of the pack if it has the file and from
+ * disk if not.
+ *
+ * @param  file The resource's path, as built from getResourcePath.
+ * @return      An SDL_RWops to read the file with, or nullptr if it couldn't
+ *                 be opened. Pass it to an _RW loader that frees it.
+ */
+inline SDL_RWops* openResource(const std::string& file) {
+	size_t bytes = 0;
+	const void* contents = findResource(file, &bytes);
+	if (contents != nullptr) {
+		return SDL_RWFromConstMem(contents, static_cast<int>(bytes));
+	}
+	return SDL_RWFromFile(file.c_str(), "rb");
+}
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef RETAINED_CANVAS_H
+#define RETAINED_CANVAS_H
+
+#include <iostream>
+#include <SDL.h>
+
+#include "cleanup.h"
+#include "frame_arena.h"
+#include "texture_budget.h"
+
+/**
+ * Retained mode rendering: the scene is kept in a render target texture
+ * and only the regions marked dirty are redrawn into it. When nothing is
+ * dirty there is nothing to draw or present, and wait() lets the loop sleep
+ * in SDL_WaitEventTimeout instead of spinning on SDL_PollEvent.
+ * On renderers without render target support every redraw covers the
+ * whole screen, but idle frames are still skipped.
+ *
+ * A frame looks like:
+ *
+ *	canvas.wait(timeout);
+ *	while (SDL_PollEvent(&e)) { canvas.handleEvent(e); ... }
+ *	if (canvas.begin()) {
+ *		...draw, only the dirty region is touched...
+ *		canvas.present();
+ *	}
+ */
+class RetainedCanvas {
+public:
+	/**
+	 * @param ren The renderer to draw with.
+	 * @param w   The width of the scene, usually the window's.
+	 * @param h   The height of the scene, usually the window's.
+	 */
+	RetainedCanvas(SDL_Renderer* ren, int w, int h)
+		: renderer(ren), canvas(nullptr), width(w), height(h), dirty(false), stale(false)
+	{
+		if (SDL_RenderTargetSupported(renderer)) {
+			canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_TARGET, width, height);
+			if (canvas == nullptr) {
+				std::cout << "RetainedCanvas error: " << SDL_GetError() << std::endl;
+			}
+			trackTexture(canvas);
+		}
+		invalidate();
+	}
+	~RetainedCanvas() {
+		clear();
+	}
+
+	/**
+	 * Destroy the canvas texture, must be called before the renderer is
+	 * destroyed. The canvas then redraws the whole screen every frame.
+	 */
+	void clear() {
+		cleanup(canvas);
+		canvas = nullptr;
+	}
+
+	/**
+	 * Mark the whole scene as needing to be redrawn.
+	 */
+	void invalidate() {
+		const SDL_Rect all = {0, 0, width, height};
+		dirtyRect = all;
+		dirty = true;
+	}
+
+	/**
+	 * Mark part of the scene as needing to be redrawn.
+	 *
+	 * @param area The region that changed.
+	 */
+	void invalidate(const SDL_Rect& area) {
+		//Without a canvas there's nothing to keep between frames
+		if (canvas == nullptr) {
+			invalidate();
+			return;
+		}
+		const SDL_Rect all = {0, 0, width, height};
+		SDL_Rect clipped;
+		if (!SDL_IntersectRect(&area, &all, &clipped)) {
+			return;
+		}
+		if (dirty) {
+			SDL_UnionRect(&dirtyRect, &clipped, &dirtyRect);
+		} else {
+			dirtyRect = clipped;
+			dirty = true;
+		}
+	}
+
+	/**
+	 * Keep the canvas up to date with window and renderer events.
+	 *
+	 * @param e The event to check.
+	 */
+	void handleEvent(const SDL_Event& e) {
+		if (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED) {
+			//The window contents were lost, but the canvas still has them
+			if (canvas != nullptr) {
+				stale = true;
+			} else {
+				invalidate();
+			}
+		} else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+			invalidate();
+		}
+	}
+
+	/**
+	 * @return True if there is anything left to redraw or present.
+	 */
+	bool pending() const {
+		return dirty || stale;
+	}
+
+	/**
+	 * @return The region that will be redrawn by the next frame.
+	 */
+	SDL_Rect dirtyRegion() const {
+		const SDL_Rect none = {0, 0, 0, 0};
+		return dirty ? dirtyRect : none;
+	}
+
+	/**
+	 * Sleep until an event arrives or the timeout passes. Returns straight
+	 * away if there is already something to redraw. The event is left on
+	 * the queue for SDL_PollEvent.
+	 *
+	 * @param timeoutMs The longest to wait for, in milliseconds.
+	 */
+	void wait(int timeoutMs) const {
+		SDL_WaitEventTimeout(NULL, pending() ? 0 : timeoutMs);
+	}
+
+	/**
+	 * Start redrawing the dirty region. Drawing is redirected to the canvas
+	 * and clipped to the dirty region, which is cleared to the current draw
+	 * color first, like SDL_RenderClear.
+	 *
+	 * @return True if the scene should be drawn and present() called,
+	 *            false if nothing is dirty.
+	 */
+	bool begin() {
+		if (!dirty) {
+			if (stale) {
+				show();
+			}
+			return false;
+		}
+		if (canvas == nullptr) {
+			SDL_RenderClear(renderer);
+			return true;
+		}
+		SDL_SetRenderTarget(renderer, canvas);
+		SDL_RenderSetClipRect(renderer, &dirtyRect);
+		SDL_BlendMode blend;
+		SDL_GetRenderDrawBlendMode(renderer, &blend);
+		SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+		SDL_RenderFillRect(renderer, &dirtyRect);
+		SDL_SetRenderDrawBlendMode(renderer, blend);
+		return true;
+	}
+
+	/**
+	 * Finish redrawing and show the scene.
+	 */
+	void present() {
+		if (canvas != nullptr) {
+			SDL_RenderSetClipRect(renderer, NULL);
+			SDL_SetRenderTarget(renderer, NULL);
+		}
+		dirty = false;
+		show();
+	}
+
+private:
+	RetainedCanvas(const RetainedCanvas&);
+	RetainedCanvas& operator=(const RetainedCanvas&);
+
+	//Put the canvas on screen
+	void show() {
+		if (canvas != nullptr) {
+			SDL_RenderCopy(renderer, canvas, NULL, NULL);
+		}
+		//Frees the frame arena too
+		presentFrame(renderer);
+		stale = false;
+	}
+
+	SDL_Renderer* renderer;
+	SDL_Texture* canvas;
+	const int width;
+	const int height;
+	SDL_Rect dirtyRect;
+	bool dirty;
+	bool stale;
+};
+
+#endif
@@ -0,0 +1,227 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <algorithm>
+#include <vector>
+#include <SDL.h>
+
+/**
+ * A uniform grid over the world for finding which drawables overlap an
+ * area, such as the camera's view, without testing every one of them.
+ * Each drawable is a rect listed in every cell it overlaps, so a query only
+ * looks at the cells the area covers and its cost follows what's in view
+ * rather than the size of the world.
+ * Cells should be around the size of the drawables or a bit bigger, a rect
+ * spanning many cells is listed in all of them. Anything outside the world
+ * is kept in the edge cells, so it's still found just less efficiently.
+ */
+class SpatialGrid {
+public:
+	/**
+	 * @param world    The area the drawables are in.
+	 * @param cellSize The width and height of each cell, in pixels.
+	 */
+	SpatialGrid(const SDL_Rect& world, int cellSize)
+		: origin(world), cell(cellSize > 0 ? cellSize : 1),
+		cols((world.w + cell - 1) / cell), rows((world.h + cell - 1) / cell),
+		stamp(0), live(0)
+	{
+		if (cols < 1) {
+			cols = 1;
+		}
+		if (rows < 1) {
+			rows = 1;
+		}
+		cells.resize(cols * rows);
+	}
+
+	/**
+	 * Add a drawable.
+	 *
+	 * @param  bounds The area the drawable covers.
+	 * @return        The drawable's id, ids of removed drawables are reused.
+	 */
+	int insert(const SDL_Rect& bounds) {
+		int id;
+		if (!freeIds.empty()) {
+			id = freeIds.back();
+			freeIds.pop_back();
+		} else {
+			id = static_cast<int>(items.size());
+			items.push_back(Item());
+		}
+		items[id].bounds = bounds;
+		items[id].stamp = 0;
+		link(id);
+		live++;
+		return id;
+	}
+
+	/**
+	 * Change the area a drawable covers. Moving within the same cells only
+	 * updates its rect.
+	 *
+	 * @param id     The drawable to move.
+	 * @param bounds The new area it covers.
+	 */
+	void move(int id, const SDL_Rect& bounds) {
+		int x0, y0, x1, y1, nx0, ny0, nx1, ny1;
+		cellRange(items[id].bounds, &x0, &y0, &x1, &y1);
+		cellRange(bounds, &nx0, &ny0, &nx1, &ny1);
+		if (x0 == nx0 && y0 == ny0 && x1 == nx1 && y1 == ny1) {
+			items[id].bounds = bounds;
+			return;
+		}
+		unlink(id);
+		items[id].bounds = bounds;
+		link(id);
+	}
+
+	/**
+	 * Remove a drawable, its id may be handed out again by insert.
+	 *
+	 * @param id The drawable to remove.
+	 */
+	void remove(int id) {
+		unlink(id);
+		freeIds.push_back(id);
+		live--;
+	}
+
+	/**
+	 * Remove every drawable, keeping the storage.
+	 */
+	void clear() {
+		for (std::vector<std::vector<int> >::size_type i = 0; i < cells.size(); i++) {
+			cells[i].clear();
+		}
+		items.clear();
+		freeIds.clear();
+		live = 0;
+	}
+
+	/**
+	 * @return The number of drawables in the grid.
+	 */
+	int size() const {
+		return live;
+	}
+
+	/**
+	 * @param  id A drawable in the grid.
+	 * @return    The area it covers.
+	 */
+	const SDL_Rect& bounds(int id) const {
+		return items[id].bounds;
+	}
+
+	/**
+	 * Find every drawable that overlaps an area.
+	 *
+	 * @param area The area to look in, such as the camera's view.
+	 * @param out  Filled with the ids of the drawables, lowest first so the
+	 *                order doesn't depend on the cells they were found in.
+	 */
+	void query(const SDL_Rect& area, std::vector<int>& out) {
+		out.clear();
+		if (area.w <= 0 || area.h <= 0) {
+			return;
+		}
+		//Stamp each drawable as it's found so ones in several cells are only
+		//reported once, without clearing a visited set every query
+		if (++stamp == 0) {
+			for (std::vector<Item>::size_type i = 0; i < items.size(); i++) {
+				items[i].stamp = 0;
+			}
+			stamp = 1;
+		}
+		int x0, y0, x1, y1;
+		cellRange(area, &x0, &y0, &x1, &y1);
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				const std::vector<int>& ids = cells[y * cols + x];
+				for (std::vector<int>::size_type i = 0; i < ids.size(); i++) {
+					Item& item = items[ids[i]];
+					if (item.stamp == stamp) {
+						continue;
+					}
+					item.stamp = stamp;
+					if (overlaps(item.bounds, area)) {
+						out.push_back(ids[i]);
+					}
+				}
+			}
+		}
+		std::sort(out.begin(), out.end());
+	}
+
+private:
+	struct Item {
+		Item() : stamp(0) {}
+		SDL_Rect bounds;
+		unsigned stamp;
+	};
+
+	SpatialGrid(const SpatialGrid&);
+	SpatialGrid& operator=(const SpatialGrid&);
+
+	static bool overlaps(const SDL_Rect& a, const SDL_Rect& b) {
+		return a.x < b.x + b.w && a.x + a.w > b.x && a.y < b.y + b.h && a.y + a.h > b.y;
+	}
+
+	//Clamp a cell coordinate to the grid
+	static int clamp(int v, int count) {
+		return v < 0 ? 0 : (v >= count ? count - 1 : v);
+	}
+
+	//Get the range of cells a rect overlaps, inclusive
+	void cellRange(const SDL_Rect& r, int* x0, int* y0, int* x1, int* y1) const {
+		const int w = r.w > 0 ? r.w : 1;
+		const int h = r.h > 0 ? r.h : 1;
+		*x0 = clamp(floorDiv(r.x - origin.x, cell), cols);
+		*y0 = clamp(floorDiv(r.y - origin.y, cell), rows);
+		*x1 = clamp(floorDiv(r.x - origin.x + w - 1, cell), cols);
+		*y1 = clamp(floorDiv(r.y - origin.y + h - 1, cell), rows);
+	}
+
+	static int floorDiv(int a, int b) {
+		return a >= 0 ? a / b : -((-a + b - 1) / b);
+	}
+
+	void link(int id) {
+		int x0, y0, x1, y1;
+		cellRange(items[id].bounds, &x0, &y0, &x1, &y1);
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				cells[y * cols + x].push_back(id);
+			}
+		}
+	}
+
+	void unlink(int id) {
+		int x0, y0, x1, y1;
+		cellRange(items[id].bounds, &x0, &y0, &x1, &y1);
+		for (int y = y0; y <= y1; y++) {
+			for (int x = x0; x <= x1; x++) {
+				std::vector<int>& ids = cells[y * cols + x];
+				std::vector<int>::iterator it = std::find(ids.begin(), ids.end(), id);
+				if (it != ids.end()) {
+					*it = ids.back();
+					ids.pop_back();
+				}
+			}
+		}
+	}
+
+	const SDL_Rect origin;
+	const int cell;
+	int cols;
+	int rows;
+	std::vector<std::vector<int> > cells;
+	std::vector<Item> items;
+	std::vector<int> freeIds;
+	unsigned stamp;
+	int live;
+};
+
+#endif
@@ -0,0 +1,225 @@
+#ifndef SPRITE_ATLAS_H
+#define SPRITE_ATLAS_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+#include "res_pack.h"
+#include "texture_cache.h"
+
+/**
+ * Named regions packed into a few large atlas pages, read from the binary
+ * .atlas sidecar written by tools/atlaspack. Regions are numbered in file
+ * order, so once a name has been looked up with find() the region, its page
+ * and its texture are O(1) array lookups by id.
+ *
+ * The file is little endian:
+ *
+ *	char[4]  magic "SATL"
+ *	Uint16   version, currently 1
+ *	Uint16   page count
+ *	Uint32   region count
+ *	pages:   Uint16 length, then the page's image file relative to the .atlas
+ *	regions: Uint16 length, then the name, Uint16 page, Uint16 x, y, w, h
+ */
+class SpriteAtlas {
+public:
+	static const Uint16 VERSION = 1;
+
+	SpriteAtlas() {}
+
+	/**
+	 * Read an atlas file, replacing anything already loaded. The page
+	 * textures aren't loaded until loadPages is called.
+	 *
+	 * @param  file The .atlas file to read.
+	 * @return      True if the file was read, false if it's missing or malformed.
+	 */
+	bool load(const std::string& file) {
+		clear();
+		regions.clear();
+		regionPages.clear();
+		names.clear();
+		pageFiles.clear();
+
+		SDL_RWops* rw = openResource(file);
+		if (rw == nullptr) {
+			std::cout << "SpriteAtlas error: " << SDL_GetError() << std::endl;
+			return false;
+		}
+		const bool ok = read(rw, directory(file));
+		SDL_RWclose(rw);
+		if (!ok) {
+			std::cout << "SpriteAtlas error: " << file << " is not a valid atlas" << std::endl;
+			regions.clear();
+			regionPages.clear();
+			names.clear();
+			pageFiles.clear();
+		}
+		return ok;
+	}
+
+	/**
+	 * Load every page's texture through a cache, so pages already loaded
+	 * elsewhere are shared.
+	 *
+	 * @param  cache The cache to load the pages with.
+	 * @return       True if every page loaded.
+	 */
+	bool loadPages(TextureCache& cache) {
+		pages.clear();
+		bool ok = true;
+		for (std::vector<std::string>::size_type i = 0; i < pageFiles.size(); i++) {
+			pages.push_back(cache.get(pageFiles[i]));
+			ok = ok && pages.back();
+		}
+		return ok;
+	}
+
+	/**
+	 * Release the page textures, must be called before the renderer is destroyed.
+	 */
+	void clear() {
+		pages.clear();
+	}
+
+	/**
+	 * Look up a region by name. This is a map search, so look names up
+	 * once and keep the id.
+	 *
+	 * @param  name The region's name, the packed image's file name without
+	 *                 its extension.
+	 * @return      The region's id, or -1 if there's no such region.
+	 */
+	int find(const std::string& name) const {
+		std::map<std::string, int>::const_iterator it = names.find(name);
+		return it != names.end() ? it->second : -1;
+	}
+
+	/**
+	 * @return The number of regions in the atlas.
+	 */
+	int size() const {
+		return static_cast<int>(regions.size());
+	}
+
+	/**
+	 * @param  id The region's id, from find or between 0 and size().
+	 * @return    The region's rectangle on its page.
+	 */
+	const SDL_Rect& region(int id) const {
+		return regions[id];
+	}
+
+	/**
+	 * @param  id The region's id.
+	 * @return    The index of the page the region is on.
+	 */
+	int page(int id) const {
+		return regionPages[id];
+	}
+
+	/**
+	 * @param  id The region's id.
+	 * @return    The texture of the page the region is on, or nullptr if
+	 *               the pages aren't loaded.
+	 */
+	SDL_Texture* texture(int id) const {
+		const int p = regionPages[id];
+		return p < static_cast<int>(pages.size()) ? pages[p].get() : nullptr;
+	}
+
+	/**
+	 * @return The number of pages in the atlas.
+	 */
+	int pageCount() const {
+		return static_cast<int>(pageFiles.size());
+	}
+
+	/**
+	 * @param  p The page's index.
+	 * @return   The path of the page's image file.
+	 */
+	const std::string& pageFile(int p) const {
+		return pageFiles[p];
+	}
+
+private:
+	SpriteAtlas(const SpriteAtlas&);
+	SpriteAtlas& operator=(const SpriteAtlas&);
+
+	//The directory part of a path, including its trailing separator
+	static std::string directory(const std::string& file) {
+		const std::string::size_type sep = file.find_last_of("/\\");
+		return sep == std::string::npos ? "" : file.substr(0, sep + 1);
+	}
+
+	//The smallest a region can be, with an empty name
+	static const Uint32 REGION_BYTES = 2 + 5 * 2;
+
+	//Read a length prefixed string
+	static bool readString(SDL_RWops* rw, std::string& str) {
+		const Uint16 len = SDL_ReadLE16(rw);
+		str.resize(len);
+		return len == 0 || SDL_RWread(rw, &str[0], len, 1) == 1;
+	}
+
+	bool read(SDL_RWops* rw, const std::string& dir) {
+		char magic[4];
+		if (SDL_RWread(rw, magic, sizeof(magic), 1) != 1 || SDL_memcmp(magic, "SATL", 4) != 0
+			|| SDL_ReadLE16(rw) != VERSION)
+		{
+			return false;
+		}
+		const Uint16 pageTotal = SDL_ReadLE16(rw);
+		const Uint32 regionTotal = SDL_ReadLE32(rw);
+
+		std::string str;
+		for (Uint16 i = 0; i < pageTotal; i++) {
+			if (!readString(rw, str) || str.empty()) {
+				return false;
+			}
+			pageFiles.push_back(dir + str);
+		}
+		//Every region takes at least REGION_BYTES, so a count the rest of the
+		//file can't hold is malformed, and mustn't be trusted to reserve with
+		const Sint64 size = SDL_RWsize(rw);
+		const Sint64 pos = SDL_RWtell(rw);
+		if (size >= 0 && pos >= 0) {
+			if (regionTotal > static_cast<Uint64>(size - pos) / REGION_BYTES) {
+				return false;
+			}
+			regions.reserve(regionTotal);
+			regionPages.reserve(regionTotal);
+		}
+		for (Uint32 i = 0; i < regionTotal; i++) {
+			if (!readString(rw, str)) {
+				return false;
+			}
+			const Uint16 p = SDL_ReadLE16(rw);
+			SDL_Rect r;
+			r.x = SDL_ReadLE16(rw);
+			r.y = SDL_ReadLE16(rw);
+			r.w = SDL_ReadLE16(rw);
+			r.h = SDL_ReadLE16(rw);
+			if (p >= pageTotal || r.w == 0 || r.h == 0) {
+				return false;
+			}
+			names[str] = static_cast<int>(regions.size());
+			regions.push_back(r);
+			regionPages.push_back(p);
+		}
+		return true;
+	}
+
+	std::vector<SDL_Rect> regions;
+	std::vector<int> regionPages;
+	std::map<std::string, int> names;
+	std::vector<std::string> pageFiles;
+	std::vector<TextureHandle> pages;
+};
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <vector>
+#include <SDL.h>
+
+#include "frame_arena.h"
+#include "profiler.h"
+
+//SDL_RenderGeometry lets a whole batch go to the renderer in one call
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+#define SPRITE_BATCH_GEOMETRY
+#endif
+
+/**
+ * Collects sprites drawn from a single texture and submits them together,
+ * instead of paying for an SDL_RenderCopy per sprite. With SDL 2.0.18 or
+ * newer the whole batch is a single SDL_RenderGeometry call, older versions
+ * fall back to copying each sprite.
+ * The batch keeps its storage between frames, so refilling it with the same
+ * number of sprites doesn't allocate, and the vertices are built in the
+ * frame arena so every batch shares the same memory for them.
+ */
+class SpriteBatch {
+public:
+	SpriteBatch() {}
+
+	/**
+	 * Queue a sprite to be drawn.
+	 *
+	 * @param dst  The destination rectangle to draw the sprite to.
+	 * @param clip The sub-section of the texture to draw, default nullptr
+	 *                draws the entire texture.
+	 */
+	void add(const SDL_Rect& dst, const SDL_Rect* clip = nullptr) {
+		//A negative size marks the sprite as using the entire texture
+		static const SDL_Rect whole = {0, 0, -1, -1};
+		dsts.push_back(dst);
+		srcs.push_back(clip != nullptr ? *clip : whole);
+	}
+
+	/**
+	 * Remove every queued sprite, keeping the storage for the next frame.
+	 */
+	void clear() {
+		dsts.clear();
+		srcs.clear();
+	}
+
+	/**
+	 * @return The number of queued sprites.
+	 */
+	int size() const {
+		return static_cast<int>(dsts.size());
+	}
+
+	/**
+	 * Draw every queued sprite with a texture. The queue is left as is
+	 * so a batch that doesn't change can be drawn again every frame.
+	 *
+	 * @param  ren The renderer to draw to.
+	 * @param  tex The texture the sprites are drawn from.
+	 * @return     0 on success, or a negative error code from SDL.
+	 */
+	int draw(SDL_Renderer* ren, SDL_Texture* tex) {
+		if (dsts.empty()) {
+			return 0;
+		}
+#ifdef SPRITE_BATCH_GEOMETRY
+		int texW, texH;
+		if (SDL_QueryTexture(tex, NULL, NULL, &texW, &texH) != 0) {
+			return -1;
+		}
+		//Geometry isn't affected by the texture's color and alpha mod,
+		//so apply them to the vertices instead
+		SDL_Color color;
+		SDL_GetTextureColorMod(tex, &color.r, &color.g, &color.b);
+		SDL_GetTextureAlphaMod(tex, &color.a);
+
+		const float invW = 1.0f / texW;
+		const float invH = 1.0f / texH;
+		const int count = size();
+		FrameArena::Scope scope(frameArena());
+		SDL_Vertex* vertices = frameArena().alloc<SDL_Vertex>(count * 4);
+		//Every quad uses the same two triangles, so only extend the indices
+		for (int i = static_cast<int>(indices.size()) / 6; i < count; i++) {
+			const int corners[6] = {0, 1, 2, 2, 1, 3};
+			for (int j = 0; j < 6; j++) {
+				indices.push_back(i * 4 + corners[j]);
+			}
+		}
+
+		for (int i = 0; i < count; i++) {
+			const SDL_Rect& dst = dsts[i];
+			SDL_Rect src = srcs[i];
+			if (src.w < 0) {
+				src.w = texW;
+				src.h = texH;
+			}
+			const float x0 = static_cast<float>(dst.x);
+			const float y0 = static_cast<float>(dst.y);
+			const float x1 = static_cast<float>(dst.x + dst.w);
+			const float y1 = static_cast<float>(dst.y + dst.h);
+			const float u0 = src.x * invW;
+			const float v0 = src.y * invH;
+			const float u1 = (src.x + src.w) * invW;
+			const float v1 = (src.y + src.h) * invH;
+
+			SDL_Vertex* quad = &vertices[i * 4];
+			quad[0].position.x = x0; quad[0].position.y = y0;
+			quad[0].tex_coord.x = u0; quad[0].tex_coord.y = v0;
+			quad[1].position.x = x1; quad[1].position.y = y0;
+			quad[1].tex_coord.x = u1; quad[1].tex_coord.y = v0;
+			quad[2].position.x = x0; quad[2].position.y = y1;
+			quad[2].tex_coord.x = u0; quad[2].tex_coord.y = v1;
+			quad[3].position.x = x1; quad[3].position.y = y1;
+			quad[3].tex_coord.x = u1; quad[3].tex_coord.y = v1;
+			for (int j = 0; j < 4; j++) {
+				quad[j].color = color;
+			}
+		}
+		profiler().countDraw(tex);
+		return SDL_RenderGeometry(ren, tex, vertices, count * 4, &indices[0], count * 6);
+#else
+		int result = 0;
+		for (std::vector<SDL_Rect>::size_type i = 0; i < dsts.size(); i++) {
+			const SDL_Rect* clip = srcs[i].w < 0 ? nullptr : &srcs[i];
+			profiler().countDraw(tex);
+			if (SDL_RenderCopy(ren, tex, clip, &dsts[i]) != 0) {
+				result = -1;
+			}
+		}
+		return result;
+#endif
+	}
+
+private:
+	SpriteBatch(const SpriteBatch&);
+	SpriteBatch& operator=(const SpriteBatch&);
+
+	std::vector<SDL_Rect> dsts;
+	std::vector<SDL_Rect> srcs;
+#ifdef SPRITE_BATCH_GEOMETRY
+	std::vector<int> indices;
+#endif
+};
+
+#endif
@@ -0,0 +1,209 @@
+#ifndef STREAMING_TEXTURE_H
+#define STREAMING_TEXTURE_H
+
+#include <iostream>
+#include <SDL.h>
+
+#include "cleanup.h"
+#include "texture_budget.h"
+
+/**
+ * A texture for pixels made on the CPU every frame, such as video frames or
+ * procedural effects, written straight into locked texture memory instead
+ * of going through a new surface and texture each time.
+ * It's made of two or three SDL_TEXTUREACCESS_STREAMING textures used in
+ * turn, so the one being written isn't the one the GPU may still be
+ * drawing from. Only the area that changed has to be locked and uploaded,
+ * but since each texture misses the changes made while the others were in
+ * use, lock() widens the area to cover those and hands back the rect that
+ * actually has to be written.
+ * Pixels are ARGB8888. The textures must be cleared before the renderer is
+ * destroyed.
+ *
+ * A frame looks like:
+ *
+ *	SDL_Rect area;
+ *	int pitch;
+ *	Uint32* pixels = stream.lock(&changed, &area, &pitch);
+ *	if (pixels != nullptr) {
+ *		...write every pixel of area, row by row pitch bytes apart...
+ *		stream.unlock();
+ *	}
+ *	SDL_RenderCopy(ren, stream.texture(), NULL, &dst);
+ */
+class StreamingTexture {
+public:
+	//Most textures to use in turn
+	static const int MAX_BUFFERS = 3;
+
+	StreamingTexture() : count(0), current(-1), locked(-1), width(0), height(0) {
+		for (int i = 0; i < MAX_BUFFERS; i++) {
+			textures[i] = nullptr;
+		}
+	}
+	~StreamingTexture() {
+		clear();
+	}
+
+	/**
+	 * Create the textures, replacing any made before.
+	 *
+	 * @param  ren     The renderer to create them on.
+	 * @param  w       The width in pixels.
+	 * @param  h       The height in pixels.
+	 * @param  buffers The number of textures to use in turn, 1 to MAX_BUFFERS.
+	 *                    Renderers that copy the pixels on unlock, such as
+	 *                    the software one, gain nothing from more than 1.
+	 * @return         True if they were created.
+	 */
+	bool create(SDL_Renderer* ren, int w, int h, int buffers = 2) {
+		clear();
+		if (buffers < 1) {
+			buffers = 1;
+		} else if (buffers > MAX_BUFFERS) {
+			buffers = MAX_BUFFERS;
+		}
+		for (int i = 0; i < buffers; i++) {
+			textures[i] = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_STREAMING, w, h);
+			if (textures[i] == nullptr) {
+				std::cout << "StreamingTexture error: " << SDL_GetError() << std::endl;
+				clear();
+				return false;
+			}
+			trackTexture(textures[i]);
+			//Nothing has been written to any of them yet
+			stale[i].x = 0;
+			stale[i].y = 0;
+			stale[i].w = w;
+			stale[i].h = h;
+		}
+		count = buffers;
+		width = w;
+		height = h;
+		return true;
+	}
+
+	/**
+	 * Destroy the textures, must be called before the renderer is destroyed.
+	 */
+	void clear() {
+		if (locked >= 0) {
+			unlock();
+		}
+		for (int i = 0; i < MAX_BUFFERS; i++) {
+			cleanup(textures[i]);
+			textures[i] = nullptr;
+		}
+		count = 0;
+		current = -1;
+	}
+
+	/**
+	 * Lock the next texture to write to it.
+	 *
+	 * @param  area   The area that changed since the last frame, nullptr for
+	 *                   all of it.
+	 * @param  rect   Set to the area that's locked, which covers area and
+	 *                   anything this texture missed. Every pixel in it has
+	 *                   to be written, what's there to begin with is undefined.
+	 * @param  pitch  Set to the bytes from one row to the next.
+	 * @return        The first pixel of rect, nullptr if there's nothing to
+	 *                   write or it couldn't be locked. Valid until unlock().
+	 */
+	Uint32* lock(const SDL_Rect* area, SDL_Rect* rect, int* pitch) {
+		if (count == 0 || locked >= 0) {
+			return nullptr;
+		}
+		const int next = (current + 1) % count;
+		const SDL_Rect all = {0, 0, width, height};
+		SDL_Rect want = all;
+		if (area != nullptr && !SDL_IntersectRect(area, &all, &want)) {
+			want.w = 0;
+			want.h = 0;
+		}
+		//Catch up on whatever changed while the other textures were in use
+		if (stale[next].w > 0 && stale[next].h > 0) {
+			if (want.w > 0 && want.h > 0) {
+				SDL_UnionRect(&want, &stale[next], &want);
+			} else {
+				want = stale[next];
+			}
+		}
+		if (want.w <= 0 || want.h <= 0) {
+			return nullptr;
+		}
+		void* pixels = nullptr;
+		if (SDL_LockTexture(textures[next], &want, &pixels, pitch) != 0) {
+			std::cout << "StreamingTexture error: " << SDL_GetError() << std::endl;
+			return nullptr;
+		}
+		locked = next;
+		lockedRect = want;
+		if (rect != nullptr) {
+			*rect = want;
+		}
+		return static_cast<Uint32*>(pixels);
+	}
+
+	/**
+	 * Upload what was written and make the texture the one that's drawn.
+	 */
+	void unlock() {
+		if (locked < 0) {
+			return;
+		}
+		SDL_UnlockTexture(textures[locked]);
+		//The others now miss this area
+		for (int i = 0; i < count; i++) {
+			if (i == locked) {
+				stale[i].w = 0;
+				stale[i].h = 0;
+			} else if (stale[i].w > 0 && stale[i].h > 0) {
+				SDL_UnionRect(&stale[i], &lockedRect, &stale[i]);
+			} else {
+				stale[i] = lockedRect;
+			}
+		}
+		current = locked;
+		locked = -1;
+	}
+
+	/**
+	 * @return The texture with the latest pixels, or nullptr if nothing
+	 *            has been written yet.
+	 */
+	SDL_Texture* texture() const {
+		return current >= 0 ? textures[current] : nullptr;
+	}
+
+	/**
+	 * @return The width in pixels.
+	 */
+	int w() const {
+		return width;
+	}
+
+	/**
+	 * @return The height in pixels.
+	 */
+	int h() const {
+		return height;
+	}
+
+private:
+	StreamingTexture(const StreamingTexture&);
+	StreamingTexture& operator=(const StreamingTexture&);
+
+	SDL_Texture* textures[MAX_BUFFERS];
+	//The area each texture is behind on
+	SDL_Rect stale[MAX_BUFFERS];
+	SDL_Rect lockedRect;
+	int count;
+	int current;
+	int locked;
+	int width;
+	int height;
+};
+
+#endif
@@ -0,0 +1,551 @@
+#ifndef SURFACE_OPS_H
+#define SURFACE_OPS_H
+
+#include <SDL.h>
+
+/*
+ * Pixel kernels for getting surfaces ready to upload: expanding 24-bit
+ * images to 32-bit, premultiplying alpha, turning a color key into alpha
+ * and tinting or blending. Every kernel works on ARGB8888 pixels and has a
+ * plain C++ version plus SSE2, SSSE3 and AVX2 versions on x86 and a NEON
+ * version on ARM. The fastest one the CPU supports is picked the first time
+ * they're used, so one build runs everywhere.
+ * SSE2 has no byte shuffle, so 24-bit expansion without SSSE3 is done by
+ * the plain version.
+ */
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define SURFACE_OPS_X86 1
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <immintrin.h>
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)) \
+	&& SDL_BYTEORDER == SDL_LIL_ENDIAN
+#define SURFACE_OPS_NEON 1
+#include <arm_neon.h>
+#endif
+
+//GCC and Clang only emit instructions outside the target's baseline in
+//functions marked for them, MSVC emits any intrinsic it's given
+#if defined(__GNUC__)
+#define SURFACE_OPS_TARGET(isa) __attribute__((target(isa)))
+#else
+#define SURFACE_OPS_TARGET(isa)
+#endif
+
+/**
+ * One set of kernels, each works on a row of count pixels.
+ */
+struct SurfaceKernels {
+	//Name of the instruction set, for logging
+	const char* name;
+	//Expand 24-bit pixels to opaque ARGB8888, src is in BGR byte order
+	//or RGB if swapRB is set
+	void (*expand24)(const Uint8* src, Uint32* dst, int count, bool swapRB);
+	//Multiply each pixel's color by its alpha
+	void (*premultiply)(Uint32* pixels, int count);
+	//Make pixels whose color matches key, ignoring alpha, transparent black
+	void (*colorKey)(Uint32* pixels, int count, Uint32 key);
+	//Multiply each channel, alpha included, by the color's channels
+	void (*tint)(Uint32* pixels, int count, SDL_Color color);
+	//Draw premultiplied src over dst
+	void (*blend)(const Uint32* src, Uint32* dst, int count);
+};
+
+//x * y / 255, rounded, for x and y from 0 to 255
+inline Uint32 surfaceMul255(Uint32 x, Uint32 y) {
+	const Uint32 t = x * y + 128;
+	return (t + (t >> 8)) >> 8;
+}
+
+inline void expand24Scalar(const Uint8* src, Uint32* dst, int count, bool swapRB) {
+	const int r = swapRB ? 0 : 2;
+	const int b = swapRB ? 2 : 0;
+	for (int i = 0; i < count; i++, src += 3) {
+		dst[i] = 0xff000000u | static_cast<Uint32>(src[r]) << 16
+			| static_cast<Uint32>(src[1]) << 8 | src[b];
+	}
+}
+
+inline void premultiplyScalar(Uint32* pixels, int count) {
+	for (int i = 0; i < count; i++) {
+		const Uint32 p = pixels[i];
+		const Uint32 a = p >> 24;
+		pixels[i] = (p & 0xff000000u) | surfaceMul255((p >> 16) & 0xff, a) << 16
+			| surfaceMul255((p >> 8) & 0xff, a) << 8 | surfaceMul255(p & 0xff, a);
+	}
+}
+
+inline void colorKeyScalar(Uint32* pixels, int count, Uint32 key) {
+	key &= 0x00ffffffu;
+	for (int i = 0; i < count; i++) {
+		if ((pixels[i] & 0x00ffffffu) == key) {
+			pixels[i] = 0;
+		}
+	}
+}
+
+inline void tintScalar(Uint32* pixels, int count, SDL_Color color) {
+	for (int i = 0; i < count; i++) {
+		const Uint32 p = pixels[i];
+		pixels[i] = surfaceMul255(p >> 24, color.a) << 24
+			| surfaceMul255((p >> 16) & 0xff, color.r) << 16
+			| surfaceMul255((p >> 8) & 0xff, color.g) << 8
+			| surfaceMul255(p & 0xff, color.b);
+	}
+}
+
+inline void blendScalar(const Uint32* src, Uint32* dst, int count) {
+	for (int i = 0; i < count; i++) {
+		const Uint32 s = src[i];
+		const Uint32 d = dst[i];
+		const Uint32 inv = 255 - (s >> 24);
+		Uint32 out = 0;
+		for (int shift = 0; shift < 32; shift += 8) {
+			const Uint32 c = ((s >> shift) & 0xff) + surfaceMul255((d >> shift) & 0xff, inv);
+			out |= (c > 255 ? 255 : c) << shift;
+		}
+		dst[i] = out;
+	}
+}
+
+#ifdef SURFACE_OPS_X86
+//SSE2 and AVX2 work on 16-bit copies of the channels: x * y / 255 rounded
+//is t = x * y + 128, (t + (t >> 8)) >> 8, the same as the plain version
+SURFACE_OPS_TARGET("sse2")
+inline __m128i surfaceMul255SSE2(__m128i x, __m128i y) {
+	__m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(128));
+	return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+//Copy each pixel's alpha into all four of its 16-bit channels
+SURFACE_OPS_TARGET("sse2")
+inline __m128i surfaceAlphaSSE2(__m128i x) {
+	return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)),
+		_MM_SHUFFLE(3, 3, 3, 3));
+}
+
+SURFACE_OPS_TARGET("sse2")
+inline void premultiplySSE2(Uint32* pixels, int count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi32(0xff000000u);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels + i));
+		const __m128i lo = _mm_unpacklo_epi8(p, zero);
+		const __m128i hi = _mm_unpackhi_epi8(p, zero);
+		const __m128i out = _mm_packus_epi16(surfaceMul255SSE2(lo, surfaceAlphaSSE2(lo)),
+			surfaceMul255SSE2(hi, surfaceAlphaSSE2(hi)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pixels + i),
+			_mm_or_si128(_mm_andnot_si128(alpha, out), _mm_and_si128(alpha, p)));
+	}
+	premultiplyScalar(pixels + i, count - i);
+}
+
+SURFACE_OPS_TARGET("sse2")
+inline void colorKeySSE2(Uint32* pixels, int count, Uint32 key) {
+	const __m128i mask = _mm_set1_epi32(0x00ffffff);
+	const __m128i k = _mm_set1_epi32(static_cast<int>(key & 0x00ffffffu));
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i* row = reinterpret_cast<__m128i*>(pixels + i);
+		const __m128i p = _mm_loadu_si128(row);
+		const __m128i hit = _mm_cmpeq_epi32(_mm_and_si128(p, mask), k);
+		_mm_storeu_si128(row, _mm_andnot_si128(hit, p));
+	}
+	colorKeyScalar(pixels + i, count - i, key);
+}
+
+SURFACE_OPS_TARGET("sse2")
+inline void tintSSE2(Uint32* pixels, int count, SDL_Color color) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i factor = _mm_set_epi16(color.a, color.r, color.g, color.b,
+		color.a, color.r, color.g, color.b);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i* row = reinterpret_cast<__m128i*>(pixels + i);
+		const __m128i p = _mm_loadu_si128(row);
+		_mm_storeu_si128(row, _mm_packus_epi16(
+			surfaceMul255SSE2(_mm_unpacklo_epi8(p, zero), factor),
+			surfaceMul255SSE2(_mm_unpackhi_epi8(p, zero), factor)));
+	}
+	tintScalar(pixels + i, count - i, color);
+}
+
+SURFACE_OPS_TARGET("sse2")
+inline void blendSSE2(const Uint32* src, Uint32* dst, int count) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i full = _mm_set1_epi16(255);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		__m128i* row = reinterpret_cast<__m128i*>(dst + i);
+		const __m128i d = _mm_loadu_si128(row);
+		const __m128i invLo = _mm_sub_epi16(full, surfaceAlphaSSE2(_mm_unpacklo_epi8(s, zero)));
+		const __m128i invHi = _mm_sub_epi16(full, surfaceAlphaSSE2(_mm_unpackhi_epi8(s, zero)));
+		const __m128i under = _mm_packus_epi16(
+			surfaceMul255SSE2(_mm_unpacklo_epi8(d, zero), invLo),
+			surfaceMul255SSE2(_mm_unpackhi_epi8(d, zero), invHi));
+		_mm_storeu_si128(row, _mm_adds_epu8(s, under));
+	}
+	blendScalar(src + i, dst + i, count - i);
+}
+
+SURFACE_OPS_TARGET("ssse3")
+inline void expand24SSSE3(const Uint8* src, Uint32* dst, int count, bool swapRB) {
+	const __m128i shuffle = swapRB
+		? _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+		: _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32(0xff000000u);
+	int i = 0;
+	//Each load reads 16 bytes for 4 pixels, stop while 6 are left so it
+	//doesn't read past the row
+	for (; i + 6 <= count; i += 4) {
+		const __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+			_mm_or_si128(_mm_shuffle_epi8(p, shuffle), alpha));
+	}
+	expand24Scalar(src + i * 3, dst + i, count - i, swapRB);
+}
+
+SURFACE_OPS_TARGET("avx2")
+inline __m256i surfaceMul255AVX2(__m256i x, __m256i y) {
+	__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(x, y), _mm256_set1_epi16(128));
+	return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+SURFACE_OPS_TARGET("avx2")
+inline __m256i surfaceAlphaAVX2(__m256i x) {
+	return _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(x, _MM_SHUFFLE(3, 3, 3, 3)),
+		_MM_SHUFFLE(3, 3, 3, 3));
+}
+
+SURFACE_OPS_TARGET("avx2")
+inline void expand24AVX2(const Uint8* src, Uint32* dst, int count, bool swapRB) {
+	//Shuffles stay within each 128-bit lane, so each lane gets 4 pixels
+	const __m256i shuffle = swapRB
+		? _mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+			2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1)
+		: _mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+			0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m256i alpha = _mm256_set1_epi32(0xff000000u);
+	int i = 0;
+	//The upper load reads bytes 12 to 27, stop while 10 pixels are left
+	for (; i + 10 <= count; i += 8) {
+		const Uint8* s = src + i * 3;
+		const __m256i p = _mm256_inserti128_si256(
+			_mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s))),
+			_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 12)), 1);
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i),
+			_mm256_or_si256(_mm256_shuffle_epi8(p, shuffle), alpha));
+	}
+	expand24SSSE3(src + i * 3, dst + i, count - i, swapRB);
+}
+
+SURFACE_OPS_TARGET("avx2")
+inline void premultiplyAVX2(Uint32* pixels, int count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i alpha = _mm256_set1_epi32(0xff000000u);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i* row = reinterpret_cast<__m256i*>(pixels + i);
+		const __m256i p = _mm256_loadu_si256(row);
+		const __m256i lo = _mm256_unpacklo_epi8(p, zero);
+		const __m256i hi = _mm256_unpackhi_epi8(p, zero);
+		const __m256i out = _mm256_packus_epi16(surfaceMul255AVX2(lo, surfaceAlphaAVX2(lo)),
+			surfaceMul255AVX2(hi, surfaceAlphaAVX2(hi)));
+		_mm256_storeu_si256(row, _mm256_or_si256(_mm256_andnot_si256(alpha, out),
+			_mm256_and_si256(alpha, p)));
+	}
+	premultiplySSE2(pixels + i, count - i);
+}
+
+SURFACE_OPS_TARGET("avx2")
+inline void colorKeyAVX2(Uint32* pixels, int count, Uint32 key) {
+	const __m256i mask = _mm256_set1_epi32(0x00ffffff);
+	const __m256i k = _mm256_set1_epi32(static_cast<int>(key & 0x00ffffffu));
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i* row = reinterpret_cast<__m256i*>(pixels + i);
+		const __m256i p = _mm256_loadu_si256(row);
+		const __m256i hit = _mm256_cmpeq_epi32(_mm256_and_si256(p, mask), k);
+		_mm256_storeu_si256(row, _mm256_andnot_si256(hit, p));
+	}
+	colorKeySSE2(pixels + i, count - i, key);
+}
+
+SURFACE_OPS_TARGET("avx2")
+inline void tintAVX2(Uint32* pixels, int count, SDL_Color color) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i factor = _mm256_set_epi16(color.a, color.r, color.g, color.b,
+		color.a, color.r, color.g, color.b, color.a, color.r, color.g, color.b,
+		color.a, color.r, color.g, color.b);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256i* row = reinterpret_cast<__m256i*>(pixels + i);
+		const __m256i p = _mm256_loadu_si256(row);
+		_mm256_storeu_si256(row, _mm256_packus_epi16(
+			surfaceMul255AVX2(_mm256_unpacklo_epi8(p, zero), factor),
+			surfaceMul255AVX2(_mm256_unpackhi_epi8(p, zero), factor)));
+	}
+	tintSSE2(pixels + i, count - i, color);
+}
+
+SURFACE_OPS_TARGET("avx2")
+inline void blendAVX2(const Uint32* src, Uint32* dst, int count) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i full = _mm256_set1_epi16(255);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+		__m256i* row = reinterpret_cast<__m256i*>(dst + i);
+		const __m256i d = _mm256_loadu_si256(row);
+		const __m256i invLo = _mm256_sub_epi16(full,
+			surfaceAlphaAVX2(_mm256_unpacklo_epi8(s, zero)));
+		const __m256i invHi = _mm256_sub_epi16(full,
+			surfaceAlphaAVX2(_mm256_unpackhi_epi8(s, zero)));
+		const __m256i under = _mm256_packus_epi16(
+			surfaceMul255AVX2(_mm256_unpacklo_epi8(d, zero), invLo),
+			surfaceMul255AVX2(_mm256_unpackhi_epi8(d, zero), invHi));
+		_mm256_storeu_si256(row, _mm256_adds_epu8(s, under));
+	}
+	blendSSE2(src + i, dst + i, count - i);
+}
+#endif
+
+#ifdef SURFACE_OPS_NEON
+//NEON loads the channels into separate registers, cheaper than unpacking.
+//x * y / 255 rounded is done with rounding shifts the same as the plain version
+inline uint8x8_t surfaceMul255NEON(uint8x8_t x, uint8x8_t y) {
+	const uint16x8_t t = vmull_u8(x, y);
+	return vrshrn_n_u16(vrsraq_n_u16(t, t, 8), 8);
+}
+
+inline void expand24NEON(const Uint8* src, Uint32* dst, int count, bool swapRB) {
+	int i = 0;
+	for (; i + 16 <= count; i += 16) {
+		const uint8x16x3_t p = vld3q_u8(src + i * 3);
+		uint8x16x4_t out;
+		out.val[0] = swapRB ? p.val[2] : p.val[0];
+		out.val[1] = p.val[1];
+		out.val[2] = swapRB ? p.val[0] : p.val[2];
+		out.val[3] = vdupq_n_u8(255);
+		vst4q_u8(reinterpret_cast<Uint8*>(dst + i), out);
+	}
+	expand24Scalar(src + i * 3, dst + i, count - i, swapRB);
+}
+
+inline void premultiplyNEON(Uint32* pixels, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		Uint8* row = reinterpret_cast<Uint8*>(pixels + i);
+		uint8x8x4_t p = vld4_u8(row);
+		p.val[0] = surfaceMul255NEON(p.val[0], p.val[3]);
+		p.val[1] = surfaceMul255NEON(p.val[1], p.val[3]);
+		p.val[2] = surfaceMul255NEON(p.val[2], p.val[3]);
+		vst4_u8(row, p);
+	}
+	premultiplyScalar(pixels + i, count - i);
+}
+
+inline void colorKeyNEON(Uint32* pixels, int count, Uint32 key) {
+	const uint32x4_t mask = vdupq_n_u32(0x00ffffffu);
+	const uint32x4_t k = vdupq_n_u32(key & 0x00ffffffu);
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		const uint32x4_t p = vld1q_u32(pixels + i);
+		const uint32x4_t hit = vceqq_u32(vandq_u32(p, mask), k);
+		vst1q_u32(pixels + i, vbicq_u32(p, hit));
+	}
+	colorKeyScalar(pixels + i, count - i, key);
+}
+
+inline void tintNEON(Uint32* pixels, int count, SDL_Color color) {
+	const uint8x8_t b = vdup_n_u8(color.b);
+	const uint8x8_t g = vdup_n_u8(color.g);
+	const uint8x8_t r = vdup_n_u8(color.r);
+	const uint8x8_t a = vdup_n_u8(color.a);
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		Uint8* row = reinterpret_cast<Uint8*>(pixels + i);
+		uint8x8x4_t p = vld4_u8(row);
+		p.val[0] = surfaceMul255NEON(p.val[0], b);
+		p.val[1] = surfaceMul255NEON(p.val[1], g);
+		p.val[2] = surfaceMul255NEON(p.val[2], r);
+		p.val[3] = surfaceMul255NEON(p.val[3], a);
+		vst4_u8(row, p);
+	}
+	tintScalar(pixels + i, count - i, color);
+}
+
+inline void blendNEON(const Uint32* src, Uint32* dst, int count) {
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const uint8x8x4_t s = vld4_u8(reinterpret_cast<const Uint8*>(src + i));
+		Uint8* row = reinterpret_cast<Uint8*>(dst + i);
+		uint8x8x4_t d = vld4_u8(row);
+		const uint8x8_t inv = vmvn_u8(s.val[3]);
+		for (int c = 0; c < 4; c++) {
+			d.val[c] = vqadd_u8(s.val[c], surfaceMul255NEON(d.val[c], inv));
+		}
+		vst4_u8(row, d);
+	}
+	blendScalar(src + i, dst + i, count - i);
+}
+#endif
+
+/**
+ * Get the fastest kernels the CPU supports, picked on the first call.
+ *
+ * @return The kernels.
+ */
+inline const SurfaceKernels& surfaceKernels() {
+	static const SurfaceKernels scalar = {"scalar", expand24Scalar, premultiplyScalar,
+		colorKeyScalar, tintScalar, blendScalar};
+#ifdef SURFACE_OPS_X86
+	static const SurfaceKernels sse2 = {"SSE2", expand24Scalar, premultiplySSE2,
+		colorKeySSE2, tintSSE2, blendSSE2};
+	static const SurfaceKernels ssse3 = {"SSSE3", expand24SSSE3, premultiplySSE2,
+		colorKeySSE2, tintSSE2, blendSSE2};
+	static const SurfaceKernels avx2 = {"AVX2", expand24AVX2, premultiplyAVX2,
+		colorKeyAVX2, tintAVX2, blendAVX2};
+	static const SurfaceKernels& best = SDL_HasAVX2() ? avx2
+		: SDL_HasSSSE3() ? ssse3 : SDL_HasSSE2() ? sse2 : scalar;
+#elif defined(SURFACE_OPS_NEON)
+	static const SurfaceKernels neon = {"NEON", expand24NEON, premultiplyNEON,
+		colorKeyNEON, tintNEON, blendNEON};
+	static const SurfaceKernels& best = SDL_HasNEON() ? neon : scalar;
+#else
+	static const SurfaceKernels& best = scalar;
+#endif
+	return best;
+}
+
+//Run a kernel over every row of an ARGB8888 surface
+template<typename RowOp>
+bool forEachSurfaceRow(SDL_Surface* surf, RowOp op) {
+	if (surf == nullptr || surf->format->format != SDL_PIXELFORMAT_ARGB8888) {
+		SDL_SetError("surface must be ARGB8888");
+		return false;
+	}
+	if (SDL_LockSurface(surf) != 0) {
+		return false;
+	}
+	Uint8* pixels = static_cast<Uint8*>(surf->pixels);
+	for (int y = 0; y < surf->h; y++) {
+		op(reinterpret_cast<Uint32*>(pixels + y * surf->pitch), y);
+	}
+	SDL_UnlockSurface(surf);
+	return true;
+}
+
+/**
+ * Convert a surface to ARGB8888, ready for SDL_CreateTextureFromSurface
+ * to upload without converting it again. 24-bit images are expanded with
+ * the SIMD kernels, other formats go through SDL_ConvertSurfaceFormat. If
+ * the surface has a color key the keyed pixels are made transparent, so
+ * blending the texture gives the same result as blitting with the key.
+ *
+ * @param  src The surface to convert, it isn't changed.
+ * @return     The converted surface, or nullptr if something went wrong.
+ */
+inline SDL_Surface* convertSurface(SDL_Surface* src) {
+	if (src == nullptr) {
+		return nullptr;
+	}
+	const Uint32 format = src->format->format;
+	SDL_Surface* dst = nullptr;
+	if (format == SDL_PIXELFORMAT_BGR24 || format == SDL_PIXELFORMAT_RGB24) {
+		dst = SDL_CreateRGBSurfaceWithFormat(0, src->w, src->h, 32, SDL_PIXELFORMAT_ARGB8888);
+		if (dst == nullptr) {
+			return nullptr;
+		}
+		if (SDL_LockSurface(src) != 0) {
+			SDL_FreeSurface(dst);
+			return nullptr;
+		}
+		const Uint8* in = static_cast<const Uint8*>(src->pixels);
+		const bool swapRB = format == SDL_PIXELFORMAT_RGB24;
+		const SurfaceKernels& kernels = surfaceKernels();
+		forEachSurfaceRow(dst, [&](Uint32* row, int y) {
+			kernels.expand24(in + y * src->pitch, row, src->w, swapRB);
+		});
+		SDL_UnlockSurface(src);
+	} else {
+		dst = SDL_ConvertSurfaceFormat(src, SDL_PIXELFORMAT_ARGB8888, 0);
+		if (dst == nullptr) {
+			return nullptr;
+		}
+	}
+
+	Uint32 key = 0;
+	if (SDL_GetColorKey(src, &key) == 0) {
+		Uint8 r, g, b, a;
+		SDL_GetRGBA(key, src->format, &r, &g, &b, &a);
+		const Uint32 argb = static_cast<Uint32>(r) << 16 | static_cast<Uint32>(g) << 8 | b;
+		const SurfaceKernels& kernels = surfaceKernels();
+		forEachSurfaceRow(dst, [&](Uint32* row, int) {
+			kernels.colorKey(row, dst->w, argb);
+		});
+		//The key is in the alpha now, so don't key it again when blitting
+		SDL_SetColorKey(dst, SDL_FALSE, 0);
+		SDL_SetSurfaceBlendMode(dst, SDL_BLENDMODE_BLEND);
+	}
+	return dst;
+}
+
+/**
+ * Multiply an ARGB8888 surface's colors by its alpha. Premultiplied images
+ * filter without dark fringes, but have to be drawn with a blend mode that
+ * expects them.
+ *
+ * @param  surf The surface to change.
+ * @return      True if it was changed, false if it isn't ARGB8888.
+ */
+inline bool premultiplySurface(SDL_Surface* surf) {
+	const SurfaceKernels& kernels = surfaceKernels();
+	return forEachSurfaceRow(surf, [&](Uint32* row, int) {
+		kernels.premultiply(row, surf->w);
+	});
+}
+
+/**
+ * Tint an ARGB8888 surface, like drawing it with a color and alpha mod but
+ * done once up front.
+ *
+ * @param  surf  The surface to change.
+ * @param  color The color to multiply each pixel by.
+ * @return       True if it was changed, false if it isn't ARGB8888.
+ */
+inline bool tintSurface(SDL_Surface* surf, SDL_Color color) {
+	const SurfaceKernels& kernels = surfaceKernels();
+	return forEachSurfaceRow(surf, [&](Uint32* row, int) {
+		kernels.tint(row, surf->w, color);
+	});
+}
+
+/**
+ * Blend a premultiplied ARGB8888 surface over another, both the same size.
+ *
+ * @param  src The premultiplied surface to draw.
+ * @param  dst The ARGB8888 surface to draw onto.
+ * @return     True if it was drawn, false if the surfaces don't match.
+ */
+inline bool blendSurface(SDL_Surface* src, SDL_Surface* dst) {
+	if (src == nullptr || src->format->format != SDL_PIXELFORMAT_ARGB8888
+		|| dst == nullptr || src->w != dst->w || src->h != dst->h) {
+		SDL_SetError("surfaces must be ARGB8888 and the same size");
+		return false;
+	}
+	if (SDL_LockSurface(src) != 0) {
+		return false;
+	}
+	const Uint8* in = static_cast<const Uint8*>(src->pixels);
+	const SurfaceKernels& kernels = surfaceKernels();
+	const bool ok = forEachSurfaceRow(dst, [&](Uint32* row, int y) {
+		kernels.blend(reinterpret_cast<const Uint32*>(in + y * src->pitch), row, dst->w);
+	});
+	SDL_UnlockSurface(src);
+	return ok;
+}
+
+#endif
@@ -0,0 +1,353 @@
+#ifndef TEXT_ATLAS_H
+#define TEXT_ATLAS_H
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "cleanup.h"
+#include "res_pack.h"
+#include "sprite_batch.h"
+#include "texture_budget.h"
+
+//Kerning lookups by glyph pair were added in SDL_ttf 2.0.14
+#ifdef SDL_TTF_VERSION_ATLEAST
+#if SDL_TTF_VERSION_ATLEAST(2, 0, 14)
+#define TEXT_ATLAS_KERNING
+#endif
+#endif
+
+template<>
+inline void cleanup<TTF_Font>(TTF_Font* font) {
+	if (!font) {
+		return;
+	}
+	TTF_CloseFont(font);
+}
+
+typedef Unique<TTF_Font> UniqueFont;
+
+/**
+ * Keeps fonts open between uses, keyed by (file, size), so drawing text
+ * doesn't open and close the font file every time.
+ * Fonts must be cleared before TTF_Quit is called.
+ */
+class FontCache {
+public:
+	FontCache() {}
+	~FontCache() {
+		clear();
+	}
+
+	/**
+	 * Get a font at some point size, opening it on first use.
+	 *
+	 * @param  file The font file to open.
+	 * @param  size The point size to open the font at.
+	 * @return      The cached font, or nullptr if something went wrong.
+	 */
+	TTF_Font* get(const std::string& file, int size) {
+		const Key key(file, size);
+		std::map<Key, UniqueFont>::iterator it = fonts.find(key);
+		if (it != fonts.end()) {
+			return it->second.get();
+		}
+
+		UniqueFont font(TTF_OpenFontRW(openResource(file), 1, size));
+		if (!font) {
+			std::cout << "TTF_OpenFont error: " << SDL_GetError() << std::endl;
+			return nullptr;
+		}
+		TTF_Font* opened = font.get();
+		fonts[key] = std::move(font);
+		return opened;
+	}
+
+	/**
+	 * Close every cached font.
+	 */
+	void clear() {
+		fonts.clear();
+	}
+
+private:
+	typedef std::pair<std::string, int> Key;
+
+	FontCache(const FontCache&);
+	FontCache& operator=(const FontCache&);
+
+	std::map<Key, UniqueFont> fonts;
+};
+
+/**
+ * A texture holding every printable ASCII glyph of one font, packed once.
+ * Strings are then drawn as a batch of glyph quads copied out of the atlas,
+ * so changing text every frame allocates no surfaces or textures.
+ * Once built the atlas doesn't touch the font again, so laying out text
+ * with layout() is safe from any thread.
+ */
+class GlyphAtlas {
+public:
+	GlyphAtlas() : font(nullptr), atlas(nullptr), height(0), lineSkip(0) {}
+	~GlyphAtlas() {
+		clear();
+	}
+
+	/**
+	 * Rasterize the font's glyphs and pack them into a single texture.
+	 *
+	 * @param  fnt The font to build the atlas from, it must outlive the atlas.
+	 * @param  ren The renderer to create the atlas texture on.
+	 * @return     True if the atlas was built, false if something went wrong.
+	 */
+	bool build(TTF_Font* fnt, SDL_Renderer* ren) {
+		clear();
+		font = fnt;
+		height = TTF_FontHeight(font);
+		lineSkip = TTF_FontLineSkip(font);
+
+		//Render the glyphs white so they can be tinted by the texture color mod
+		const SDL_Color white = {255, 255, 255, 255};
+		SDL_Surface* surfs[GLYPH_COUNT];
+		int maxW = 0;
+		for (int i = 0; i < GLYPH_COUNT; i++) {
+			const char str[2] = {static_cast<char>(FIRST_GLYPH + i), '\0'};
+			surfs[i] = TTF_RenderText_Blended(font, str, white);
+			if (surfs[i] != nullptr && surfs[i]->w > maxW) {
+				maxW = surfs[i]->w;
+			}
+			int advance = 0;
+			TTF_GlyphMetrics(font, FIRST_GLYPH + i, NULL, NULL, NULL, NULL, &advance);
+			glyphs[i].advance = advance;
+		}
+#ifdef TEXT_ATLAS_KERNING
+		//Look every pair up now so layout never calls into the font
+		kerns.resize(GLYPH_COUNT * GLYPH_COUNT);
+		for (int i = 0; i < GLYPH_COUNT; i++) {
+			for (int j = 0; j < GLYPH_COUNT; j++) {
+				kerns[i * GLYPH_COUNT + j] = static_cast<Sint16>(
+					TTF_GetFontKerningSizeGlyphs(font, FIRST_GLYPH + i, FIRST_GLYPH + j));
+			}
+		}
+#endif
+
+		//Pack the glyphs into rows, leaving a pixel between them so
+		//scaled text doesn't bleed in its neighbours
+		const int atlasW = maxW + PADDING > ATLAS_WIDTH ? maxW + PADDING : ATLAS_WIDTH;
+		int x = 0;
+		int y = 0;
+		for (int i = 0; i < GLYPH_COUNT; i++) {
+			const int w = surfs[i] != nullptr ? surfs[i]->w : 0;
+			if (x + w > atlasW) {
+				x = 0;
+				y += height + PADDING;
+			}
+			glyphs[i].clip.x = x;
+			glyphs[i].clip.y = y;
+			glyphs[i].clip.w = w;
+			glyphs[i].clip.h = surfs[i] != nullptr ? surfs[i]->h : 0;
+			x += w + PADDING;
+		}
+
+		SDL_Surface* packed = SDL_CreateRGBSurfaceWithFormat(0, atlasW, y + height, 32,
+			SDL_PIXELFORMAT_ARGB8888);
+		if (packed != nullptr) {
+			SDL_FillRect(packed, NULL, 0);
+			for (int i = 0; i < GLYPH_COUNT; i++) {
+				if (surfs[i] != nullptr) {
+					//Copy the glyph's alpha as is instead of blending it onto the atlas
+					SDL_SetSurfaceBlendMode(surfs[i], SDL_BLENDMODE_NONE);
+					SDL_BlitSurface(surfs[i], NULL, packed, &glyphs[i].clip);
+				}
+			}
+			atlas = SDL_CreateTextureFromSurface(ren, packed);
+			cleanup(packed);
+		}
+		for (int i = 0; i < GLYPH_COUNT; i++) {
+			cleanup(surfs[i]);
+		}
+
+		if (atlas == nullptr) {
+			std::cout << "GlyphAtlas error: " << SDL_GetError() << std::endl;
+			return false;
+		}
+		SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+		trackTexture(atlas);
+		return true;
+	}
+
+	/**
+	 * Destroy the atlas texture. Must be called before the renderer is destroyed.
+	 */
+	void clear() {
+		cleanup(atlas);
+		atlas = nullptr;
+		font = nullptr;
+#ifdef TEXT_ATLAS_KERNING
+		kerns.clear();
+#endif
+	}
+
+	/**
+	 * Measure the size a string will take up when drawn, without drawing it.
+	 *
+	 * @param text The text to measure, may contain newlines.
+	 * @param w    Set to the width of the widest line.
+	 * @param h    Set to the height of all the lines.
+	 */
+	void measure(const char* text, int* w, int* h) const {
+		int lineW = 0;
+		int maxW = 0;
+		int lines = 1;
+		Uint16 prev = 0;
+		for (const char* c = text; *c != '\0'; c++) {
+			if (*c == '\n') {
+				lineW = 0;
+				prev = 0;
+				lines++;
+				continue;
+			}
+			const Uint16 ch = glyphFor(*c);
+			lineW += kerning(prev, ch) + glyphs[ch - FIRST_GLYPH].advance;
+			prev = ch;
+			if (lineW > maxW) {
+				maxW = lineW;
+			}
+		}
+		if (w != nullptr) {
+			*w = maxW;
+		}
+		if (h != nullptr) {
+			*h = height + (lines - 1) * lineSkip;
+		}
+	}
+	void measure(const std::string& text, int* w, int* h) const {
+		measure(text.c_str(), w, h);
+	}
+
+	/**
+	 * Draw a string with its top-left corner at (x,y).
+	 *
+	 * @param ren   The renderer to draw to.
+	 * @param text  The text to draw, may contain newlines.
+	 * @param x     The x coordinate to draw to.
+	 * @param y     The y coordinate to draw to.
+	 * @param color The text color.
+	 */
+	void draw(SDL_Renderer* ren, const char* text, int x, int y, SDL_Color color) {
+		if (atlas == nullptr) {
+			return;
+		}
+		//Lay out the whole string first then submit the quads as one batch
+		quads.clear();
+		SpriteBatch& batch = quads;
+		layout(text, x, y, [&batch](const SDL_Rect& dst, const SDL_Rect& clip) {
+			batch.add(dst, &clip);
+		});
+
+		SDL_SetTextureColorMod(atlas, color.r, color.g, color.b);
+		SDL_SetTextureAlphaMod(atlas, color.a);
+		quads.draw(ren, atlas);
+	}
+	void draw(SDL_Renderer* ren, const std::string& text, int x, int y, SDL_Color color) {
+		draw(ren, text.c_str(), x, y, color);
+	}
+
+	/**
+	 * Lay out a string with its top-left corner at (x,y), without drawing it.
+	 *
+	 * @param text The text to lay out, may contain newlines.
+	 * @param x    The x coordinate to draw to.
+	 * @param y    The y coordinate to draw to.
+	 * @param emit Called as emit(const SDL_Rect& dst, const SDL_Rect& clip)
+	 *                for each visible glyph, clip being its rect in texture().
+	 */
+	template<typename Emit>
+	void layout(const char* text, int x, int y, Emit emit) const {
+		int penX = x;
+		int penY = y;
+		Uint16 prev = 0;
+		for (const char* c = text; *c != '\0'; c++) {
+			if (*c == '\n') {
+				penX = x;
+				penY += lineSkip;
+				prev = 0;
+				continue;
+			}
+			const Uint16 ch = glyphFor(*c);
+			const Glyph& glyph = glyphs[ch - FIRST_GLYPH];
+			penX += kerning(prev, ch);
+			prev = ch;
+			if (glyph.clip.w > 0) {
+				const SDL_Rect dst = {penX, penY, glyph.clip.w, glyph.clip.h};
+				emit(dst, glyph.clip);
+			}
+			penX += glyph.advance;
+		}
+	}
+
+	/**
+	 * @return The distance between the tops of two lines of text.
+	 */
+	int lineHeight() const {
+		return lineSkip;
+	}
+
+	/**
+	 * @return The packed atlas texture, or nullptr if it hasn't been built.
+	 */
+	SDL_Texture* texture() const {
+		return atlas;
+	}
+
+private:
+	//Printable ASCII, anything else is drawn as FALLBACK_GLYPH
+	static const int FIRST_GLYPH = 32;
+	static const int LAST_GLYPH = 126;
+	static const int GLYPH_COUNT = LAST_GLYPH - FIRST_GLYPH + 1;
+	static const int FALLBACK_GLYPH = '?';
+	static const int ATLAS_WIDTH = 512;
+	static const int PADDING = 1;
+
+	struct Glyph {
+		SDL_Rect clip;
+		int advance;
+	};
+
+	GlyphAtlas(const GlyphAtlas&);
+	GlyphAtlas& operator=(const GlyphAtlas&);
+
+	static Uint16 glyphFor(char c) {
+		const int ch = static_cast<unsigned char>(c);
+		return static_cast<Uint16>(ch >= FIRST_GLYPH && ch <= LAST_GLYPH ? ch : FALLBACK_GLYPH);
+	}
+
+	int kerning(Uint16 prev, Uint16 ch) const {
+#ifdef TEXT_ATLAS_KERNING
+		return prev != 0 && !kerns.empty()
+			? kerns[(prev - FIRST_GLYPH) * GLYPH_COUNT + ch - FIRST_GLYPH] : 0;
+#else
+		(void)prev;
+		(void)ch;
+		return 0;
+#endif
+	}
+
+	TTF_Font* font;
+	SDL_Texture* atlas;
+	int height;
+	int lineSkip;
+	Glyph glyphs[GLYPH_COUNT];
+#ifdef TEXT_ATLAS_KERNING
+	//The kerning between each pair of glyphs, indexed [prev][ch]
+	std::vector<Sint16> kerns;
+#endif
+	//Kept between draws so laying out text doesn't allocate once it's grown
+	SpriteBatch quads;
+};
+
+#endif
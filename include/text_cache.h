@@ -0,0 +1,218 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <cstdint>
+#include <iostream>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <SDL.h>
+#include <SDL_ttf.h>
+
+#include "cleanup.h"
+#include "texture_budget.h"
+
+/**
+ * Keeps rendered strings as textures, keyed by (text, font, color), so labels
+ * that rarely change are rasterized once and then only copied. Fonts are
+ * opened at one point size each, so the font covers the size as well.
+ * The cache has a budget in bytes of texture memory, counted as 4 bytes per
+ * pixel. Once it's over budget the least recently drawn strings are freed,
+ * so a UI with thousands of labels keeps the ones on screen and loses the
+ * ones it hasn't shown in a while.
+ * Text that changes every frame, such as counters, is better drawn out of a
+ * GlyphAtlas, since every new string here is a new texture.
+ * The cache must be cleared before the renderer is destroyed.
+ */
+class TextCache {
+public:
+	//16MB, about sixty 512x128 labels
+	static const size_t DEFAULT_BUDGET = 16 * 1024 * 1024;
+
+	/**
+	 * @param ren    The renderer to create the textures on.
+	 * @param budget The most bytes of texture memory to keep.
+	 */
+	TextCache(SDL_Renderer* ren, size_t budget = DEFAULT_BUDGET)
+		: renderer(ren), budgetBytes(budget), usedBytes(0), hitCount(0), missCount(0) {}
+	~TextCache() {
+		clear();
+	}
+
+	/**
+	 * Get a string's texture, rendering it on first use.
+	 *
+	 * @param  font  The font to render with.
+	 * @param  text  The text to render, as UTF-8.
+	 * @param  color The text color.
+	 * @param  w     Set to the texture's width, if not nullptr.
+	 * @param  h     Set to the texture's height, if not nullptr.
+	 * @return       The cached texture, or nullptr if the text is empty or
+	 *                  something went wrong. It stays valid until the cache
+	 *                  next renders a string or is cleared.
+	 */
+	SDL_Texture* get(TTF_Font* font, const std::string& text, SDL_Color color,
+			int* w = nullptr, int* h = nullptr) {
+		if (font == nullptr || text.empty()) {
+			return nullptr;
+		}
+		const Uint64 key = hash(font, text, color);
+		std::unordered_map<Uint64, std::list<Entry>::iterator>::iterator found = index.find(key);
+		if (found != index.end()) {
+			Entry& entry = *found->second;
+			if (entry.font == font && entry.text == text && sameColor(entry.color, color)) {
+				hitCount++;
+				//Move it to the front of the LRU list
+				entries.splice(entries.begin(), entries, found->second);
+				return result(entry, w, h);
+			}
+			//A different string with the same hash, replace it
+			release(found->second);
+		}
+		missCount++;
+
+		UniqueTexture texture;
+		SDL_Surface* surf = TTF_RenderUTF8_Blended(font, text.c_str(), color);
+		if (surf != nullptr) {
+			texture.reset(SDL_CreateTextureFromSurface(renderer, surf));
+			cleanup(surf);
+		}
+		if (!texture) {
+			std::cout << "TextCache error: " << SDL_GetError() << std::endl;
+			return nullptr;
+		}
+		//The cache keeps to its own budget, so the strings are pinned
+		trackTexture(texture.get());
+
+		Entry entry;
+		entry.key = key;
+		entry.font = font;
+		entry.text = text;
+		entry.color = color;
+		SDL_QueryTexture(texture.get(), NULL, NULL, &entry.w, &entry.h);
+		entry.texture = std::move(texture);
+		entries.push_front(std::move(entry));
+		index[key] = entries.begin();
+		usedBytes += bytes(entries.front());
+		trim();
+		return result(entries.front(), w, h);
+	}
+
+	/**
+	 * Change the budget, freeing strings if the cache is over it.
+	 *
+	 * @param budget The most bytes of texture memory to keep.
+	 */
+	void setBudget(size_t budget) {
+		budgetBytes = budget;
+		trim();
+	}
+
+	/**
+	 * Free every cached texture.
+	 */
+	void clear() {
+		index.clear();
+		entries.clear();
+		usedBytes = 0;
+	}
+
+	/**
+	 * @return The bytes of texture memory the cached strings use.
+	 */
+	size_t bytes() const {
+		return usedBytes;
+	}
+
+	/**
+	 * @return The number of cached strings.
+	 */
+	int size() const {
+		return static_cast<int>(index.size());
+	}
+
+	/**
+	 * @return The number of lookups that found their string cached.
+	 */
+	Uint64 hits() const {
+		return hitCount;
+	}
+
+	/**
+	 * @return The number of lookups that had to render their string.
+	 */
+	Uint64 misses() const {
+		return missCount;
+	}
+
+private:
+	struct Entry {
+		Uint64 key;
+		TTF_Font* font;
+		std::string text;
+		SDL_Color color;
+		int w;
+		int h;
+		UniqueTexture texture;
+	};
+
+	TextCache(const TextCache&);
+	TextCache& operator=(const TextCache&);
+
+	static bool sameColor(const SDL_Color& a, const SDL_Color& b) {
+		return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+	}
+
+	//FNV-1a over the text, then the font and color mixed in
+	static Uint64 hash(TTF_Font* font, const std::string& text, const SDL_Color& color) {
+		Uint64 h = 14695981039346656037ull;
+		for (std::string::size_type i = 0; i < text.size(); i++) {
+			h = (h ^ static_cast<unsigned char>(text[i])) * 1099511628211ull;
+		}
+		const Uint64 f = static_cast<Uint64>(reinterpret_cast<uintptr_t>(font));
+		const Uint64 c = static_cast<Uint64>(color.r) | color.g << 8 | color.b << 16
+			| static_cast<Uint64>(color.a) << 24;
+		h ^= (f ^ (c << 40) ^ (c >> 24)) * 0x9e3779b97f4a7c15ull;
+		return h;
+	}
+
+	static size_t bytes(const Entry& entry) {
+		return static_cast<size_t>(entry.w) * entry.h * 4;
+	}
+
+	static SDL_Texture* result(const Entry& entry, int* w, int* h) {
+		if (w != nullptr) {
+			*w = entry.w;
+		}
+		if (h != nullptr) {
+			*h = entry.h;
+		}
+		return entry.texture.get();
+	}
+
+	void release(std::list<Entry>::iterator it) {
+		usedBytes -= bytes(*it);
+		index.erase(it->key);
+		entries.erase(it);
+	}
+
+	//Free the least recently used strings until the cache is within budget,
+	//always keeping the newest so what was just asked for can be drawn
+	void trim() {
+		while (usedBytes > budgetBytes && entries.size() > 1) {
+			release(--entries.end());
+		}
+	}
+
+	SDL_Renderer* renderer;
+	size_t budgetBytes;
+	size_t usedBytes;
+	Uint64 hitCount;
+	Uint64 missCount;
+	//Most recently used first
+	std::list<Entry> entries;
+	std::unordered_map<Uint64, std::list<Entry>::iterator> index;
+};
+
+#endif
@@ -0,0 +1,291 @@
+#ifndef TEXTURE_BUDGET_H
+#define TEXTURE_BUDGET_H
+
+#include <cstdlib>
+#include <list>
+#include <unordered_map>
+#include <SDL.h>
+
+/**
+ * Estimate how much video memory a texture takes, from its format and size.
+ * Drivers pad and mip as they like so this is a lower bound, but it's the
+ * same for every texture of a size and format, which is what a budget needs.
+ *
+ * @param  tex The texture.
+ * @return     Its size in bytes, 0 if tex is null.
+ */
+inline size_t textureBytes(SDL_Texture* tex) {
+	Uint32 format;
+	int w, h;
+	if (tex == nullptr || SDL_QueryTexture(tex, &format, NULL, &w, &h) != 0) {
+		return 0;
+	}
+	const size_t pixels = static_cast<size_t>(w) * h;
+	if (SDL_ISPIXELFORMAT_FOURCC(format)) {
+		//The YUV formats SDL knows are all a full size plane and two quarter
+		//size ones, or a half size pair
+		return pixels + pixels / 2;
+	}
+	return pixels * SDL_BYTESPERPIXEL(format);
+}
+
+/**
+ * Tallies the video memory textures use and keeps it under a budget, so a
+ * program stays within what a small GPU has rather than having the driver
+ * page textures in and out or fail to make new ones. Every texture freed
+ * with cleanup is forgotten, so only creation has to be tracked.
+ * Textures are either pinned, which are counted but never evicted, or
+ * evictable, which come with a function that frees them. When tracking a
+ * texture takes the total over the budget, the evictable textures used
+ * least recently are freed until it's under again. Textures used since the
+ * last presentFrame() are never evicted, since draws of them may still be
+ * waiting in a SpriteBatch, DrawQueue or CommandBuffer, so a frame that
+ * uses more than the budget overruns it until it's presented. If only
+ * pinned or in use textures are left the budget is overrun, the stats show
+ * it.
+ * The TextureCache makes its textures evictable and loads them again the
+ * next time their handle is used, targets, streaming textures and glyph
+ * atlases the helpers make are pinned.
+ * Only use it from the thread that renders.
+ */
+class TextureBudget {
+public:
+	/**
+	 * Frees an evicted texture for whatever owns it, it must be freed with
+	 * cleanup so it's forgotten.
+	 *
+	 * @param owner The owner that was passed to track.
+	 * @param tex   The texture to free.
+	 */
+	typedef void (*Evictor)(void* owner, SDL_Texture* tex);
+
+	struct Stats {
+		//Every tracked texture, and the pinned ones among them
+		size_t bytes;
+		size_t pinnedBytes;
+		size_t peakBytes;
+		//0 if there's no budget
+		size_t budget;
+		int textures;
+		int evictions;
+	};
+
+	/**
+	 * @param bytes The budget, 0 for none.
+	 */
+	explicit TextureBudget(size_t bytes) : budget(bytes), used(0), pinnedUsed(0), peak(0),
+		evictions(0), frame(0)
+	{}
+
+	/**
+	 * Change the budget, evicting textures if they're over it.
+	 *
+	 * @param bytes The budget, 0 for none.
+	 */
+	void setBudget(size_t bytes) {
+		budget = bytes;
+		enforce();
+	}
+
+	/**
+	 * Start counting a texture, evicting others if it takes the total over
+	 * the budget. Tracking a texture twice updates its owner.
+	 *
+	 * @param tex   The texture.
+	 * @param evict The function to free it with if it's evicted, or nullptr
+	 *                 for a pinned texture.
+	 * @param owner Passed to evict.
+	 */
+	void track(SDL_Texture* tex, Evictor evict = nullptr, void* owner = nullptr) {
+		if (tex == nullptr) {
+			return;
+		}
+		forget(tex);
+		Entry entry;
+		entry.tex = tex;
+		entry.bytes = textureBytes(tex);
+		entry.evict = evict;
+		entry.owner = owner;
+		entry.pinned = evict == nullptr;
+		entry.usedFrame = frame;
+		lru.push_front(entry);
+		index[tex] = lru.begin();
+		used += entry.bytes;
+		if (entry.pinned) {
+			pinnedUsed += entry.bytes;
+		}
+		enforce();
+		if (used > peak) {
+			peak = used;
+		}
+	}
+
+	/**
+	 * Stop counting a texture, cleanup calls this so it needn't be called
+	 * by hand. Textures that aren't tracked are ignored.
+	 *
+	 * @param tex The texture.
+	 */
+	void forget(SDL_Texture* tex) {
+		std::unordered_map<SDL_Texture*, std::list<Entry>::iterator>::iterator found = index.find(tex);
+		if (found == index.end()) {
+			return;
+		}
+		const Entry& entry = *found->second;
+		used -= entry.bytes;
+		if (entry.pinned) {
+			pinnedUsed -= entry.bytes;
+		}
+		lru.erase(found->second);
+		index.erase(found);
+	}
+
+	/**
+	 * Mark a texture as just used, so it's the last to be evicted and isn't
+	 * evicted at all until the frame's presented.
+	 *
+	 * @param tex The texture.
+	 */
+	void touch(SDL_Texture* tex) {
+		std::unordered_map<SDL_Texture*, std::list<Entry>::iterator>::iterator found = index.find(tex);
+		if (found == index.end()) {
+			return;
+		}
+		found->second->usedFrame = frame;
+		if (found->second != lru.begin()) {
+			lru.splice(lru.begin(), lru, found->second);
+		}
+	}
+
+	/**
+	 * Finish a frame once it's been presented, so the textures it used can
+	 * be evicted again, evicting any that are over the budget. presentFrame
+	 * calls this.
+	 */
+	void endFrame() {
+		frame++;
+		enforce();
+	}
+
+	/**
+	 * Pin an evictable texture so it's kept, such as while something holds
+	 * on to the SDL_Texture itself, or let it be evicted again. Textures
+	 * tracked without an evictor stay pinned.
+	 *
+	 * @param tex    The texture.
+	 * @param pinned True to keep it.
+	 */
+	void pin(SDL_Texture* tex, bool pinned) {
+		std::unordered_map<SDL_Texture*, std::list<Entry>::iterator>::iterator found = index.find(tex);
+		if (found == index.end()) {
+			return;
+		}
+		Entry& entry = *found->second;
+		if (entry.evict == nullptr || entry.pinned == pinned) {
+			return;
+		}
+		entry.pinned = pinned;
+		if (pinned) {
+			pinnedUsed += entry.bytes;
+		} else {
+			pinnedUsed -= entry.bytes;
+			enforce();
+		}
+	}
+
+	/**
+	 * @return The memory in use and how much has been evicted.
+	 */
+	Stats stats() const {
+		Stats s;
+		s.bytes = used;
+		s.pinnedBytes = pinnedUsed;
+		s.peakBytes = peak;
+		s.budget = budget;
+		s.textures = static_cast<int>(index.size());
+		s.evictions = evictions;
+		return s;
+	}
+
+private:
+	TextureBudget(const TextureBudget&);
+	TextureBudget& operator=(const TextureBudget&);
+
+	struct Entry {
+		SDL_Texture* tex;
+		size_t bytes;
+		Evictor evict;
+		void* owner;
+		bool pinned;
+		//The last frame it was tracked or touched in
+		Uint32 usedFrame;
+	};
+
+	//Evict from the back of the list until we're under budget. The list is
+	//in the order textures were used, so once one used this frame is reached
+	//so have all the rest
+	void enforce() {
+		if (budget == 0) {
+			return;
+		}
+		while (used > budget && used > pinnedUsed) {
+			std::list<Entry>::reverse_iterator it = lru.rbegin();
+			while (it != lru.rend() && it->pinned) {
+				++it;
+			}
+			if (it == lru.rend() || it->usedFrame == frame) {
+				return;
+			}
+			//The evictor frees the texture, which forgets it and erases the
+			//entry, so take what we need first
+			SDL_Texture* tex = it->tex;
+			Evictor evict = it->evict;
+			void* owner = it->owner;
+			evictions++;
+			evict(owner, tex);
+			forget(tex);
+		}
+	}
+
+	size_t budget;
+	size_t used;
+	size_t pinnedUsed;
+	size_t peak;
+	int evictions;
+	Uint32 frame;
+	//Most recently used at the front
+	std::list<Entry> lru;
+	std::unordered_map<SDL_Texture*, std::list<Entry>::iterator> index;
+};
+
+/**
+ * Read a budget from the TEXTURE_BUDGET_MB environment variable, such as 256.
+ *
+ * @return The budget in bytes, 0 for none if it's unset or not positive.
+ */
+inline size_t textureBudgetFromEnv() {
+	const char* env = SDL_getenv("TEXTURE_BUDGET_MB");
+	const double mb = env != nullptr ? std::atof(env) : 0;
+	return mb > 0 ? static_cast<size_t>(mb * 1024 * 1024) : 0;
+}
+
+/**
+ * The budget cleanup and the texture helpers report to, set from
+ * textureBudgetFromEnv. Without a budget textures are only counted.
+ */
+inline TextureBudget& textureBudget() {
+	static TextureBudget budget(textureBudgetFromEnv());
+	return budget;
+}
+
+/**
+ * Count a texture that's kept for as long as its owner needs it, such as a
+ * render target, against the budget.
+ *
+ * @param tex The texture, may be null.
+ */
+inline void trackTexture(SDL_Texture* tex) {
+	textureBudget().track(tex);
+}
+
+#endif
@@ -0,0 +1,414 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+#include "cleanup.h"
+#include "texture_budget.h"
+
+/**
+ * Function used by the cache to load a texture from disk, this is the
+ * signature of each lesson's loadTexture.
+ */
+typedef SDL_Texture* (*TextureLoader)(const std::string& file, SDL_Renderer* ren);
+
+/**
+ * A texture shared between every handle to it, freed with the last handle.
+ * The texture counts against the textureBudget and can be evicted while
+ * handles to it are alive, it's then loaded again the next time a handle's
+ * used, with the blend mode and mods it had.
+ */
+struct TextureEntry {
+	TextureEntry(const std::string& p, SDL_Texture* tex, SDL_Renderer* ren, TextureLoader loader)
+		: path(p), texture(tex), renderer(ren), load(loader), pinned(false), evicted(false)
+	{
+		saveMods();
+		textureBudget().track(texture, evictEntry, this);
+	}
+	~TextureEntry() {
+		cleanup(texture);
+	}
+
+	/**
+	 * Swap in a new texture, freeing the old one and giving the new one its
+	 * blend mode and mods.
+	 *
+	 * @param tex The new texture, not null.
+	 */
+	void replace(SDL_Texture* tex) {
+		if (texture != nullptr) {
+			saveMods();
+		}
+		SDL_SetTextureBlendMode(tex, blend);
+		SDL_SetTextureColorMod(tex, r, g, b);
+		SDL_SetTextureAlphaMod(tex, a);
+		cleanup(texture);
+		texture = tex;
+		evicted = false;
+		textureBudget().track(texture, evictEntry, this);
+		textureBudget().pin(texture, pinned);
+	}
+
+	/**
+	 * Load an evicted texture again. If it can't be loaded texture stays
+	 * null and it isn't tried again.
+	 */
+	void restore() {
+		evicted = false;
+		SDL_Texture* tex = load(path, renderer);
+		if (tex != nullptr) {
+			replace(tex);
+		}
+	}
+
+	/**
+	 * @param keep True to never evict the texture, such as while something
+	 *                holds on to the SDL_Texture itself.
+	 */
+	void pin(bool keep) {
+		pinned = keep;
+		textureBudget().pin(texture, pinned);
+	}
+
+	const std::string path;
+	SDL_Texture* texture;
+	SDL_Renderer* renderer;
+	TextureLoader load;
+	bool pinned;
+	//True while the texture's been evicted and not restored
+	bool evicted;
+
+private:
+	TextureEntry(const TextureEntry&);
+	TextureEntry& operator=(const TextureEntry&);
+
+	static void evictEntry(void* owner, SDL_Texture*) {
+		TextureEntry* entry = static_cast<TextureEntry*>(owner);
+		entry->saveMods();
+		cleanup(entry->texture);
+		entry->texture = nullptr;
+		entry->evicted = true;
+	}
+
+	void saveMods() {
+		SDL_GetTextureBlendMode(texture, &blend);
+		SDL_GetTextureColorMod(texture, &r, &g, &b);
+		SDL_GetTextureAlphaMod(texture, &a);
+	}
+
+	SDL_BlendMode blend;
+	Uint8 r, g, b, a;
+};
+
+/**
+ * A reference counted handle to a texture loaded through a TextureCache.
+ * Copying the handle shares the texture, and the texture is destroyed
+ * once the last handle to it is reset or goes out of scope, so every
+ * handle must be released before the renderer is destroyed.
+ */
+class TextureHandle {
+public:
+	TextureHandle() {}
+
+	/**
+	 * Get the texture, loading it again if it's been evicted, and mark it
+	 * as used. An evictable texture may be freed when another is loaded, so
+	 * get it from the handle each time it's drawn, or pin it.
+	 *
+	 * @return The texture, or nullptr if the handle is empty.
+	 */
+	SDL_Texture* get() const {
+		if (!entry) {
+			return nullptr;
+		}
+		if (entry->evicted) {
+			entry->restore();
+		}
+		textureBudget().touch(entry->texture);
+		return entry->texture;
+	}
+
+	/**
+	 * Keep the texture from being evicted, or let it be again.
+	 *
+	 * @param keep True to keep it.
+	 */
+	void pin(bool keep = true) {
+		if (entry) {
+			entry->pin(keep);
+		}
+	}
+
+	/**
+	 * @return The resolved path the texture was loaded from.
+	 */
+	const std::string& path() const {
+		static const std::string none;
+		return entry ? entry->path : none;
+	}
+
+	/**
+	 * @return The number of handles sharing the texture.
+	 */
+	long useCount() const {
+		return entry.use_count();
+	}
+
+	/**
+	 * Release this handle's reference to the texture.
+	 */
+	void reset() {
+		entry.reset();
+	}
+
+	/**
+	 * @return True if the handle has a texture, even if it's been evicted.
+	 *            This doesn't load it again or mark it as used.
+	 */
+	explicit operator bool() const {
+		return entry && (entry->texture != nullptr || entry->evicted);
+	}
+
+private:
+	friend class TextureCache;
+	explicit TextureHandle(const std::shared_ptr<TextureEntry>& e) : entry(e) {}
+
+	std::shared_ptr<TextureEntry> entry;
+};
+
+/**
+ * Lexically resolve a path, collapsing repeated separators and any "." or
+ * ".." components, so different spellings of one file share a cache entry.
+ *
+ * @param  file The path to resolve.
+ * @return      The resolved path, using / as the separator.
+ */
+inline std::string resolvePath(const std::string& file) {
+	const bool absolute = !file.empty() && (file[0] == '/' || file[0] == '\\');
+	std::vector<std::string> parts;
+	std::string::size_type start = 0;
+	while (start <= file.size()) {
+		std::string::size_type end = file.find_first_of("/\\", start);
+		if (end == std::string::npos) {
+			end = file.size();
+		}
+		const std::string part = file.substr(start, end - start);
+		if (part == "..") {
+			if (!parts.empty() && parts.back() != "..") {
+				parts.pop_back();
+			} else if (!absolute) {
+				parts.push_back(part);
+			}
+		} else if (!part.empty() && part != ".") {
+			parts.push_back(part);
+		}
+		start = end + 1;
+	}
+
+	std::string resolved = absolute ? "/" : "";
+	for (std::vector<std::string>::size_type i = 0; i < parts.size(); i++) {
+		if (i != 0) {
+			resolved += '/';
+		}
+		resolved += parts[i];
+	}
+	return resolved;
+}
+
+/**
+ * Loads textures through a loader function, handing out shared handles so
+ * a file that's already on the renderer is never decoded or uploaded again.
+ * The cache only keeps weak references, the handles own the textures.
+ * A texture can be reloaded in place when its file changes, such as when a
+ * FileWatch sees it saved, and every handle to it gets the new texture.
+ * The loader has to pick up the change, such as loadTexture, which skips a
+ * .tex file that's older than its image.
+ */
+class TextureCache {
+public:
+	/**
+	 * @param ren    The renderer to load textures onto.
+	 * @param loader The function used to load a texture that isn't cached.
+	 */
+	TextureCache(SDL_Renderer* ren, TextureLoader loader) : renderer(ren), load(loader),
+		pruneAt(MIN_PRUNE)
+	{}
+
+	/**
+	 * Get a handle to a texture, loading it if no handle to it is alive.
+	 *
+	 * @param  file The image file to load.
+	 * @return      A handle to the texture, empty if something went wrong.
+	 */
+	TextureHandle get(const std::string& file) {
+		const std::string path = resolvePath(file);
+		std::map<std::string, std::weak_ptr<TextureEntry> >::iterator it = entries.find(path);
+		if (it != entries.end()) {
+			std::shared_ptr<TextureEntry> entry = it->second.lock();
+			if (entry) {
+				return TextureHandle(entry);
+			}
+			entries.erase(it);
+		}
+
+		SDL_Texture* texture = load(path, renderer);
+		if (texture == nullptr) {
+			return TextureHandle();
+		}
+		std::shared_ptr<TextureEntry> entry = std::make_shared<TextureEntry>(path, texture,
+			renderer, load);
+		insert(path, entry);
+		return TextureHandle(entry);
+	}
+
+	/**
+	 * Hand a texture that was loaded elsewhere, such as by the
+	 * AsyncTextureLoader, over to the cache. If the file is already
+	 * cached the new texture is a duplicate and is freed.
+	 *
+	 * @param  file    The image file the texture was loaded from.
+	 * @param  texture The texture to share.
+	 * @return         A handle to the texture, empty if texture was empty.
+	 */
+	TextureHandle adopt(const std::string& file, UniqueTexture texture) {
+		const std::string path = resolvePath(file);
+		std::map<std::string, std::weak_ptr<TextureEntry> >::iterator it = entries.find(path);
+		if (it != entries.end()) {
+			std::shared_ptr<TextureEntry> entry = it->second.lock();
+			if (entry) {
+				return TextureHandle(entry);
+			}
+			entries.erase(it);
+		}
+		if (!texture) {
+			return TextureHandle();
+		}
+
+		std::shared_ptr<TextureEntry> entry = std::make_shared<TextureEntry>(path, texture.release(),
+			renderer, load);
+		insert(path, entry);
+		return TextureHandle(entry);
+	}
+
+	/**
+	 * Load a cached texture's file again and swap the new texture in for
+	 * the old one, keeping its blend mode and color and alpha mods. Handles
+	 * stay valid, but anything that held on to the old SDL_Texture itself
+	 * or its size has to get them again. If the file can't be loaded, such
+	 * as when it's only half written, the old texture is kept.
+	 *
+	 * @param  file The image file to reload.
+	 * @return      True if a texture was reloaded, false if the file isn't
+	 *                 cached or couldn't be loaded.
+	 */
+	bool reload(const std::string& file) {
+		std::map<std::string, std::weak_ptr<TextureEntry> >::iterator it = entries.find(resolvePath(file));
+		if (it == entries.end()) {
+			return false;
+		}
+		std::shared_ptr<TextureEntry> entry = it->second.lock();
+		if (!entry) {
+			entries.erase(it);
+			return false;
+		}
+		SDL_Texture* texture = load(entry->path, renderer);
+		if (texture == nullptr) {
+			return false;
+		}
+		entry->replace(texture);
+		return true;
+	}
+
+	/**
+	 * Reload every cached texture loaded from one of a list of changed
+	 * files. A file matches a texture if it's the same apart from the
+	 * extension, so a changed .tex from texconv reloads its image too.
+	 *
+	 * @param  files The files that changed.
+	 * @return       The number of textures reloaded.
+	 */
+	int reloadChanged(const std::vector<std::string>& files) {
+		int reloaded = 0;
+		for (std::vector<std::string>::size_type i = 0; i < files.size(); i++) {
+			const std::string stem = withoutExtension(resolvePath(files[i]));
+			std::vector<std::string> paths;
+			std::map<std::string, std::weak_ptr<TextureEntry> >::iterator it = entries.begin();
+			while (it != entries.end()) {
+				if (it->second.expired()) {
+					entries.erase(it++);
+					continue;
+				}
+				if (withoutExtension(it->first) == stem) {
+					paths.push_back(it->first);
+				}
+				++it;
+			}
+			for (std::vector<std::string>::size_type j = 0; j < paths.size(); j++) {
+				if (reload(paths[j])) {
+					reloaded++;
+				}
+			}
+		}
+		return reloaded;
+	}
+
+	/**
+	 * @return The number of textures the cache's handles are keeping alive.
+	 */
+	int size() const {
+		int live = 0;
+		std::map<std::string, std::weak_ptr<TextureEntry> >::const_iterator it;
+		for (it = entries.begin(); it != entries.end(); ++it) {
+			if (!it->second.expired()) {
+				live++;
+			}
+		}
+		return live;
+	}
+
+private:
+	//The fewest entries there are before the released ones are pruned
+	static const size_t MIN_PRUNE = 64;
+
+	TextureCache(const TextureCache&);
+	TextureCache& operator=(const TextureCache&);
+
+	//Add an entry, first pruning the ones whose handles have all been
+	//released once there are twice as many entries as after the last
+	//prune, so loading many different files doesn't grow the map forever
+	void insert(const std::string& path, const std::shared_ptr<TextureEntry>& entry) {
+		if (entries.size() >= pruneAt) {
+			std::map<std::string, std::weak_ptr<TextureEntry> >::iterator it = entries.begin();
+			while (it != entries.end()) {
+				if (it->second.expired()) {
+					entries.erase(it++);
+				} else {
+					++it;
+				}
+			}
+			pruneAt = std::max(entries.size() * 2, static_cast<size_t>(MIN_PRUNE));
+		}
+		entries[path] = entry;
+	}
+
+	static std::string withoutExtension(const std::string& path) {
+		const std::string::size_type dot = path.rfind('.');
+		const std::string::size_type sep = path.rfind('/');
+		if (dot == std::string::npos || (sep != std::string::npos && dot < sep)) {
+			return path;
+		}
+		return path.substr(0, dot);
+	}
+
+	SDL_Renderer* renderer;
+	TextureLoader load;
+	std::map<std::string, std::weak_ptr<TextureEntry> > entries;
+	size_t pruneAt;
+};
+
+#endif
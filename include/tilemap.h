@@ -0,0 +1,393 @@
+#ifndef TILEMAP_H
+#define TILEMAP_H
+
+#include <iostream>
+#include <vector>
+#include <SDL.h>
+
+#include "cleanup.h"
+#include "draw_queue.h"
+#include "profiler.h"
+#include "sprite_batch.h"
+#include "texture_budget.h"
+
+//Drawing the chunks premultiplied needs a custom blend mode, added in SDL 2.0.6
+#if SDL_VERSION_ATLEAST(2, 0, 6)
+#define TILEMAP_PREMULTIPLIED_BLEND
+#endif
+
+/**
+ * A grid of tiles drawn from one tileset texture. The tiles are rendered
+ * once into CHUNK_SIZE square render target textures, and each frame only
+ * the chunks that overlap the camera are copied to the screen, so the cost
+ * of drawing doesn't grow with the size of the map.
+ * Chunks are built lazily the first time they're seen and rebuilt when one
+ * of their tiles changes. At most MAX_CHUNKS are kept, the ones the camera
+ * saw least recently are released to make room, so a large map costs
+ * texture memory for the area around the camera rather than the whole map.
+ * Without render target support the visible tiles are batched every frame
+ * instead.
+ */
+class TileLayer {
+public:
+	//Size of the chunks the layer is cached in, in pixels
+	static const int CHUNK_SIZE = 512;
+	//Most chunk textures kept at once, 64 chunks is 64MB of ARGB8888
+	static const int MAX_CHUNKS = 64;
+	//Tile id for a cell with nothing in it
+	static const int EMPTY = -1;
+
+	/**
+	 * @param tileset  The texture the tiles are drawn from, it must outlive the layer.
+	 * @param columns  The width of the map in tiles.
+	 * @param rows     The height of the map in tiles.
+	 * @param tileSize The width and height each tile is drawn at.
+	 */
+	TileLayer(SDL_Texture* tileset, int columns, int rows, int tileSize)
+		: texture(tileset), cols(columns), rowCount(rows), size(tileSize),
+		tiles(columns * rows, EMPTY),
+		chunkCols((columns * tileSize + CHUNK_SIZE - 1) / CHUNK_SIZE),
+		chunkRows((rows * tileSize + CHUNK_SIZE - 1) / CHUNK_SIZE),
+		chunks(chunkCols * chunkRows), liveChunks(0), frame(0), useChunks(true) {}
+	~TileLayer() {
+		clear();
+	}
+
+	/**
+	 * Add a kind of tile to the tileset.
+	 *
+	 * @param  clip The sub-section of the tileset to draw, default nullptr
+	 *                 draws the entire texture.
+	 * @return      The new tile's id.
+	 */
+	int addTile(const SDL_Rect* clip = nullptr) {
+		//A negative size marks the tile as using the entire texture
+		const SDL_Rect whole = {0, 0, -1, -1};
+		clips.push_back(clip != nullptr ? *clip : whole);
+		return static_cast<int>(clips.size()) - 1;
+	}
+
+	/**
+	 * Set the tile in one cell of the map.
+	 *
+	 * @param col The column of the cell.
+	 * @param row The row of the cell.
+	 * @param id  The tile to put there, or EMPTY.
+	 */
+	void setTile(int col, int row, int id) {
+		if (col < 0 || row < 0 || col >= cols || row >= rowCount) {
+			return;
+		}
+		tiles[row * cols + col] = id;
+		//The tile can straddle chunk edges, so mark every chunk it touches
+		const SDL_Rect area = {col * size, row * size, size, size};
+		invalidate(area);
+	}
+
+	/**
+	 * Set every cell of the map to the same tile.
+	 *
+	 * @param id The tile to fill the map with, or EMPTY.
+	 */
+	void fill(int id) {
+		tiles.assign(tiles.size(), id);
+		invalidate();
+	}
+
+	/**
+	 * Mark every chunk as needing to be rebuilt, such as when the renderer
+	 * reports its render targets were reset.
+	 */
+	void invalidate() {
+		for (std::vector<Chunk>::size_type i = 0; i < chunks.size(); i++) {
+			chunks[i].dirty = true;
+		}
+	}
+
+	/**
+	 * Draw the part of the map the camera can see.
+	 *
+	 * @param ren     The renderer to draw to.
+	 * @param camera  The region of the map to show, in map pixels.
+	 * @param screenX The x coordinate on screen to draw the camera's view at.
+	 * @param screenY The y coordinate on screen to draw the camera's view at.
+	 * @return        The number of chunks drawn, or tiles if chunks can't be used.
+	 */
+	int draw(SDL_Renderer* ren, const SDL_Rect& camera, int screenX = 0, int screenY = 0) {
+		return render(ren, nullptr, 0, camera, screenX, screenY);
+	}
+
+	/**
+	 * Queue the part of the map the camera can see, so it's sorted with
+	 * the rest of the frame's draws. Any chunks that need building are
+	 * built straight away. The queue must be drawn before the layer is
+	 * drawn again or changed.
+	 *
+	 * @param ren     The renderer the chunks are built with.
+	 * @param queue   The queue to add the draws to.
+	 * @param layer   The queue layer to draw the map on.
+	 * @param camera  The region of the map to show, in map pixels.
+	 * @param screenX The x coordinate on screen to draw the camera's view at.
+	 * @param screenY The y coordinate on screen to draw the camera's view at.
+	 * @return        The number of chunks queued, or tiles if chunks can't be used.
+	 */
+	int draw(SDL_Renderer* ren, DrawQueue& queue, Uint16 layer, const SDL_Rect& camera,
+			int screenX = 0, int screenY = 0) {
+		return render(ren, &queue, layer, camera, screenX, screenY);
+	}
+
+	/**
+	 * Destroy the chunk textures, must be called before the renderer is destroyed.
+	 */
+	void clear() {
+		for (std::vector<Chunk>::size_type i = 0; i < chunks.size(); i++) {
+			cleanup(chunks[i].texture);
+			chunks[i].texture = nullptr;
+			chunks[i].dirty = true;
+		}
+		liveChunks = 0;
+	}
+
+	/**
+	 * @return The width of the map in pixels.
+	 */
+	int width() const {
+		return cols * size;
+	}
+
+	/**
+	 * @return The height of the map in pixels.
+	 */
+	int height() const {
+		return rowCount * size;
+	}
+
+private:
+	struct Chunk {
+		Chunk() : texture(nullptr), dirty(true), lastUsed(0) {}
+		SDL_Texture* texture;
+		bool dirty;
+		unsigned lastUsed;
+	};
+
+	TileLayer(const TileLayer&);
+	TileLayer& operator=(const TileLayer&);
+
+	static int clamp(int i, int count) {
+		return i < 0 ? 0 : (i >= count ? count - 1 : i);
+	}
+
+	//The region of the map a chunk covers, chunks on the far edges may be smaller
+	SDL_Rect chunkArea(int col, int row) const {
+		SDL_Rect area = {col * CHUNK_SIZE, row * CHUNK_SIZE, CHUNK_SIZE, CHUNK_SIZE};
+		if (area.x + area.w > width()) {
+			area.w = width() - area.x;
+		}
+		if (area.y + area.h > height()) {
+			area.h = height() - area.y;
+		}
+		return area;
+	}
+
+	//Mark the chunks covering part of the map as dirty
+	void invalidate(const SDL_Rect& area) {
+		const int firstCol = clamp(area.x / CHUNK_SIZE, chunkCols);
+		const int firstRow = clamp(area.y / CHUNK_SIZE, chunkRows);
+		const int lastCol = clamp((area.x + area.w - 1) / CHUNK_SIZE, chunkCols);
+		const int lastRow = clamp((area.y + area.h - 1) / CHUNK_SIZE, chunkRows);
+		for (int row = firstRow; row <= lastRow; row++) {
+			for (int col = firstCol; col <= lastCol; col++) {
+				chunks[row * chunkCols + col].dirty = true;
+			}
+		}
+	}
+
+	//Draw the visible chunks, or queue them if there's a queue, returning how
+	//many draws were made
+	int render(SDL_Renderer* ren, DrawQueue* queue, Uint16 layer, const SDL_Rect& camera,
+			int screenX, int screenY) {
+		if (useChunks && !SDL_RenderTargetSupported(ren)) {
+			useChunks = false;
+		}
+		const SDL_Rect map = {0, 0, width(), height()};
+		if (!SDL_HasIntersection(&camera, &map)) {
+			return 0;
+		}
+		frame++;
+		if (!useChunks) {
+			const int drawn = drawTiles(camera, camera.x - screenX, camera.y - screenY, queue, layer);
+			if (queue == nullptr) {
+				batch.draw(ren, texture);
+			}
+			return drawn;
+		}
+
+		const int firstCol = clamp(camera.x / CHUNK_SIZE, chunkCols);
+		const int firstRow = clamp(camera.y / CHUNK_SIZE, chunkRows);
+		const int lastCol = clamp((camera.x + camera.w - 1) / CHUNK_SIZE, chunkCols);
+		const int lastRow = clamp((camera.y + camera.h - 1) / CHUNK_SIZE, chunkRows);
+		//Build everything in view before drawing any of it, so a failed build
+		//doesn't free chunks that have already been queued
+		for (int row = firstRow; row <= lastRow; row++) {
+			for (int col = firstCol; col <= lastCol; col++) {
+				Chunk& chunk = chunks[row * chunkCols + col];
+				chunk.lastUsed = frame;
+				if (chunk.dirty && !build(ren, chunk, chunkArea(col, row))) {
+					//Out of texture memory or similar, draw this frame without the chunks
+					clear();
+					useChunks = false;
+					return render(ren, queue, layer, camera, screenX, screenY);
+				}
+			}
+		}
+		for (int row = firstRow; row <= lastRow; row++) {
+			for (int col = firstCol; col <= lastCol; col++) {
+				const Chunk& chunk = chunks[row * chunkCols + col];
+				const SDL_Rect area = chunkArea(col, row);
+				SDL_Rect dst = {area.x - camera.x + screenX, area.y - camera.y + screenY,
+					area.w, area.h};
+				if (queue != nullptr) {
+					queue->add(layer, chunk.texture, dst);
+				} else {
+					profiler().countDraw(chunk.texture);
+					SDL_RenderCopy(ren, chunk.texture, NULL, &dst);
+				}
+			}
+		}
+		return (lastRow - firstRow + 1) * (lastCol - firstCol + 1);
+	}
+
+	//Queue the tiles overlapping area into the batch, or the draw queue if
+	//there is one, offset by (offsetX, offsetY), returning how many there are
+	int drawTiles(const SDL_Rect& area, int offsetX, int offsetY,
+			DrawQueue* queue = nullptr, Uint16 layer = 0) {
+		batch.clear();
+		if (area.w <= 0 || area.h <= 0) {
+			return 0;
+		}
+		int drawn = 0;
+		const int firstCol = clamp(area.x / size, cols);
+		const int firstRow = clamp(area.y / size, rowCount);
+		const int lastCol = clamp((area.x + area.w - 1) / size, cols);
+		const int lastRow = clamp((area.y + area.h - 1) / size, rowCount);
+		for (int row = firstRow; row <= lastRow; row++) {
+			for (int col = firstCol; col <= lastCol; col++) {
+				const int id = tiles[row * cols + col];
+				if (id < 0 || id >= static_cast<int>(clips.size())) {
+					continue;
+				}
+				SDL_Rect dst = {col * size - offsetX, row * size - offsetY, size, size};
+				const SDL_Rect* clip = clips[id].w < 0 ? nullptr : &clips[id];
+				if (queue != nullptr) {
+					queue->add(layer, texture, dst, clip);
+				} else {
+					batch.add(dst, clip);
+				}
+				drawn++;
+			}
+		}
+		return drawn;
+	}
+
+	//Release the chunk the camera saw least recently, skipping ones seen this frame
+	void evictChunk() {
+		Chunk* oldest = nullptr;
+		for (std::vector<Chunk>::size_type i = 0; i < chunks.size(); i++) {
+			Chunk& chunk = chunks[i];
+			if (chunk.texture != nullptr && chunk.lastUsed != frame
+				&& (oldest == nullptr || chunk.lastUsed < oldest->lastUsed))
+			{
+				oldest = &chunk;
+			}
+		}
+		if (oldest != nullptr) {
+			cleanup(oldest->texture);
+			oldest->texture = nullptr;
+			oldest->dirty = true;
+			liveChunks--;
+		}
+	}
+
+	//Draw a chunk with (ONE, ONE_MINUS_SRC_ALPHA), or NONE if the renderer
+	//can't
+	static void setChunkBlendMode(SDL_Texture* tex) {
+#ifdef TILEMAP_PREMULTIPLIED_BLEND
+		const SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+			SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+		if (SDL_SetTextureBlendMode(tex, premultiplied) == 0) {
+			return;
+		}
+#endif
+		SDL_SetTextureBlendMode(tex, SDL_BLENDMODE_NONE);
+	}
+
+	//Render a chunk's tiles into its texture
+	bool build(SDL_Renderer* ren, Chunk& chunk, const SDL_Rect& area) {
+		if (chunk.texture == nullptr) {
+			if (liveChunks >= MAX_CHUNKS) {
+				evictChunk();
+			}
+			chunk.texture = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+				SDL_TEXTUREACCESS_TARGET, area.w, area.h);
+			if (chunk.texture == nullptr) {
+				std::cout << "TileLayer error: " << SDL_GetError() << std::endl;
+				return false;
+			}
+			liveChunks++;
+			trackTexture(chunk.texture);
+			//Blending the tiles into a chunk cleared to transparent black
+			//leaves its colors multiplied by their alpha already, so the chunk
+			//is drawn premultiplied or translucent tiles would get their
+			//alpha applied twice. Without custom blend modes it's drawn opaque
+			setChunkBlendMode(chunk.texture);
+		}
+
+		//Switching between two targets loses the first one's viewport and
+		//clip rect, and keeps its scale, so keep them to put back afterwards
+		SDL_Texture* target = SDL_GetRenderTarget(ren);
+		float scaleX, scaleY;
+		SDL_RenderGetScale(ren, &scaleX, &scaleY);
+		SDL_Rect viewport, clip;
+		SDL_RenderGetViewport(ren, &viewport);
+		SDL_RenderGetClipRect(ren, &clip);
+		const SDL_bool clipped = SDL_RenderIsClipEnabled(ren);
+		Uint8 r, g, b, a;
+		SDL_GetRenderDrawColor(ren, &r, &g, &b, &a);
+
+		SDL_SetRenderTarget(ren, chunk.texture);
+		SDL_RenderSetScale(ren, 1.0f, 1.0f);
+		SDL_SetRenderDrawColor(ren, 0, 0, 0, 0);
+		SDL_RenderClear(ren);
+		drawTiles(area, area.x, area.y);
+		batch.draw(ren, texture);
+
+		SDL_SetRenderDrawColor(ren, r, g, b, a);
+		SDL_SetRenderTarget(ren, target);
+		if (target != nullptr) {
+			SDL_RenderSetScale(ren, scaleX, scaleY);
+			SDL_RenderSetViewport(ren, &viewport);
+			SDL_RenderSetClipRect(ren, clipped ? &clip : NULL);
+		}
+
+		chunk.dirty = false;
+		return true;
+	}
+
+	SDL_Texture* texture;
+	const int cols;
+	const int rowCount;
+	const int size;
+	std::vector<int> tiles;
+	std::vector<SDL_Rect> clips;
+	const int chunkCols;
+	const int chunkRows;
+	std::vector<Chunk> chunks;
+	int liveChunks;
+	//Counts draws, so chunks know when the camera last saw them
+	unsigned frame;
+	bool useChunks;
+	SpriteBatch batch;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include <iostream>
+#include <string>
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "res_pack.h"
+#include "lesson_image.h"
+#include "lesson_util.h"
+#include "raw_texture.h"
+#include "texture_budget.h"
+
+SDL_Texture* loadTexture(const std::string& file, SDL_Renderer* ren) {
+	SDL_Texture* texture = nullptr;
+	if (rawTextureCurrent(file)) {
+		texture = loadRawTexture(rawTexturePath(file), ren);
+	}
+	if (texture == nullptr) {
+		texture = IMG_LoadTexture_RW(ren, openResource(file), 1);
+	}
+
+	if (texture == nullptr) {
+		logSDLError(std::cout, "LoadTexture");
+	}
+	//Counted as pinned, a TextureCache makes it evictable
+	trackTexture(texture);
+
+	return texture;
+}
@@ -0,0 +1,85 @@
+#include <iostream>
+#include <string>
+#include <SDL.h>
+
+#include "res_pack.h"
+#include "lesson_util.h"
+#include "profiler.h"
+#include "surface_ops.h"
+#include "texture_budget.h"
+
+void logSDLError(std::ostream& os, const std::string& msg) {
+	os << msg << " error: " << SDL_GetError() << std::endl;
+}
+
+SDL_Texture* loadBMPTexture(const std::string& file, SDL_Renderer* ren) {
+	SDL_Texture* texture = nullptr;
+	SDL_Surface* loadedImage = SDL_LoadBMP_RW(openResource(file), 1);
+
+	if (loadedImage != nullptr) {
+		//Convert to ARGB8888 with the SIMD kernels so the upload is a plain copy
+		SDL_Surface* converted = convertSurface(loadedImage);
+		SDL_FreeSurface(loadedImage);
+		if (converted == nullptr) {
+			logSDLError(std::cout, "ConvertSurface");
+			return nullptr;
+		}
+		texture = SDL_CreateTextureFromSurface(ren, converted);
+		SDL_FreeSurface(converted);
+		//Make sure converting went well
+		if (texture == nullptr) {
+			logSDLError(std::cout, "CreateTextureFromSurface");
+		}
+		trackTexture(texture);
+	} else {
+		logSDLError(std::cout, "LoadBMP");
+	}
+
+	return texture;
+}
+
+void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, SDL_Rect dst, SDL_Rect* clip) {
+	profiler().countDraw(tex);
+	SDL_RenderCopy(ren, tex, clip, &dst);
+}
+
+void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, SDL_Rect* clip) {
+	SDL_Rect dst;
+	dst.x = x;
+	dst.y = y;
+
+	if (clip != nullptr) {
+		dst.w = clip->w;
+		dst.h = clip->h;
+	} else {
+		SDL_QueryTexture(tex, NULL, NULL, &dst.w, &dst.h);
+	}
+
+	renderTexture(tex, ren, dst, clip);
+}
+
+void renderTexture(SDL_Texture* tex, SDL_Renderer* ren, int x, int y, int w, int h) {
+	//Setup destination rectangle at given (x,y)
+	SDL_Rect dst;
+	dst.x = x;
+	dst.y = y;
+	dst.w = w;
+	dst.h = h;
+	renderTexture(tex, ren, dst);
+}
+
+void renderTexture(SDL_Texture* tex, DrawQueue& queue, Uint16 layer, int x, int y, int w, int h) {
+	//Setup destination rectangle at given (x,y)
+	SDL_Rect dst;
+	dst.x = x;
+	dst.y = y;
+	dst.w = w;
+	dst.h = h;
+	queue.add(layer, tex, dst);
+}
+
+void renderTexture(SDL_Texture* tex, DrawQueue& queue, Uint16 layer, int x, int y) {
+	int w, h;
+	SDL_QueryTexture(tex, NULL, NULL, &w, &h);
+	renderTexture(tex, queue, layer, x, y, w, h);
+}
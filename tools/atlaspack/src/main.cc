@@ -0,0 +1,317 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "cleanup.h"
+#include "lesson_util.h"
+
+/*
+ * Offline packer for the .atlas format read by SpriteAtlas. Merges many
+ * small images into a few large pages, saved next to the atlas as
+ * {atlas name}_{page}.png, and writes the region table. Regions are named
+ * after their image's file name without the extension.
+ *
+ * With --grid the images aren't repacked: each one is kept as its own page
+ * and cut into WxH cells, numbered down each column and named {name}_{n}.
+ * The images must then be in the same directory as the atlas.
+ *
+ * Usage: atlaspack [--size N] [--padding N] [--grid WxH] -o out.atlas image.png...
+ */
+
+//Matches SpriteAtlas::VERSION
+const Uint16 ATLAS_VERSION = 1;
+
+/**
+ * An image to pack and where it ended up.
+ */
+struct Sprite {
+	std::string name;
+	SDL_Surface* surface;
+	int page;
+	SDL_Rect rect;
+};
+
+/**
+ * A region as written to the atlas.
+ */
+struct Region {
+	std::string name;
+	int page;
+	SDL_Rect rect;
+};
+
+/**
+ * @param  path A file path.
+ * @return      The file name without its directory or extension.
+ */
+std::string baseName(const std::string& path) {
+	const std::string::size_type sep = path.find_last_of("/\\");
+	std::string name = sep == std::string::npos ? path : path.substr(sep + 1);
+	const std::string::size_type dot = name.rfind('.');
+	return dot == std::string::npos ? name : name.substr(0, dot);
+}
+
+/**
+ * @param  path A file path.
+ * @return      The file name without its directory.
+ */
+std::string fileName(const std::string& path) {
+	const std::string::size_type sep = path.find_last_of("/\\");
+	return sep == std::string::npos ? path : path.substr(sep + 1);
+}
+
+bool tallerFirst(const Sprite* a, const Sprite* b) {
+	return a->rect.h > b->rect.h;
+}
+
+/**
+ * Place the sprites on pages with shelf packing: sprites are sorted by
+ * height and laid left to right in rows, starting a new row when one fills
+ * up and a new page when the rows reach the bottom.
+ *
+ * @param  sprites  The sprites to place, their rect w and h must be set.
+ * @param  size     The width and height of a page.
+ * @param  padding  The space left between sprites.
+ * @param  heights  Filled with the height each page actually uses.
+ * @return          True if everything fit, false if a sprite is bigger than a page.
+ */
+bool pack(std::vector<Sprite>& sprites, int size, int padding, std::vector<int>& heights) {
+	std::vector<Sprite*> order;
+	for (std::vector<Sprite>::size_type i = 0; i < sprites.size(); i++) {
+		order.push_back(&sprites[i]);
+	}
+	std::stable_sort(order.begin(), order.end(), tallerFirst);
+
+	int page = -1, x = size, y = 0, shelf = 0;
+	for (std::vector<Sprite*>::size_type i = 0; i < order.size(); i++) {
+		Sprite& s = *order[i];
+		if (s.rect.w > size || s.rect.h > size) {
+			std::cerr << s.name << " is bigger than a " << size << "x" << size << " page" << std::endl;
+			return false;
+		}
+		//Next shelf, then next page
+		if (x + s.rect.w > size) {
+			x = 0;
+			y += shelf;
+			shelf = 0;
+		}
+		if (page < 0 || y + s.rect.h > size) {
+			page++;
+			heights.push_back(0);
+			x = y = shelf = 0;
+		}
+		s.page = page;
+		s.rect.x = x;
+		s.rect.y = y;
+		x += s.rect.w + padding;
+		shelf = std::max(shelf, s.rect.h + padding);
+		heights[page] = std::max(heights[page], y + s.rect.h);
+	}
+	return true;
+}
+
+/**
+ * Write the atlas file.
+ *
+ * @param  file    The file to write.
+ * @param  pages   The page image files, relative to the atlas.
+ * @param  regions The regions, in id order.
+ * @return         True if the file was written.
+ */
+bool writeAtlas(const std::string& file, const std::vector<std::string>& pages,
+		const std::vector<Region>& regions) {
+	SDL_RWops* rw = SDL_RWFromFile(file.c_str(), "wb");
+	if (rw == nullptr) {
+		logSDLError(std::cerr, "Open " + file);
+		return false;
+	}
+	bool ok = SDL_RWwrite(rw, "SATL", 4, 1) == 1;
+	ok = ok && SDL_WriteLE16(rw, ATLAS_VERSION) == 1;
+	ok = ok && SDL_WriteLE16(rw, static_cast<Uint16>(pages.size())) == 1;
+	ok = ok && SDL_WriteLE32(rw, static_cast<Uint32>(regions.size())) == 1;
+	for (std::vector<std::string>::size_type i = 0; ok && i < pages.size(); i++) {
+		ok = SDL_WriteLE16(rw, static_cast<Uint16>(pages[i].size())) == 1
+			&& SDL_RWwrite(rw, pages[i].data(), pages[i].size(), 1) == 1;
+	}
+	for (std::vector<Region>::size_type i = 0; ok && i < regions.size(); i++) {
+		const Region& r = regions[i];
+		ok = SDL_WriteLE16(rw, static_cast<Uint16>(r.name.size())) == 1
+			&& (r.name.empty() || SDL_RWwrite(rw, r.name.data(), r.name.size(), 1) == 1)
+			&& SDL_WriteLE16(rw, static_cast<Uint16>(r.page)) == 1
+			&& SDL_WriteLE16(rw, static_cast<Uint16>(r.rect.x)) == 1
+			&& SDL_WriteLE16(rw, static_cast<Uint16>(r.rect.y)) == 1
+			&& SDL_WriteLE16(rw, static_cast<Uint16>(r.rect.w)) == 1
+			&& SDL_WriteLE16(rw, static_cast<Uint16>(r.rect.h)) == 1;
+	}
+	if (SDL_RWclose(rw) != 0 || !ok) {
+		logSDLError(std::cerr, "Write " + file);
+		return false;
+	}
+	return true;
+}
+
+/**
+ * Cut each image into a grid of cells, keeping the images as the pages.
+ *
+ * @return True if the atlas was written.
+ */
+bool packGrid(const std::vector<Sprite>& sprites, int cellW, int cellH, const std::string& out) {
+	std::vector<std::string> pages;
+	std::vector<Region> regions;
+	for (std::vector<Sprite>::size_type i = 0; i < sprites.size(); i++) {
+		const Sprite& s = sprites[i];
+		const int cols = s.rect.w / cellW;
+		const int rows = s.rect.h / cellH;
+		//The same order Lesson5 numbers its clips in
+		for (int j = 0; j < cols * rows; j++) {
+			Region r;
+			r.name = baseName(s.name) + "_" + std::to_string(j);
+			r.page = static_cast<int>(i);
+			r.rect.x = j / rows * cellW;
+			r.rect.y = j % rows * cellH;
+			r.rect.w = cellW;
+			r.rect.h = cellH;
+			regions.push_back(r);
+		}
+		pages.push_back(fileName(s.name));
+	}
+	return writeAtlas(out, pages, regions);
+}
+
+/**
+ * Pack the images onto new pages and save them next to the atlas.
+ *
+ * @return True if the pages and atlas were written.
+ */
+bool packPages(std::vector<Sprite>& sprites, int size, int padding, const std::string& out) {
+	std::vector<int> heights;
+	if (!pack(sprites, size, padding, heights)) {
+		return false;
+	}
+	const std::string::size_type dot = out.rfind('.');
+	const std::string stem = dot == std::string::npos ? out : out.substr(0, dot);
+
+	std::vector<std::string> pages;
+	for (std::vector<int>::size_type p = 0; p < heights.size(); p++) {
+		SDL_Surface* page = SDL_CreateRGBSurfaceWithFormat(0, size, heights[p], 32,
+			SDL_PIXELFORMAT_ARGB8888);
+		if (page == nullptr) {
+			logSDLError(std::cerr, "CreateRGBSurface");
+			return false;
+		}
+		for (std::vector<Sprite>::size_type i = 0; i < sprites.size(); i++) {
+			if (sprites[i].page == static_cast<int>(p)) {
+				SDL_Rect dst = sprites[i].rect;
+				SDL_BlitSurface(sprites[i].surface, NULL, page, &dst);
+			}
+		}
+		const std::string file = stem + "_" + std::to_string(p) + ".png";
+		const bool saved = IMG_SavePNG(page, file.c_str()) == 0;
+		cleanup(page);
+		if (!saved) {
+			logSDLError(std::cerr, "SavePNG " + file);
+			return false;
+		}
+		pages.push_back(fileName(file));
+	}
+
+	std::vector<Region> regions;
+	for (std::vector<Sprite>::size_type i = 0; i < sprites.size(); i++) {
+		Region r;
+		r.name = baseName(sprites[i].name);
+		r.page = sprites[i].page;
+		r.rect = sprites[i].rect;
+		regions.push_back(r);
+	}
+	std::cout << sprites.size() << " images packed onto " << pages.size() << " pages" << std::endl;
+	return writeAtlas(out, pages, regions);
+}
+
+int main(int argc, char** argv) {
+	int size = 2048;
+	int padding = 1;
+	int cellW = 0, cellH = 0;
+	std::string out;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+			size = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--padding") == 0 && i + 1 < argc) {
+			padding = std::atoi(argv[++i]);
+		} else if (std::strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+			const char* grid = argv[++i];
+			cellW = std::atoi(grid);
+			const char* x = std::strchr(grid, 'x');
+			cellH = x != nullptr ? std::atoi(x + 1) : 0;
+		} else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			out = argv[++i];
+		} else if (argv[i][0] != '-') {
+			inputs.push_back(argv[i]);
+		} else {
+			inputs.clear();
+			break;
+		}
+	}
+	const bool grid = cellW > 0 || cellH > 0;
+	if (out.empty() || inputs.empty() || size <= 0 || padding < 0
+		|| (grid && (cellW <= 0 || cellH <= 0)))
+	{
+		std::cerr << "Usage: " << argv[0] << " [--size N] [--padding N] [--grid WxH]"
+			<< " -o out.atlas image.png..." << std::endl;
+		return 1;
+	}
+
+	if (SDL_Init(0) != 0) {
+		logSDLError(std::cerr, "SDL_Init");
+		return 1;
+	}
+	if ((IMG_Init(IMG_INIT_PNG) & IMG_INIT_PNG) != IMG_INIT_PNG) {
+		logSDLError(std::cerr, "IMG_Init");
+		SDL_Quit();
+		return 1;
+	}
+
+	bool ok = true;
+	std::vector<Sprite> sprites;
+	for (std::vector<std::string>::size_type i = 0; i < inputs.size() && ok; i++) {
+		SDL_Surface* loaded = IMG_Load(inputs[i].c_str());
+		if (loaded == nullptr) {
+			logSDLError(std::cerr, "Load " + inputs[i]);
+			ok = false;
+			break;
+		}
+		//Copy pixels and alpha as they are instead of blending them onto the page
+		Sprite s;
+		s.name = inputs[i];
+		s.surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0);
+		cleanup(loaded);
+		if (s.surface == nullptr) {
+			logSDLError(std::cerr, "ConvertSurface");
+			ok = false;
+			break;
+		}
+		SDL_SetSurfaceBlendMode(s.surface, SDL_BLENDMODE_NONE);
+		s.page = 0;
+		s.rect.x = s.rect.y = 0;
+		s.rect.w = s.surface->w;
+		s.rect.h = s.surface->h;
+		sprites.push_back(s);
+	}
+
+	if (ok) {
+		ok = grid ? packGrid(sprites, cellW, cellH, out) : packPages(sprites, size, padding, out);
+	}
+
+	for (std::vector<Sprite>::size_type i = 0; i < sprites.size(); i++) {
+		cleanup(sprites[i].surface);
+	}
+	IMG_Quit();
+	SDL_Quit();
+
+	return ok ? 0 : 1;
+}
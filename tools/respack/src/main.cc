@@ -0,0 +1,234 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+#include "lesson_util.h"
+
+/*
+ * Packs every file under a directory, normally res/, into the pack format
+ * read by ResourcePack. Paths in the pack are relative to the directory and
+ * use / separators, so "res/Lesson3/image.png" is stored as
+ * "Lesson3/image.png".
+ *
+ * Usage: respack [--align N] -o res.pak res/
+ */
+
+//Matches ResourcePack::VERSION
+const Uint32 PACK_VERSION = 1;
+
+/**
+ * Find every file under a directory.
+ *
+ * @param  root   The directory being packed.
+ * @param  prefix The path of the directory to list relative to root, empty
+ *                   or ending with /.
+ * @param  files  Filled with the paths of the files relative to root.
+ * @return        True if every directory could be read.
+ */
+bool listFiles(const std::string& root, const std::string& prefix, std::vector<std::string>& files) {
+#ifdef _WIN32
+	WIN32_FIND_DATAA found;
+	HANDLE find = FindFirstFileA((root + prefix + "*").c_str(), &found);
+	if (find == INVALID_HANDLE_VALUE) {
+		std::cerr << "Can't read " << root + prefix << std::endl;
+		return false;
+	}
+	bool ok = true;
+	do {
+		const std::string name = found.cFileName;
+		if (name == "." || name == "..") {
+			continue;
+		}
+		if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+			ok = listFiles(root, prefix + name + "/", files) && ok;
+		} else {
+			files.push_back(prefix + name);
+		}
+	} while (FindNextFileA(find, &found));
+	FindClose(find);
+	return ok;
+#else
+	DIR* dir = opendir((root + prefix).c_str());
+	if (dir == nullptr) {
+		std::cerr << "Can't read " << root + prefix << std::endl;
+		return false;
+	}
+	bool ok = true;
+	while (dirent* entry = readdir(dir)) {
+		const std::string name = entry->d_name;
+		if (name == "." || name == "..") {
+			continue;
+		}
+		struct stat info;
+		if (stat((root + prefix + name).c_str(), &info) != 0) {
+			continue;
+		}
+		if (S_ISDIR(info.st_mode)) {
+			ok = listFiles(root, prefix + name + "/", files) && ok;
+		} else if (S_ISREG(info.st_mode)) {
+			files.push_back(prefix + name);
+		}
+	}
+	closedir(dir);
+	return ok;
+#endif
+}
+
+/**
+ * Read a whole file into memory.
+ *
+ * @param  file     The file to read.
+ * @param  contents Filled with the file's contents.
+ * @return          True if the file was read.
+ */
+bool readFile(const std::string& file, std::vector<Uint8>& contents) {
+	SDL_RWops* rw = SDL_RWFromFile(file.c_str(), "rb");
+	if (rw == nullptr) {
+		logSDLError(std::cerr, "Open " + file);
+		return false;
+	}
+	const Sint64 size = SDL_RWsize(rw);
+	contents.resize(size > 0 ? static_cast<size_t>(size) : 0);
+	const bool ok = size >= 0 && (contents.empty()
+		|| SDL_RWread(rw, &contents[0], contents.size(), 1) == 1);
+	SDL_RWclose(rw);
+	if (!ok) {
+		logSDLError(std::cerr, "Read " + file);
+	}
+	return ok;
+}
+
+/**
+ * @return The number of bytes the index takes up, including the header.
+ */
+Uint64 indexSize(const std::vector<std::string>& files) {
+	Uint64 size = 16;
+	for (std::vector<std::string>::size_type i = 0; i < files.size(); i++) {
+		size += 8 + 8 + 2 + files[i].size();
+	}
+	return size;
+}
+
+/**
+ * Round an offset up to a multiple of the alignment.
+ */
+Uint64 alignUp(Uint64 offset, Uint32 align) {
+	return (offset + align - 1) / align * align;
+}
+
+int main(int argc, char** argv) {
+	Uint32 align = 64;
+	std::string out;
+	std::string root;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--align") == 0 && i + 1 < argc) {
+			align = static_cast<Uint32>(std::atoi(argv[++i]));
+		} else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			out = argv[++i];
+		} else if (argv[i][0] != '-' && root.empty()) {
+			root = argv[i];
+		} else {
+			root.clear();
+			break;
+		}
+	}
+	if (out.empty() || root.empty() || align == 0) {
+		std::cerr << "Usage: " << argv[0] << " [--align N] -o res.pak res/" << std::endl;
+		return 1;
+	}
+	if (root[root.size() - 1] != '/' && root[root.size() - 1] != '\\') {
+		root += '/';
+	}
+
+	if (SDL_Init(0) != 0) {
+		logSDLError(std::cerr, "SDL_Init");
+		return 1;
+	}
+
+	std::vector<std::string> files;
+	bool ok = listFiles(root, "", files);
+	//The pack is looked up with a binary search, so the index is kept sorted
+	std::sort(files.begin(), files.end());
+	//Don't pack an old pack that was written inside the directory
+	const std::string::size_type sep = out.find_last_of("/\\");
+	const std::string outName = sep == std::string::npos ? out : out.substr(sep + 1);
+	files.erase(std::remove(files.begin(), files.end(), outName), files.end());
+
+	SDL_RWops* rw = ok ? SDL_RWFromFile(out.c_str(), "wb") : nullptr;
+	if (ok && rw == nullptr) {
+		logSDLError(std::cerr, "Open " + out);
+		ok = false;
+	}
+	if (ok) {
+		//Work out where every blob goes before writing the index
+		std::vector<Uint64> sizes;
+		std::vector<Uint64> offsets;
+		Uint64 offset = indexSize(files);
+		for (std::vector<std::string>::size_type i = 0; ok && i < files.size(); i++) {
+			SDL_RWops* in = SDL_RWFromFile((root + files[i]).c_str(), "rb");
+			const Sint64 size = in != nullptr ? SDL_RWsize(in) : -1;
+			if (in != nullptr) {
+				SDL_RWclose(in);
+			}
+			if (size < 0) {
+				logSDLError(std::cerr, "Size " + root + files[i]);
+				ok = false;
+				break;
+			}
+			offset = alignUp(offset, align);
+			offsets.push_back(offset);
+			sizes.push_back(static_cast<Uint64>(size));
+			offset += size;
+		}
+
+		ok = ok && SDL_RWwrite(rw, "RPAK", 4, 1) == 1
+			&& SDL_WriteLE32(rw, PACK_VERSION) == 1
+			&& SDL_WriteLE32(rw, static_cast<Uint32>(files.size())) == 1
+			&& SDL_WriteLE32(rw, align) == 1;
+		for (std::vector<std::string>::size_type i = 0; ok && i < files.size(); i++) {
+			ok = SDL_WriteLE64(rw, offsets[i]) == 1
+				&& SDL_WriteLE64(rw, sizes[i]) == 1
+				&& SDL_WriteLE16(rw, static_cast<Uint16>(files[i].size())) == 1
+				&& SDL_RWwrite(rw, files[i].data(), files[i].size(), 1) == 1;
+		}
+
+		std::vector<Uint8> contents;
+		const Uint8 zeros[256] = {0};
+		for (std::vector<std::string>::size_type i = 0; ok && i < files.size(); i++) {
+			//Pad up to the blob's offset
+			Sint64 pad = static_cast<Sint64>(offsets[i]) - SDL_RWtell(rw);
+			while (ok && pad > 0) {
+				const size_t n = pad > static_cast<Sint64>(sizeof(zeros)) ? sizeof(zeros) : static_cast<size_t>(pad);
+				ok = SDL_RWwrite(rw, zeros, n, 1) == 1;
+				pad -= n;
+			}
+			ok = ok && readFile(root + files[i], contents) && contents.size() == sizes[i]
+				&& (contents.empty() || SDL_RWwrite(rw, &contents[0], contents.size(), 1) == 1);
+		}
+		if (SDL_RWclose(rw) != 0 || !ok) {
+			logSDLError(std::cerr, "Write " + out);
+			ok = false;
+		} else {
+			std::cout << files.size() << " files packed into " << out
+				<< " (" << offset << " bytes)" << std::endl;
+		}
+	}
+
+	SDL_Quit();
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,218 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_image.h>
+
+#include "cleanup.h"
+#include "lesson_util.h"
+#include "raw_texture.h"
+
+/*
+ * Offline converter from any image SDL_image can read to the .tex format
+ * loaded by raw_texture.h. Each image is converted to ARGB8888, its alpha
+ * premultiplied and the result optionally LZ4 compressed, then written next
+ * to it with a .tex extension where the loaders will find it.
+ *
+ * Usage: texconv [--lz4] image.png...
+ */
+
+//Append an LZ4 length continuation, the part of a length past 15
+void writeLength(std::vector<Uint8>& out, size_t length) {
+	while (length >= 255) {
+		out.push_back(255);
+		length -= 255;
+	}
+	out.push_back(static_cast<Uint8>(length));
+}
+
+//Append a sequence: some literals then a match, or just literals if length is 0
+void writeSequence(std::vector<Uint8>& out, const Uint8* literals, size_t count,
+		size_t offset, size_t length) {
+	const size_t matchCode = length != 0 ? length - 4 : 0;
+	out.push_back(static_cast<Uint8>((count < 15 ? count : 15) << 4
+		| (matchCode < 15 ? matchCode : 15)));
+	if (count >= 15) {
+		writeLength(out, count - 15);
+	}
+	out.insert(out.end(), literals, literals + count);
+	if (length != 0) {
+		out.push_back(static_cast<Uint8>(offset & 0xff));
+		out.push_back(static_cast<Uint8>(offset >> 8));
+		if (matchCode >= 15) {
+			writeLength(out, matchCode - 15);
+		}
+	}
+}
+
+Uint32 read32(const Uint8* p) {
+	Uint32 v;
+	std::memcpy(&v, p, 4);
+	return v;
+}
+
+/**
+ * Compress a buffer into one LZ4 block with a greedy hash chain of depth
+ * one, which is plenty for images with large flat areas.
+ *
+ * @param src  The data to compress.
+ * @param size The size of the data.
+ * @param out  Filled with the compressed block.
+ */
+void lz4Compress(const Uint8* src, size_t size, std::vector<Uint8>& out) {
+	//The format wants the last match to start 12 bytes before the end
+	//and the last 5 bytes to be literals
+	const size_t MIN_MATCH = 4;
+	const size_t MATCH_LIMIT = 12;
+	const size_t LAST_LITERALS = 5;
+	const size_t MAX_OFFSET = 65535;
+	const int HASH_BITS = 16;
+	std::vector<Sint64> table(1 << HASH_BITS, -1);
+
+	out.clear();
+	size_t anchor = 0;
+	size_t i = 0;
+	while (size > MATCH_LIMIT && i + MATCH_LIMIT < size) {
+		const Uint32 seq = read32(src + i);
+		const Uint32 hash = (seq * 2654435761u) >> (32 - HASH_BITS);
+		const Sint64 candidate = table[hash];
+		table[hash] = static_cast<Sint64>(i);
+		if (candidate < 0 || i - candidate > MAX_OFFSET || read32(src + candidate) != seq) {
+			i++;
+			continue;
+		}
+		size_t length = MIN_MATCH;
+		while (i + length < size - LAST_LITERALS && src[candidate + length] == src[i + length]) {
+			length++;
+		}
+		writeSequence(out, src + anchor, i - anchor, i - candidate, length);
+		i += length;
+		anchor = i;
+	}
+	writeSequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+/**
+ * Convert one image and write its .tex file.
+ *
+ * @param  file The image to convert.
+ * @param  lz4  True to compress the pixels.
+ * @return      True if the .tex file was written.
+ */
+bool convert(const std::string& file, bool lz4) {
+	SDL_Surface* loaded = IMG_Load(file.c_str());
+	if (loaded == nullptr) {
+		logSDLError(std::cerr, "Load " + file);
+		return false;
+	}
+	UniqueSurface surface(SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_ARGB8888, 0));
+	cleanup(loaded);
+	if (!surface) {
+		logSDLError(std::cerr, "ConvertSurface");
+		return false;
+	}
+
+	//Pack the rows tightly and premultiply, written as little endian pixels
+	const int w = surface->w;
+	const int h = surface->h;
+	std::vector<Uint8> pixels(static_cast<size_t>(w) * h * 4);
+	SDL_LockSurface(surface.get());
+	for (int y = 0; y < h; y++) {
+		const Uint32* row = reinterpret_cast<const Uint32*>(
+			static_cast<const Uint8*>(surface->pixels) + y * surface->pitch);
+		for (int x = 0; x < w; x++) {
+			const Uint32 p = row[x];
+			const Uint32 a = p >> 24;
+			const Uint32 r = ((p >> 16 & 0xff) * a + 127) / 255;
+			const Uint32 g = ((p >> 8 & 0xff) * a + 127) / 255;
+			const Uint32 b = ((p & 0xff) * a + 127) / 255;
+			Uint8* out = &pixels[(static_cast<size_t>(y) * w + x) * 4];
+			out[0] = static_cast<Uint8>(b);
+			out[1] = static_cast<Uint8>(g);
+			out[2] = static_cast<Uint8>(r);
+			out[3] = static_cast<Uint8>(a);
+		}
+	}
+	SDL_UnlockSurface(surface.get());
+
+	std::vector<Uint8> compressed;
+	Uint16 flags = RAW_TEXTURE_PREMULTIPLIED;
+	if (lz4) {
+		lz4Compress(&pixels[0], pixels.size(), compressed);
+		//Check the block round trips before trusting it
+		std::vector<Uint8> check(pixels.size());
+		if (!lz4Decompress(&compressed[0], compressed.size(), &check[0], check.size())
+			|| check != pixels)
+		{
+			std::cerr << "LZ4 round trip failed for " << file << std::endl;
+			return false;
+		}
+		//Storing incompressible pixels as is loads faster
+		if (compressed.size() < pixels.size()) {
+			flags |= RAW_TEXTURE_LZ4;
+		}
+	}
+	const std::vector<Uint8>& payload = (flags & RAW_TEXTURE_LZ4) ? compressed : pixels;
+
+	const std::string out = rawTexturePath(file);
+	SDL_RWops* rw = SDL_RWFromFile(out.c_str(), "wb");
+	if (rw == nullptr) {
+		logSDLError(std::cerr, "Open " + out);
+		return false;
+	}
+	bool ok = SDL_RWwrite(rw, "RTEX", 4, 1) == 1
+		&& SDL_WriteLE16(rw, RAW_TEXTURE_VERSION) == 1
+		&& SDL_WriteLE16(rw, flags) == 1
+		&& SDL_WriteLE32(rw, static_cast<Uint32>(w)) == 1
+		&& SDL_WriteLE32(rw, static_cast<Uint32>(h)) == 1
+		&& SDL_WriteLE32(rw, SDL_PIXELFORMAT_ARGB8888) == 1
+		&& SDL_WriteLE32(rw, static_cast<Uint32>(payload.size())) == 1
+		&& SDL_RWwrite(rw, &payload[0], payload.size(), 1) == 1;
+	if (SDL_RWclose(rw) != 0 || !ok) {
+		logSDLError(std::cerr, "Write " + out);
+		return false;
+	}
+	std::cout << file << " -> " << out << " (" << w << "x" << h << ", "
+		<< payload.size() + RAW_TEXTURE_HEADER_SIZE << " bytes)" << std::endl;
+	return true;
+}
+
+int main(int argc, char** argv) {
+	bool lz4 = false;
+	std::vector<std::string> inputs;
+	for (int i = 1; i < argc; i++) {
+		if (std::strcmp(argv[i], "--lz4") == 0) {
+			lz4 = true;
+		} else if (argv[i][0] != '-') {
+			inputs.push_back(argv[i]);
+		} else {
+			inputs.clear();
+			break;
+		}
+	}
+	if (inputs.empty()) {
+		std::cerr << "Usage: " << argv[0] << " [--lz4] image.png..." << std::endl;
+		return 1;
+	}
+
+	if (SDL_Init(0) != 0) {
+		logSDLError(std::cerr, "SDL_Init");
+		return 1;
+	}
+	if ((IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG) & IMG_INIT_PNG) != IMG_INIT_PNG) {
+		logSDLError(std::cerr, "IMG_Init");
+		SDL_Quit();
+		return 1;
+	}
+
+	bool ok = true;
+	for (std::vector<std::string>::size_type i = 0; i < inputs.size(); i++) {
+		ok = convert(inputs[i], lz4) && ok;
+	}
+
+	IMG_Quit();
+	SDL_Quit();
+
+	return ok ? 0 : 1;
+}